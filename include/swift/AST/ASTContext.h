@@ -42,6 +42,7 @@
 #include <vector>
 
 namespace clang {
+  class ASTContext;
   class Decl;
   class MacroInfo;
   class ObjCInterfaceDecl;
@@ -810,6 +811,10 @@ public:
                             clang::ObjCInterfaceDecl *classDecl,
                             bool forInstance);
 
+  /// Drop the inherited name sets computed for Objective-C classes in the
+  /// given Clang AST, which is about to be destroyed.
+  void forgetAllPropertyNames(const clang::ASTContext &clangCtx);
+
 private:
   friend class Decl;
   Optional<RawComment> getRawComment(const Decl *D);
@@ -2711,6 +2711,13 @@ class NominalTypeDecl : public TypeDecl, public DeclContext,
   /// Prepare the lookup table to make it ready for lookups.
   void prepareLookupTable(bool ignoreNewExtensions);
 
+  /// Bring the members with the given base name into the lookup table,
+  /// without loading all of the members of this type and its extensions.
+  ///
+  /// \returns false if some member loader can only load all members at
+  /// once, in which case the table has to be prepared in full.
+  bool prepareLookupTableForName(Identifier baseName);
+
   /// Note that we have added a member into the iterable declaration context,
   /// so that it can also be added to the lookup table (if needed).
   void addedMember(Decl *member);
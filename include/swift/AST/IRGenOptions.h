@@ -89,6 +89,10 @@ public:
 
   /// \brief Whether we're generating IR for the JIT.
   unsigned UseJIT : 1;
+
+  /// \brief Whether JIT-compiled code should be made visible to profilers
+  /// and debuggers.
+  unsigned EnableJITProfiling : 1;
   
   /// \brief Whether we should run LLVM optimizations after IRGen.
   unsigned DisableLLVMOptzns : 1;
@@ -113,6 +117,11 @@ public:
   /// (includes alloc_stack allocations).
   unsigned StackPromotionSizeLimit = 1024;
 
+  /// In multi-threaded compilation, create one LLVM module for each thread
+  /// instead of one for each source file, and distribute the SIL functions
+  /// over them by size.
+  unsigned BalanceCodeGenUnits : 1;
+
   /// Emit code to verify that static and runtime type layout are consistent for
   /// the given type names.
   SmallVector<StringRef, 1> VerifyTypeLayoutNames;
@@ -131,11 +140,12 @@ public:
 
   IRGenOptions() : OutputKind(IRGenOutputKind::LLVMAssembly), Verify(true),
                    Optimize(false), DebugInfoKind(IRGenDebugInfoKind::None),
-                   UseJIT(false), DisableLLVMOptzns(false),
+                   UseJIT(false), EnableJITProfiling(false),
+                   DisableLLVMOptzns(false),
                    DisableLLVMARCOpts(false), DisableLLVMSLPVectorizer(false),
                    DisableFPElim(true), Playground(false),
-                   EmitStackPromotionChecks(false), GenerateProfile(false),
-                   EmbedMode(IRGenEmbedMode::None) {}
+                   EmitStackPromotionChecks(false), BalanceCodeGenUnits(false),
+                   GenerateProfile(false), EmbedMode(IRGenEmbedMode::None) {}
   
   /// Gets the name of the specified output filename.
   /// If multiple files are specified, the last one is returned.
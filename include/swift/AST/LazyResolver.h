@@ -17,6 +17,7 @@
 #ifndef SWIFT_AST_LAZYRESOLVER_H
 #define SWIFT_AST_LAZYRESOLVER_H
 
+#include "swift/AST/Identifier.h"
 #include "swift/AST/TypeLoc.h"
 #include "llvm/ADT/Fixnum.h"
 
@@ -26,7 +27,7 @@ class AssociatedTypeDecl;
 class Decl;
 class DeclContext;
 class ExtensionDecl;
-class Identifier;
+class IterableDeclContext;
 class NominalTypeDecl;
 class NormalProtocolConformance;
 class ProtocolConformance;
@@ -138,6 +139,19 @@ public:
     llvm_unreachable("unimplemented");
   }
 
+  /// Populates the given vector with the members of \p IDC that have the
+  /// given base name, without loading any of its other members.
+  ///
+  /// The implementation should \em not add the members to \p IDC.
+  ///
+  /// \returns false if members can only be loaded all at once, in which case
+  /// the caller has to use loadAllMembers().
+  virtual bool
+  loadNamedMembers(const IterableDeclContext *IDC, Identifier baseName,
+                   uint64_t contextData, SmallVectorImpl<ValueDecl *> &members) {
+    return false;
+  }
+
   /// Populates the given vector with all conformances for \p D.
   ///
   /// The implementation should \em not call setConformances on \p D.
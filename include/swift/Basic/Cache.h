@@ -17,6 +17,7 @@
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Optional.h"
+#include <atomic>
 
 namespace swift {
 namespace sys {
@@ -76,6 +77,10 @@ protected:
 
   ImplTy Impl = nullptr;
 
+  /// The number of lookups that found, respectively didn't find, their key.
+  std::atomic<size_t> Hits{0};
+  std::atomic<size_t> Misses{0};
+
   static ImplTy create(llvm::StringRef Name, const CallBacks &CBs);
 
   /// Sets value for key.
@@ -129,6 +134,12 @@ protected:
   /// Invokes \c remove on all keys.
   void removeAll();
 
+  /// Sets the total cost of values the cache should keep.
+  ///
+  /// Once the sum of the costs passed to \c setAndRetain() exceeds the limit,
+  /// the least recently used values are evicted.
+  void setCostLimit(size_t Limit);
+
   /// Destroys cache.
   void destroy();
 };
@@ -192,6 +203,17 @@ public:
     removeAll();
   }
 
+  /// Sets the total cost of values to keep before evicting the least
+  /// recently used ones.
+  void setCostLimit(size_t Limit) {
+    CacheImpl::setCostLimit(Limit);
+  }
+
+  /// Returns the number of \c get calls that found their key.
+  size_t getHitCount() const { return Hits; }
+  /// Returns the number of \c get calls that didn't find their key.
+  size_t getMissCount() const { return Misses; }
+
 private:
   static uintptr_t keyHash(void *Key, void *UserData) {
     return KeyInfoT::getHashValue(*static_cast<KeyT*>(Key));
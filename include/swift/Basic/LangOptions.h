@@ -21,6 +21,7 @@
 #include "swift/Basic/LLVM.h"
 #include "clang/Basic/VersionTuple.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
@@ -122,6 +123,10 @@ namespace swift {
     /// \brief Enable the iterative type checker.
     bool IterativeTypeChecker = false;
 
+    /// \brief Look up members of serialized types by name, without loading
+    /// all of their members.
+    bool NamedLazyMemberLoading = false;
+
     /// Debug the generic signatures computed by the archetype builder.
     bool DebugGenericSignatures = false;
 
@@ -140,6 +145,10 @@ namespace swift {
     /// allocated by the constraint solver.
     unsigned SolverMemoryThreshold = 15000000;
 
+    /// \brief If set, warn when type-checking a single expression takes at
+    /// least this many milliseconds.
+    Optional<unsigned> WarnLongExpressionTypeChecking;
+
     /// \brief Perform all dynamic allocations using malloc/free instead of
     /// optimized custom allocator, so that memory debugging tools can be used.
     bool UseMalloc = false;
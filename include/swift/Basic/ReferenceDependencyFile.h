@@ -0,0 +1,151 @@
+//===--- ReferenceDependencyFile.h - Swift-style dependencies ---*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Reading and writing the ".swiftdeps" files the frontend emits for the
+// driver's incremental build support. There are two encodings of the same
+// content: the original YAML one, which is easy to read and to write by hand
+// in tests, and a compact binary one with interned names, which the driver
+// can use straight out of a memory-mapped file.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_REFERENCEDEPENDENCYFILE_H
+#define SWIFT_BASIC_REFERENCEDEPENDENCYFILE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <vector>
+
+namespace swift {
+
+/// The kinds of names listed in a Swift-style dependencies file.
+enum class ReferenceDependencySection : uint8_t {
+  ProvidesTopLevel,
+  ProvidesNominal,
+  ProvidesMember,
+  ProvidesDynamicLookup,
+  DependsTopLevel,
+  DependsNominal,
+  DependsMember,
+  DependsDynamicLookup,
+  DependsExternal,
+  Last = DependsExternal
+};
+
+/// Returns the key used for \p section in the YAML format, e.g.
+/// "provides-top-level".
+StringRef getReferenceDependencySectionName(ReferenceDependencySection section);
+
+/// Returns true if \p section lists (type, member) pairs rather than single
+/// names.
+inline bool isMemberSection(ReferenceDependencySection section) {
+  return section == ReferenceDependencySection::ProvidesMember ||
+         section == ReferenceDependencySection::DependsMember;
+}
+
+/// Receives the contents of a Swift-style dependencies file, one section at a
+/// time, and encodes them.
+class ReferenceDependencyWriter {
+public:
+  virtual ~ReferenceDependencyWriter() = default;
+
+  /// Starts a new section. Following entries belong to \p section.
+  virtual void beginSection(ReferenceDependencySection section) = 0;
+
+  /// Adds a single name to the current section.
+  virtual void addName(StringRef name, bool isCascading = true) = 0;
+
+  /// Adds a (mangled type name, member name) pair to the current section,
+  /// which must be a member section. An empty \p member stands for "any
+  /// member".
+  virtual void addMember(StringRef base, StringRef member,
+                         bool isCascading = true) = 0;
+
+  /// Records the interface hash of the file.
+  virtual void setInterfaceHash(StringRef hash) = 0;
+
+  /// Writes out anything that is still buffered.
+  virtual void finish() {}
+};
+
+/// Writes the YAML encoding of a dependencies file.
+class YAMLReferenceDependencyWriter : public ReferenceDependencyWriter {
+  raw_ostream &Out;
+
+public:
+  explicit YAMLReferenceDependencyWriter(raw_ostream &out);
+
+  void beginSection(ReferenceDependencySection section) override;
+  void addName(StringRef name, bool isCascading = true) override;
+  void addMember(StringRef base, StringRef member,
+                 bool isCascading = true) override;
+  void setInterfaceHash(StringRef hash) override;
+};
+
+/// Writes the binary encoding of a dependencies file.
+///
+/// Every distinct string is stored once; entries refer to strings by index.
+/// Nothing is written until #finish is called.
+class BinaryReferenceDependencyWriter : public ReferenceDependencyWriter {
+  struct Entry {
+    ReferenceDependencySection Section;
+    bool IsCascading;
+    uint32_t NameIndex;
+    uint32_t MemberIndex;
+  };
+
+  raw_ostream &Out;
+  llvm::StringMap<uint32_t> StringIndices;
+  std::vector<StringRef> Strings;
+  std::vector<Entry> Entries;
+  ReferenceDependencySection CurrentSection =
+    ReferenceDependencySection::ProvidesTopLevel;
+  uint32_t InterfaceHashIndex;
+
+  uint32_t intern(StringRef str);
+
+public:
+  explicit BinaryReferenceDependencyWriter(raw_ostream &out);
+
+  void beginSection(ReferenceDependencySection section) override;
+  void addName(StringRef name, bool isCascading = true) override;
+  void addMember(StringRef base, StringRef member,
+                 bool isCascading = true) override;
+  void setInterfaceHash(StringRef hash) override;
+  void finish() override;
+};
+
+/// Returns true if \p data starts like a binary dependencies file.
+///
+/// Such data can never be valid YAML, so anything else should be handed to
+/// the YAML reader.
+bool isBinaryReferenceDependencyFile(StringRef data);
+
+/// Reads a binary dependencies file, calling \p entryCallback for every
+/// entry in the order they were written, and \p interfaceHashCallback once if
+/// the file has an interface hash. The strings passed to the callbacks point
+/// into \p data. For non-member sections, the member name is empty.
+///
+/// Stops and returns false as soon as the data turns out to be malformed or a
+/// callback returns false. Callbacks may already have been called by then.
+bool readBinaryReferenceDependencies(
+    StringRef data,
+    llvm::function_ref<bool(ReferenceDependencySection section,
+                            StringRef name, StringRef member,
+                            bool isCascading)> entryCallback,
+    llvm::function_ref<bool(StringRef hash)> interfaceHashCallback);
+
+} // end namespace swift
+
+#endif
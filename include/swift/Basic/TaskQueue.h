@@ -18,6 +18,8 @@
 #include "llvm/Config/config.h"
 #include "llvm/Support/Program.h"
 
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <queue>
@@ -40,8 +42,8 @@ enum class TaskFinishedResponse {
 
 /// \brief A class encapsulating the execution of multiple tasks in parallel.
 class TaskQueue {
-  /// Tasks which have not begun execution.
-  std::queue<std::unique_ptr<Task>> QueuedTasks;
+  /// Tasks which have not begun execution, in the order they were added.
+  std::deque<std::unique_ptr<Task>> QueuedTasks;
 
   /// The number of tasks to execute in parallel.
   unsigned NumberOfParallelTasks;
@@ -120,9 +122,14 @@ public:
   /// \param Env the environment which should be used for the task;
   /// must be null-terminated. If empty, inherits the parent's environment.
   /// \param Context an optional context which will be associated with the task
+  /// \param Cost an estimate of how long the task will take to execute, in
+  /// arbitrary units. When there are more queued tasks than can begin
+  /// execution, the most costly ones begin first, so that long tasks do not
+  /// end up running alone at the end; otherwise tasks begin in the order they
+  /// were added.
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, uint64_t Cost = 0);
 
   /// \brief Synchronously executes the tasks in the TaskQueue.
   ///
@@ -168,7 +175,7 @@ public:
 
   virtual void addTask(const char *ExecPath, ArrayRef<const char *> Args,
                        ArrayRef<const char *> Env = llvm::None,
-                       void *Context = nullptr);
+                       void *Context = nullptr, uint64_t Cost = 0);
 
   virtual bool
   execute(TaskBeganCallback Began = TaskBeganCallback(),
@@ -132,6 +132,9 @@ public:
     };
     Status status = UpToDate;
     llvm::sys::TimeValue previousModTime;
+    /// How long the input took to compile in the previous build, in
+    /// milliseconds, or 0 if unknown.
+    uint64_t previousDuration = 0;
 
     InputInfo() = default;
     InputInfo(Status stat, llvm::sys::TimeValue time)
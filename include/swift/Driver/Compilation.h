@@ -127,6 +127,10 @@ private:
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// Indicates whether compile jobs that are ready to run at the same time
+  /// should be grouped into frontend invocations with several primary files.
+  bool EnableBatchMode = false;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -189,6 +193,13 @@ public:
     ShowIncrementalBuildDecisions = value;
   }
 
+  bool getBatchModeEnabled() const {
+    return EnableBatchMode;
+  }
+  void setBatchModeEnabled(bool value = true) {
+    EnableBatchMode = value;
+  }
+
   void setCompilationRecordPath(StringRef path) {
     assert(CompilationRecordPath.empty() && "already set");
     CompilationRecordPath = path;
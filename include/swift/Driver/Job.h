@@ -108,6 +108,10 @@ private:
   /// The modification time of the main input file, if any.
   llvm::sys::TimeValue InputModTime = llvm::sys::TimeValue::MaxTime();
 
+  /// How long this Job took in the previous build, in milliseconds, or 0 if
+  /// unknown.
+  uint64_t PreviousDuration = 0;
+
 public:
   Job(const Action &Source,
       SmallVectorImpl<const Job *> &&Inputs,
@@ -141,6 +145,14 @@ public:
     return InputModTime;
   }
 
+  void setPreviousDuration(uint64_t durationInMS) {
+    PreviousDuration = durationInMS;
+  }
+
+  uint64_t getPreviousDuration() const {
+    return PreviousDuration;
+  }
+
   /// Print the command line for this Job to the given \p stream,
   /// terminating output with the given \p terminator.
   void printCommandLine(raw_ostream &Stream, StringRef Terminator = "\n") const;
@@ -315,9 +315,19 @@ class CompilerInstance {
 
   SourceFile *PrimarySourceFile = nullptr;
 
+  /// The buffers, source files and name trackers for the batch primary
+  /// inputs, in the order of FrontendOptions::BatchPrimaryInputs.
+  SmallVector<unsigned, 4> BatchPrimaryBufferIDs;
+  SmallVector<SourceFile *, 4> BatchPrimarySourceFiles;
+  SmallVector<ReferencedNameTracker *, 4> BatchNameTrackers;
+
   void createSILModule(bool WholeModule = false);
   void setPrimarySourceFile(SourceFile *SF);
 
+  /// If \p SF is one of the batch primary inputs, records it as such.
+  void noteBatchPrimarySourceFile(SourceFile *SF);
+  bool isPrimarySourceFile(const SourceFile *SF) const;
+
 public:
   SourceManager &getSourceMgr() { return SourceMgr; }
 
@@ -331,6 +341,10 @@ public:
   SILOptions &getSILOptions() { return Invocation.getSILOptions(); }
   const SILOptions &getSILOptions() const { return Invocation.getSILOptions(); }
 
+  const IRGenOptions &getIRGenOptions() const {
+    return Invocation.getIRGenOptions();
+  }
+
   void addDiagnosticConsumer(DiagnosticConsumer *DC) {
     Diagnostics.addConsumer(*DC);
   }
@@ -351,6 +365,13 @@ public:
     return NameTracker;
   }
 
+  /// Sets the trackers for the batch primary inputs, in the order of
+  /// FrontendOptions::BatchPrimaryInputs.
+  void setBatchReferencedNameTrackers(ArrayRef<ReferencedNameTracker *> trackers) {
+    assert(!PrimarySourceFile && "must be called before performSema()");
+    BatchNameTrackers.assign(trackers.begin(), trackers.end());
+  }
+
   /// Set the SIL module for this compilation instance.
   ///
   /// The CompilerInstance takes ownership of the given SILModule object.
@@ -384,10 +405,20 @@ public:
     return Invocation.getFrontendOptions().EnableSourceImport;
   }
 
+  StringRef getImmediateCachePath() const {
+    return Invocation.getFrontendOptions().ImmediateCachePath;
+  }
+
   /// Gets the SourceFile which is the primary input for this CompilerInstance.
   /// \returns the primary SourceFile, or nullptr if there is no primary input
   SourceFile *getPrimarySourceFile() { return PrimarySourceFile; }
 
+  /// Gets the SourceFiles for the batch primary inputs, in the order of
+  /// FrontendOptions::BatchPrimaryInputs.
+  ArrayRef<SourceFile *> getBatchPrimarySourceFiles() {
+    return BatchPrimarySourceFiles;
+  }
+
   /// \brief Returns true if there was an error during setup.
   bool setup(const CompilerInvocation &Invocation);
 
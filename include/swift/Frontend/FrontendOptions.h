@@ -52,6 +52,21 @@ public:
   bool isBuffer() const { return Kind == InputKind::Buffer; }
 };
 
+/// A primary input beyond the first in a frontend invocation that compiles a
+/// batch of primary files, along with the outputs to produce for it.
+///
+/// An empty path means that output was not requested.
+struct BatchPrimaryInput {
+  SelectedInput Input;
+  std::string OutputFilename;
+  std::string ModuleOutputPath;
+  std::string ModuleDocOutputPath;
+  std::string DependenciesFilePath;
+  std::string ReferenceDependenciesFilePath;
+
+  BatchPrimaryInput(SelectedInput Input) : Input(Input) {}
+};
+
 enum class InputFileKind {
   IFK_None,
   IFK_Swift,
@@ -74,6 +89,10 @@ public:
   /// be generated for the whole module.
   Optional<SelectedInput> PrimaryInput;
 
+  /// Further inputs for which output should be generated by this invocation,
+  /// each with its own output paths. Only valid alongside PrimaryInput.
+  std::vector<BatchPrimaryInput> BatchPrimaryInputs;
+
   /// The kind of input on which the frontend should operate.
   InputFileKind InputKind = InputFileKind::IFK_Swift;
 
@@ -118,6 +137,10 @@ public:
   /// Arguments which should be passed in immediate mode.
   std::vector<std::string> ImmediateArgv;
 
+  /// The directory in which immediate mode caches the object code of the
+  /// scripts it runs, or empty if it shouldn't.
+  std::string ImmediateCachePath;
+
   /// \brief A list of arguments to forward to LLVM's option processing; this
   /// should only be used for debugging and experimental features.
   std::vector<std::string> LLVMArgs;
@@ -166,6 +189,10 @@ public:
   /// If set, dumps wall time taken to check each function body to llvm::errs().
   bool DebugTimeFunctionBodies = false;
 
+  /// If set, dumps the wall time and constraint solver work taken to check
+  /// each expression and function body to llvm::errs(), slowest first.
+  bool DebugTimeExpressionTypeChecking = false;
+
   /// Indicates whether function body parsing should be delayed
   /// until the end of all files.
   bool DelayedFunctionBodyParsing = false;
@@ -183,6 +210,10 @@ public:
   /// (if asked to emit SIL).
   bool EmitVerboseSIL = false;
 
+  /// Indicates that the Swift reference dependencies file should use the
+  /// binary encoding instead of YAML.
+  bool EmitBinaryReferenceDependencies = false;
+
   /// If set, this module is part of a mixed Objective-C/Swift framework, and
   /// the Objective-C half should implicitly be visible to the Swift sources.
   bool ImportUnderlyingModule = false;
@@ -237,6 +268,11 @@ public:
   bool actionIsImmediate() const;
 
   void forAllOutputPaths(std::function<void(const std::string &)> fn) const;
+
+  /// Returns a copy of these options that produces output for the given
+  /// batch primary input in place of PrimaryInput.
+  FrontendOptions
+  getOptionsForBatchPrimary(const BatchPrimaryInput &input) const;
   
   /// Gets the name of the specified output filename.
   /// If multiple files are specified, the last one is returned.
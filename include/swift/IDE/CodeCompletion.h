@@ -692,6 +692,12 @@ public:
   CodeCompletionCache &Cache;
   CompletionKind CodeCompletionKind = CompletionKind::None;
 
+  /// If not empty, module results that have to be read from the on-disk cache
+  /// are limited to the ones whose name starts with this prefix, ignoring
+  /// case. Only set this if the results will not be filtered with anything
+  /// that doesn't start with the prefix.
+  std::string CachedResultsNamePrefix;
+
   CodeCompletionContext(CodeCompletionCache &Cache)
       : Cache(Cache) {}
 
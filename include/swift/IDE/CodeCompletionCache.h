@@ -59,7 +59,14 @@ public:
   ~CodeCompletionCache();
 
   static ValueRefCntPtr createValue();
-  Optional<ValueRefCntPtr> get(const Key &K);
+
+  /// Returns the cached results for \p K.
+  ///
+  /// If \p NamePrefix is not empty and the results are only on disk, just the
+  /// ones whose name starts with \p NamePrefix, ignoring case, are read. They
+  /// are not added to the in-memory cache.
+  Optional<ValueRefCntPtr> get(const Key &K,
+                               StringRef NamePrefix = StringRef());
   void set(const Key &K, ValueRefCntPtr V) { setImpl(K, V, /*setChain*/ true); }
 
 private:
@@ -81,10 +88,16 @@ public:
   OnDiskCodeCompletionCache(Twine cacheDirectory);
   ~OnDiskCodeCompletionCache();
 
-  Optional<ValueRefCntPtr> get(const Key &K);
+  /// Reads the cached results for \p K, if they are up to date.
+  ///
+  /// The file is memory-mapped and, if \p NamePrefix is not empty, only the
+  /// results whose name starts with it, ignoring case, are deserialized.
+  Optional<ValueRefCntPtr> get(const Key &K,
+                               StringRef NamePrefix = StringRef());
   std::error_code set(const Key &K, ValueRefCntPtr V);
 
-  static Optional<ValueRefCntPtr> getFromFile(StringRef filename);
+  static Optional<ValueRefCntPtr>
+  getFromFile(StringRef filename, StringRef NamePrefix = StringRef());
 };
 
 struct RequestedCachedModule {
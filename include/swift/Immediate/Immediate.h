@@ -18,11 +18,13 @@
 #ifndef SWIFT_IMMEDIATE_H
 #define SWIFT_IMMEDIATE_H
 
+#include "swift/Basic/LLVM.h"
 #include <string>
 #include <vector>
 
 namespace swift {
   class CompilerInstance;
+  class CompilerInvocation;
   class IRGenOptions;
   class SILOptions;
 
@@ -33,11 +35,35 @@ namespace swift {
   using ProcessCmdLine = std::vector<std::string>;
   
 
+  /// Compute the key under which the object code of the script described by
+  /// \p Invocation is cached, from the contents of its input files, the
+  /// compiler version and the frontend arguments \p Args.
+  ///
+  /// \return the key, or an empty string if the script can't be cached
+  std::string getImmediateCacheKey(const CompilerInvocation &Invocation,
+                                   ArrayRef<const char *> Args);
+
+  /// Attempt to run the script identified by the given compiler instance
+  /// from object code cached under \p CacheKey, without compiling it.
+  ///
+  /// The cache entry is only used if none of the files the script imported
+  /// have changed since it was written.
+  ///
+  /// \return true if the script was run, with the result returned from
+  /// main() in \p Result
+  bool RunImmediatelyFromCache(CompilerInstance &CI, StringRef CacheKey,
+                               const ProcessCmdLine &CmdLine,
+                               IRGenOptions &IRGenOpts, int &Result);
+
   /// Attempt to run the script identified by the given compiler instance.
   ///
+  /// If \p CacheKey is not empty, the object code of the script is also
+  /// stored in the immediate mode cache under that key.
+  ///
   /// \return the result returned from main(), if execution succeeded
   int RunImmediately(CompilerInstance &CI, const ProcessCmdLine &CmdLine,
-                     IRGenOptions &IRGenOpts, const SILOptions &SILOpts);
+                     IRGenOptions &IRGenOpts, const SILOptions &SILOpts,
+                     StringRef CacheKey = StringRef());
 
   void runREPL(CompilerInstance &CI, const ProcessCmdLine &CmdLine,
                bool ParseStdlib);
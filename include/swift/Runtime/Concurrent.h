@@ -11,9 +11,14 @@
 //===----------------------------------------------------------------------===//
 #ifndef SWIFT_RUNTIME_CONCURRENTUTILS_H
 #define SWIFT_RUNTIME_CONCURRENTUTILS_H
+#include "swift/Runtime/Debug.h"
 #include <iterator>
 #include <atomic>
+#include <mutex>
+#include <thread>
+#include <type_traits>
 #include <stdint.h>
+#include <stdlib.h>
 
 /// This is a node in a concurrent linked list.
 template <class ElemTy> struct ConcurrentListNode {
@@ -115,110 +120,275 @@ template <class ElemTy> struct ConcurrentList {
     }
   }
 
+  /// Add a new item to the list unless \p IsDuplicate returns true for an
+  /// item that is already in it. Items that other threads push at the same
+  /// time are checked too, so concurrent callers never add duplicates of each
+  /// other's items.
+  ///
+  /// \returns true if the item was added.
+  template <class PredTy>
+  bool push_front_unique(ElemTy Elem, PredTy IsDuplicate) {
+    ConcurrentListNode<ElemTy> *N = nullptr;
+    auto OldFirst = First.load(std::memory_order_acquire);
+    auto Checked = decltype(OldFirst)(nullptr);
+    while (true) {
+      // Only the links added since the last attempt need to be checked.
+      for (auto Ptr = OldFirst; Ptr != Checked; Ptr = Ptr->Next) {
+        if (IsDuplicate(Ptr->Payload)) {
+          delete N;
+          return false;
+        }
+      }
+      Checked = OldFirst;
+
+      if (!N)
+        N = new ConcurrentListNode<ElemTy>(Elem);
+      N->Next = OldFirst;
+      if (std::atomic_compare_exchange_weak_explicit(&First, &OldFirst, N,
+                                                 std::memory_order_release,
+                                                 std::memory_order_acquire))
+        return true;
+    }
+  }
+
   /// Points to the first link in the list.
   std::atomic<ConcurrentListNode<ElemTy> *> First;
 };
 
 template <class KeyTy, class ValueTy> struct ConcurrentMapNode {
-  ConcurrentMapNode(KeyTy H)
-      : Left(nullptr), Right(nullptr), Key(H), Payload() {}
-
-  ~ConcurrentMapNode() {
-    delete Left.load(std::memory_order_acquire);
-    delete Right.load(std::memory_order_acquire);
-  }
+  ConcurrentMapNode(KeyTy H) : Key(H), Payload() {}
 
   ConcurrentMapNode(const ConcurrentMapNode &) = delete;
   ConcurrentMapNode &operator=(const ConcurrentMapNode &) = delete;
 
-  typedef std::atomic<ConcurrentMapNode *> EdgeTy;
-  EdgeTy Left;
-  EdgeTy Right;
   KeyTy Key;
   ValueTy Payload;
 };
 
-/// A concurrent map that is implemented using a binary tree. It supports
-/// concurrent insertions but does not support removals or rebalancing of
-/// the tree. Much like the concurrent linked list this data structure
-/// does not support the removal of nodes, which is more difficult.
-/// The method findOrAllocateNode searches the binary tree in search of the
-/// exact Key value. If it finds an edge that points to NULL that should
-/// contain the value then it tries to compare and swap the new node into
-/// place. If it looses the race to a different thread it de-allocates
-/// the node and starts the search again since the new node should
-/// be placed (or found) on the new link. See findOrAllocateNode for more
-/// details.
+/// A concurrent map that is implemented as an open-addressed hash table with
+/// linear probing. It supports concurrent insertions but, like the concurrent
+/// linked list, does not support the removal of nodes.
+///
+/// Each slot in the table holds the key inline next to a pointer to the node
+/// that owns the payload, so a probe sequence only touches the table itself
+/// until the matching slot is found. Lookups never lock, never spin and never
+/// retry: they perform a bounded probe over a snapshot of the table.
+///
+/// Inserting a key first reserves an empty slot by swapping in a 'Busy'
+/// marker, then writes the key and publishes the node. When the table gets
+/// three quarters full, a thread takes the growth lock and copies the nodes
+/// into a table twice as large, replacing every empty slot of the old table
+/// with a 'Moved' marker so that no insertion can be lost. Readers keep using
+/// whichever table they loaded; superseded tables are only freed together
+/// with the map, since a reader may still be probing them.
 template <class KeyTy, class ValueTy> class ConcurrentMap {
 public:
-  ConcurrentMap() : Sentinel(0), LastSearch(&Sentinel) {}
+  typedef ConcurrentMapNode<KeyTy, ConcurrentList<ValueTy>> NodeTy;
 
-  ConcurrentMap(const ConcurrentMap &) = delete;
-  ConcurrentMap &operator=(const ConcurrentMap &) = delete;
+private:
+  static_assert(std::is_integral<KeyTy>::value,
+                "ConcurrentMap keys must be integral hash values");
 
-  /// A Sentinel root node that contains no elements.
-  typedef ConcurrentMapNode<KeyTy, ConcurrentList<ValueTy>> NodeTy;
-  NodeTy Sentinel;
+  /// A slot in the hash table. The key is only valid once Node holds a real
+  /// node; it is written before Node is published with release semantics.
+  struct Slot {
+    std::atomic<NodeTy *> Node;
+    KeyTy Key;
+  };
 
-  /// This value stores the last node that we searched. This is useful for
-  /// accelerating the search of the same value again and again.
-  std::atomic<NodeTy *> LastSearch;
+  /// A hash table whose capacity is a power of two. All-zero is the empty
+  /// state for its slots.
+  struct Table {
+    Table *Previous;
+    size_t Capacity;
+    Slot Slots[1];
 
-  /// Search a for a node with key value \p. If the node does not exist then
-  /// allocate a new bucket and add it to the tree.
-  ConcurrentList<ValueTy> &findOrAllocateNode(KeyTy Key) {
-    // Try looking at the last node we searched.
-    NodeTy *Last = LastSearch.load(std::memory_order_acquire);
-    if (Last->Key == Key)
-      return Last->Payload;
+    static Table *allocate(size_t Capacity, Table *Previous) {
+      auto T = reinterpret_cast<Table *>(
+        calloc(1, sizeof(Table) + (Capacity - 1) * sizeof(Slot)));
+      if (!T)
+        swift::crash("Could not allocate memory.");
+      T->Previous = Previous;
+      T->Capacity = Capacity;
+      return T;
+    }
+  };
+
+  enum : size_t { InitialCapacity = 16 };
+
+  /// Marks a slot that is reserved by an insertion in progress.
+  static NodeTy *getBusyMarker() { return reinterpret_cast<NodeTy *>(1); }
+  /// Marks an empty slot of a table that has been superseded.
+  static NodeTy *getMovedMarker() { return reinterpret_cast<NodeTy *>(2); }
+  static bool isRealNode(NodeTy *N) { return uintptr_t(N) > 2; }
 
-    // Search the binary tree.
-    NodeTy *Found = findOrAllocateNode_rec(&Sentinel, Key);
+  /// The current table.
+  std::atomic<Table *> Current;
 
-    // Save the node that we found, in case we look for the same value again.
-    LastSearch.store(Found,std:: memory_order_release);
-    return Found->Payload;
+  /// The number of nodes in the map. Only ever incremented, by the thread
+  /// that inserts each node.
+  std::atomic<size_t> Count;
+
+  /// Serializes growth of the table. Never taken by lookups.
+  std::mutex GrowthLock;
+
+  /// Mix the key so that aligned pointer-based hashes spread over the table.
+  static size_t getStartIndex(KeyTy Key, size_t Capacity) {
+    size_t H = size_t(Key);
+    H ^= H >> (sizeof(size_t) * 4);
+    H *= size_t(0xff51afd7ed558ccdULL);
+    H ^= H >> (sizeof(size_t) * 4 - 3);
+    return H & (Capacity - 1);
   }
 
-private:
-  static NodeTy *findOrAllocateNode_rec(NodeTy *P, KeyTy Key) {
-    // Found the node we were looking for.
-    if (P->Key == Key)
-      return P;
-
-    // Point to the edge we want to replace.
-    typename NodeTy::EdgeTy *Edge = nullptr;
-
-    // The current edge value.
-    NodeTy *CurrentVal;
-
-    // Select the edge to follow.
-    if (P->Key > Key) {
-      CurrentVal = P->Left.load(std::memory_order_acquire);
-      if (CurrentVal) return findOrAllocateNode_rec(CurrentVal, Key);
-      Edge = &P->Left;
-    } else {
-      CurrentVal = P->Right.load(std::memory_order_acquire);
-      if (CurrentVal) return findOrAllocateNode_rec(CurrentVal, Key);
-      Edge = &P->Right;
+public:
+  ConcurrentMap()
+    : Current(Table::allocate(InitialCapacity, nullptr)), Count(0) {}
+
+  ~ConcurrentMap() {
+    Table *T = Current.load(std::memory_order_acquire);
+    for (size_t i = 0; i < T->Capacity; ++i) {
+      NodeTy *N = T->Slots[i].Node.load(std::memory_order_acquire);
+      if (isRealNode(N))
+        delete N;
     }
+    while (T) {
+      Table *Previous = T->Previous;
+      free(T);
+      T = Previous;
+    }
+  }
+
+  ConcurrentMap(const ConcurrentMap &) = delete;
+  ConcurrentMap &operator=(const ConcurrentMap &) = delete;
+
+  /// Search for the node with key value \p Key. Returns null if there is no
+  /// such node. This never blocks and probes at most one table.
+  NodeTy *find(KeyTy Key) const {
+    Table *T = Current.load(std::memory_order_acquire);
+    size_t Mask = T->Capacity - 1;
+    size_t Index = getStartIndex(Key, T->Capacity);
+    for (size_t Probe = 0; Probe < T->Capacity; ++Probe) {
+      Slot &S = T->Slots[(Index + Probe) & Mask];
+      NodeTy *N = S.Node.load(std::memory_order_acquire);
+      if (!N || N == getMovedMarker())
+        return nullptr;
+      if (N != getBusyMarker() && S.Key == Key)
+        return N;
+    }
+    return nullptr;
+  }
+
+  /// Search a for a node with key value \p Key. If the node does not exist
+  /// then allocate a new bucket and add it to the table.
+  ConcurrentList<ValueTy> &findOrAllocateNode(KeyTy Key) {
+    if (NodeTy *Found = find(Key))
+      return Found->Payload;
+    return insert(Key)->Payload;
+  }
+
+  /// The number of keys in the map.
+  size_t size() const { return Count.load(std::memory_order_relaxed); }
 
-    // Allocate a new node.
+private:
+  /// Find or insert the node for \p Key. This is the slow path of
+  /// findOrAllocateNode and may block on a concurrent growth of the table.
+  NodeTy *insert(KeyTy Key) {
     NodeTy *New = new NodeTy(Key);
+    while (true) {
+      Table *T = Current.load(std::memory_order_acquire);
+      size_t Mask = T->Capacity - 1;
+      size_t Index = getStartIndex(Key, T->Capacity);
+      bool Superseded = false;
+
+      for (size_t Probe = 0; Probe < T->Capacity; ++Probe) {
+        Slot &S = T->Slots[(Index + Probe) & Mask];
+        NodeTy *N = S.Node.load(std::memory_order_acquire);
+        while (true) {
+          // Wait for an insertion in progress to settle so that we know
+          // whether it is inserting our key.
+          if (N == getBusyMarker()) {
+            std::this_thread::yield();
+            N = S.Node.load(std::memory_order_acquire);
+            continue;
+          }
+          // Try to reserve an empty slot. On failure N is reloaded.
+          if (!N && !S.Node.compare_exchange_weak(N, getBusyMarker(),
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_acquire))
+            continue;
+          break;
+        }
+
+        if (N == getMovedMarker()) {
+          Superseded = true;
+          break;
+        }
+
+        if (N) {
+          if (S.Key != Key)
+            continue;
+          delete New;
+          return N;
+        }
+
+        // We own the reserved slot; publish the node.
+        S.Key = Key;
+        S.Node.store(New, std::memory_order_release);
+
+        size_t NewCount = Count.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (NewCount * 4 > T->Capacity * 3)
+          grow(T);
+        return New;
+      }
+
+      // Either the table is being replaced or it is full. Make sure a larger
+      // table is in place, then try again.
+      if (Superseded) {
+        std::lock_guard<std::mutex> WaitForGrowth(GrowthLock);
+      } else {
+        grow(T);
+      }
+    }
+  }
+
+  /// Replace the table \p Old with one twice its size, unless another thread
+  /// has already done so.
+  void grow(Table *Old) {
+    std::lock_guard<std::mutex> Guard(GrowthLock);
+    if (Current.load(std::memory_order_acquire) != Old)
+      return;
+
+    Table *New = Table::allocate(Old->Capacity * 2, Old);
+    size_t Mask = New->Capacity - 1;
+    for (size_t i = 0; i < Old->Capacity; ++i) {
+      Slot &S = Old->Slots[i];
+      NodeTy *N = S.Node.load(std::memory_order_acquire);
+      while (true) {
+        // Close empty slots to further insertions.
+        if (!N && S.Node.compare_exchange_strong(N, getMovedMarker(),
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire))
+          break;
+        if (isRealNode(N))
+          break;
+        // An insertion into this slot is in progress.
+        std::this_thread::yield();
+        N = S.Node.load(std::memory_order_acquire);
+      }
+      if (!isRealNode(N))
+        continue;
 
-    // Try to set a new node:
-    if (std::atomic_compare_exchange_weak_explicit(Edge, &CurrentVal, New,
-                                                   std::memory_order_release,
-                                                   std::memory_order_relaxed)){
-      // On success return the new node.
-      return New;
+      size_t Index = getStartIndex(S.Key, New->Capacity);
+      while (New->Slots[Index].Node.load(std::memory_order_relaxed))
+        Index = (Index + 1) & Mask;
+      New->Slots[Index].Key = S.Key;
+      New->Slots[Index].Node.store(N, std::memory_order_relaxed);
     }
 
-    // If failed, deallocate the node and look for a new place in the
-    // tree. Some other thread may have created a new entry and we may
-    // discover it, so start searching with the current node.
-    delete New;
-    return findOrAllocateNode_rec(P, Key);
+    // Count isn't touched: every node was counted once by the thread that
+    // inserted it, whichever table it ended up in.
+    Current.store(New, std::memory_order_release);
   }
 };
 
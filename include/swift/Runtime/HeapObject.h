@@ -162,6 +162,18 @@ extern "C" void *swift_slowAlloc(size_t bytes, size_t alignMask);
 // then call these corresponding APIs:
 extern "C" void swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask);
 
+// Returns the number of usable bytes in an allocation returned by
+// swift_slowAlloc, which is at least the number of bytes requested.
+extern "C" size_t swift_slowAllocSize(const void *ptr);
+
+/// Returns the number of usable bytes in the allocation of an object
+/// returned by swift_allocObject, counted from the start of the object.
+/// This is at least the size that was requested.
+///
+/// Unlike swift_slowAllocSize, this accounts for objects that don't start
+/// at the beginning of their allocation.
+extern "C" size_t swift_allocObjectSize(const HeapObject *object);
+
 /// Atomically increments the retain count of an object.
 ///
 /// \param object - may be null, in which case this is a no-op
@@ -230,6 +242,22 @@ extern "C" void swift_release_n(HeapObject *object, uint32_t n);
 extern "C" size_t swift_retainCount(HeapObject *object);
 extern "C" size_t swift_weakRetainCount(HeapObject *object);
 
+/// Bias the strong reference counts of objects allocated from now on toward
+/// the thread that allocates them, so that the allocating thread can retain
+/// and release them without atomic operations.  Other threads fall back to
+/// atomic operations on the object header.  It should be called early,
+/// before other threads start using Swift objects.
+///
+/// Returns false if the runtime was built without support for biased
+/// reference counting.
+extern "C" bool swift_enableBiasedRefCounting();
+
+/// Restore the default allocation and reference counting entry points after
+/// swift_enableBiasedRefCounting.  This is meant for tests: it must only be
+/// called once every biased object has been deallocated and no other thread
+/// is using Swift objects.
+extern "C" void swift_disableBiasedRefCounting();
+
 /// Is this pointer a non-null unique reference to an object
 /// that uses Swift reference counting?
 extern "C" bool swift_isUniquelyReferencedNonObjC(const void *);
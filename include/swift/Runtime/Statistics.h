@@ -0,0 +1,72 @@
+//===--- Statistics.h - Swift Runtime Statistics ----------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Counters of runtime events, such as retains, releases, allocations and
+// metadata and conformance cache misses, that can be inspected in-process.
+//
+// Counting is off by default and costs a single predictable branch per
+// event. Setting the SWIFT_RUNTIME_STATISTICS environment variable turns it
+// on when the runtime first counts an event, and dumps the counters to stderr
+// when the process exits.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_RUNTIME_STATISTICS_H
+#define SWIFT_RUNTIME_STATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace swift {
+
+struct HeapMetadata;
+
+/// The runtime events that are counted.
+enum class RuntimeStatistic : unsigned {
+#define RUNTIME_STATISTIC(Name, Description) Name,
+#include "swift/Runtime/Statistics.def"
+};
+
+/// Start or stop counting runtime events on all threads. Counts gathered
+/// so far are kept.
+extern "C" void swift_setRuntimeStatisticsEnabled(bool enabled);
+
+/// Are runtime events being counted?
+extern "C" bool swift_areRuntimeStatisticsEnabled();
+
+/// Returns the number of runtime statistics.
+extern "C" size_t swift_getNumRuntimeStatistics();
+
+/// Returns a description of the runtime statistic with the given index.
+extern "C" const char *swift_getRuntimeStatisticName(size_t index);
+
+/// Returns the value of the runtime statistic with the given index, summed
+/// over all threads, including threads that have exited.
+extern "C" uint64_t swift_getRuntimeStatistic(size_t index);
+
+typedef void (*AllocationStatisticCallback)(const HeapMetadata *metadata,
+                                            uint64_t count,
+                                            void *context);
+
+/// Calls \p callback with the number of objects allocated for each heap
+/// metadata, summed over all threads. Allocations that didn't fit in the
+/// per-thread tables are reported with a null metadata.
+extern "C" void
+swift_enumerateAllocationStatistics(AllocationStatisticCallback callback,
+                                    void *context);
+
+/// Prints the runtime statistics and the most allocated types to stderr.
+extern "C" void swift_dumpRuntimeStatistics();
+
+} // end namespace swift
+
+#endif /* SWIFT_RUNTIME_STATISTICS_H */
@@ -160,6 +160,10 @@ private:
   /// if the pass manager requested to stop the execution
   /// of the optimization cycle (this is a debug feature).
   bool runFunctionPasses(PassList FuncTransforms);
+
+  /// Run the passes in \p FuncTransforms on \p F. Return true if the pass
+  /// manager requested to stop the execution of the optimization cycle.
+  bool runPassesOnFunction(PassList FuncTransforms, SILFunction *F);
 };
 
 } // end namespace swift
@@ -284,6 +284,18 @@ private:
 
   std::unique_ptr<SerializedObjCMethodTable> ObjCMethods;
 
+  class DeclMemberNamesTableInfo;
+  using SerializedDeclMemberNamesTable =
+    llvm::OnDiskIterableChainedHashTable<DeclMemberNamesTableInfo>;
+
+  /// Maps a member list's offset and a base name to the members with that
+  /// name.
+  std::unique_ptr<SerializedDeclMemberNamesTable> DeclMemberNames;
+
+  /// For each member list that has been searched by name, the number of its
+  /// members that haven't been deserialized through the list.
+  llvm::DenseMap<uint64_t, unsigned> MembersNotLoadedByOffset;
+
   llvm::DenseMap<const ValueDecl *, Identifier> PrivateDiscriminatorsByValue;
 
   TinyPtrVector<Decl *> ImportDecls;
@@ -388,6 +400,11 @@ private:
   std::unique_ptr<ModuleFile::SerializedObjCMethodTable>
   readObjCMethodTable(ArrayRef<uint64_t> fields, StringRef blobData);
 
+  /// Read an on-disk member name table stored in
+  /// index_block::DeclMemberNamesLayout format.
+  std::unique_ptr<ModuleFile::SerializedDeclMemberNamesTable>
+  readDeclMemberNamesTable(ArrayRef<uint64_t> fields, StringRef blobData);
+
   /// Reads the index block, which contains global tables.
   ///
   /// Returns false if there was an error.
@@ -592,6 +609,11 @@ public:
                               uint64_t contextData,
                               bool *ignored) override;
 
+  virtual bool loadNamedMembers(const IterableDeclContext *IDC,
+                                Identifier baseName,
+                                uint64_t contextData,
+                                SmallVectorImpl<ValueDecl *> &members) override;
+
   virtual void
   loadAllConformances(const Decl *D, uint64_t contextData,
                       SmallVectorImpl<ProtocolConformance*> &Conforms) override;
@@ -51,7 +51,7 @@ const uint16_t VERSION_MAJOR = 0;
 /// To ensure that two separate changes don't silently get merged into one
 /// in source control, you should also update the comment to briefly
 /// describe what change you made.
-const uint16_t VERSION_MINOR = 222; // Last change: @_fixed_layout
+const uint16_t VERSION_MINOR = 224; // Last change: 64-bit member name keys
 
 using DeclID = Fixnum<31>;
 using DeclIDField = BCFixed<31>;
@@ -1422,6 +1422,10 @@ namespace index_block {
     DECL_CONTEXT_OFFSETS,
     LOCAL_TYPE_DECLS,
     NORMAL_CONFORMANCE_OFFSETS,
+
+    /// The member name index, which maps a member list (by its offset) and
+    /// a base name to the members of that list with that name.
+    DECL_MEMBER_NAMES,
   };
 
   using OffsetsLayout = BCGenericRecordLayout<
@@ -1441,6 +1445,13 @@ namespace index_block {
     BCBlob         // map from Objective-C selectors to methods with that selector
   >;
 
+  using DeclMemberNamesLayout = BCRecordLayout<
+    DECL_MEMBER_NAMES,  // record ID
+    BCVBR<16>,          // table offset within the blob (see below)
+    BCBlob              // map from member list offsets and base names to
+                        // member decl IDs
+  >;
+
   using EntryPointLayout = BCRecordLayout<
     ENTRY_POINT,
     DeclIDField  // the ID of the main class; 0 if there was a main source file
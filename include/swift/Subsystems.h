@@ -151,7 +151,11 @@ namespace swift {
 
     /// Indicates that the type checker is checking code that will be
     /// immediately executed.
-    ForImmediateMode = 1 << 2
+    ForImmediateMode = 1 << 2,
+
+    /// If set, dumps wall time and constraint solver work taken to check
+    /// each expression and function body to llvm::errs(), slowest first.
+    DebugTimeExpressionTypeChecking = 1 << 3
   };
 
   /// Once parsing and name-binding are complete, this walks the AST to resolve
@@ -3636,3 +3636,16 @@ const InheritedNameSet *ASTContext::getAllPropertyNames(
 
   return known->second.get();
 }
+
+void ASTContext::forgetAllPropertyNames(const clang::ASTContext &clangCtx) {
+  // Only sets from the same Clang AST can refer to these as parents, so they
+  // all go away together.
+  SmallVector<std::pair<const clang::ObjCInterfaceDecl *, char>, 4> stale;
+  for (const auto &entry : Impl.AllPropertiesObjC) {
+    if (&entry.first.first->getASTContext() == &clangCtx)
+      stale.push_back(entry.first);
+  }
+
+  for (const auto &key : stale)
+    Impl.AllPropertiesObjC.erase(key);
+}
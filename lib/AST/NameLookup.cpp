@@ -25,8 +25,17 @@
 #include "swift/Basic/SourceManager.h"
 #include "swift/Basic/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/TinyPtrVector.h"
 
+#define DEBUG_TYPE "Name lookup"
+
+STATISTIC(NumLookupsByName,
+          "# of member lookups that didn't load all members");
+STATISTIC(NumLookupsLoadingAllMembers,
+          "# of member lookups that loaded all members");
+
 using namespace swift;
 
 void DebuggerClient::anchor() {}
@@ -688,6 +697,14 @@ class swift::MemberLookupTable {
   /// Lookup table mapping names to the set of declarations with that name.
   LookupTable Lookup;
 
+  /// The contexts whose members have been added to the table by base name,
+  /// while other members of those contexts may not have been loaded yet.
+  ///
+  /// An empty base name records that the members already present in the
+  /// context have been added.
+  llvm::DenseSet<std::pair<const IterableDeclContext *, Identifier>>
+    NamedMembersAdded;
+
 public:
   /// Create a new member lookup table.
   explicit MemberLookupTable(ASTContext &ctx);
@@ -704,6 +721,15 @@ public:
   /// \brief Add the given members to the lookup table.
   void addMembers(DeclRange members);
 
+  /// \brief Note that the members of \p context with the given base name
+  /// have been added to the table.
+  ///
+  /// \returns false if this was already noted.
+  bool noteNamedMembersAdded(const IterableDeclContext *context,
+                             Identifier baseName) {
+    return NamedMembersAdded.insert({context, baseName}).second;
+  }
+
   /// \brief The given extension has been extended with new members; add them
   /// if appropriate.
   void addExtensionMembers(NominalTypeDecl *nominal,
@@ -914,6 +940,50 @@ void NominalTypeDecl::prepareLookupTable(bool ignoreNewExtensions) {
   }
 }
 
+bool NominalTypeDecl::prepareLookupTableForName(Identifier baseName) {
+  // If we haven't allocated the lookup table yet, do so now.
+  if (!LookupTable.getPointer()) {
+    auto &ctx = getASTContext();
+    LookupTable.setPointer(new (ctx) MemberLookupTable(ctx));
+  }
+  auto table = LookupTable.getPointer();
+
+  // Members come from this type and all of its extensions. Finding the
+  // extensions doesn't load their members.
+  SmallVector<IterableDeclContext *, 4> contexts;
+  contexts.push_back(this);
+  for (auto ext : getExtensions())
+    contexts.push_back(ext);
+
+  SmallVector<ValueDecl *, 4> members;
+  for (auto context : contexts) {
+    // Members that are already in the context are added once; members
+    // added later reach the table through addedMember().
+    if (!context->isLazy()) {
+      if (table->noteNamedMembersAdded(context, Identifier()))
+        table->addMembers(context->getMembers());
+      continue;
+    }
+
+    if (table->noteNamedMembersAdded(context, Identifier()))
+      table->addMembers(context->getCurrentMembersWithoutLoading());
+
+    if (!table->noteNamedMembersAdded(context, baseName))
+      continue;
+
+    members.clear();
+    if (!context->getLoader()->loadNamedMembers(context, baseName,
+                                                context->getLoaderContextData(),
+                                                members))
+      return false;
+
+    for (auto member : members)
+      table->addMember(member);
+  }
+
+  return true;
+}
+
 void NominalTypeDecl::makeMemberVisible(ValueDecl *member) {
   if (!LookupTable.getPointer()) {
     auto &ctx = getASTContext();
@@ -925,15 +995,35 @@ void NominalTypeDecl::makeMemberVisible(ValueDecl *member) {
 
 ArrayRef<ValueDecl *> NominalTypeDecl::lookupDirect(DeclName name,
                                                     bool ignoreNewExtensions) {
+  // If we haven't walked all of the members yet, try to bring in only the
+  // members with this name.
+  if (!LookupTable.getInt() && !ignoreNewExtensions &&
+      getASTContext().LangOpts.NamedLazyMemberLoading &&
+      prepareLookupTableForName(name.getBaseName())) {
+    ++NumLookupsByName;
+
+    auto known = LookupTable.getPointer()->find(name);
+    if (known == LookupTable.getPointer()->end())
+      return { };
+
+    return { known->second.begin(), known->second.size() };
+  }
+
   // Make sure we have the complete list of members (in this nominal and in all
   // extensions).
+  bool loadsMembers = isLazy();
   if (!ignoreNewExtensions) {
-    for (auto E : getExtensions())
+    for (auto E : getExtensions()) {
+      loadsMembers |= E->isLazy();
       (void)E->getMembers();
+    }
   }
 
   (void)getMembers();
 
+  if (loadsMembers)
+    ++NumLookupsLoadingAllMembers;
+
   prepareLookupTable(ignoreNewExtensions);
 
   // Look for the declarations with this name.
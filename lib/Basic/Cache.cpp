@@ -14,12 +14,17 @@
 #include "Darwin/Cache-Mac.cpp"
 #else
 
-//  This file implements a default caching implementation that never evicts
-//  its entries.
+//  This file implements a default caching implementation. It keeps its
+//  entries in least-recently-used order and evicts the oldest ones once the
+//  total cost of the cached values exceeds the cost limit.
 
 #include "swift/Basic/Cache.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Mutex.h"
+#include <list>
+#if defined(__unix__)
+#include <unistd.h>
+#endif
 
 using namespace swift::sys;
 using llvm::StringRef;
@@ -33,12 +38,20 @@ struct DefaultCacheKey {
   DefaultCacheKey(void *Key, CacheImpl::CallBacks *CBs) : Key(Key), CBs(CBs) {}
 };
 
-struct DefaultCache {
-  llvm::sys::Mutex Mux;
-  CacheImpl::CallBacks CBs;
-  llvm::DenseMap<DefaultCacheKey, void *> Entries;
+struct DefaultCacheEntry {
+  void *Key;
+  void *Value;
+  size_t Cost;
+};
 
-  explicit DefaultCache(CacheImpl::CallBacks CBs) : CBs(std::move(CBs)) { }
+/// Tracks a value that is either in the cache or still retained by a client.
+///
+/// Each cache entry holding the value counts as one reference, as does each
+/// retain. The value destroy callback is invoked once per entry that held the
+/// value, when the last reference goes away.
+struct DefaultCacheValueState {
+  unsigned RefCount = 0;
+  unsigned PendingDestroys = 0;
 };
 } // end anonymous namespace
 
@@ -67,8 +80,77 @@ template<> struct DenseMapInfo<DefaultCacheKey> {
 };
 }
 
+namespace {
+struct DefaultCache {
+  typedef std::list<DefaultCacheEntry> EntryList;
+
+  llvm::sys::Mutex Mux;
+  CacheImpl::CallBacks CBs;
+  /// The entries, most recently used first.
+  EntryList LRU;
+  llvm::DenseMap<DefaultCacheKey, EntryList::iterator> Entries;
+  llvm::DenseMap<void *, DefaultCacheValueState> Values;
+  size_t TotalCost = 0;
+  size_t CostLimit;
+
+  DefaultCache(CacheImpl::CallBacks CBs, size_t CostLimit)
+    : CBs(std::move(CBs)), CostLimit(CostLimit) { }
+
+  void retainValue(void *Value) {
+    ++Values[Value].RefCount;
+  }
+
+  void releaseValue(void *Value, bool FromEntry) {
+    auto Found = Values.find(Value);
+    assert(Found != Values.end() && "releasing a value that isn't retained");
+    DefaultCacheValueState &State = Found->second;
+    assert(State.RefCount != 0);
+    if (FromEntry)
+      ++State.PendingDestroys;
+    if (--State.RefCount != 0)
+      return;
+    unsigned PendingDestroys = State.PendingDestroys;
+    Values.erase(Found);
+    for (unsigned i = 0; i != PendingDestroys; ++i)
+      CBs.valueDestroyCB(Value, CBs.UserData);
+  }
+
+  /// Removes \p Entry. Its key is destroyed right away, its value once it is
+  /// no longer retained.
+  void removeEntry(EntryList::iterator Entry) {
+    Entries.erase(DefaultCacheKey(Entry->Key, &CBs));
+    TotalCost -= Entry->Cost;
+    void *Key = Entry->Key;
+    void *Value = Entry->Value;
+    LRU.erase(Entry);
+    CBs.keyDestroyCB(Key, CBs.UserData);
+    releaseValue(Value, /*FromEntry=*/true);
+  }
+
+  /// Evicts least recently used entries until the total cost is within the
+  /// limit.
+  void evictIfNeeded() {
+    while (TotalCost > CostLimit && !LRU.empty())
+      removeEntry(std::prev(LRU.end()));
+  }
+};
+} // end anonymous namespace
+
+/// The default cost limit of a cache: a quarter of the physical memory, or
+/// 512 MB if that can't be determined.
+static size_t getDefaultCostLimit() {
+  size_t Limit = size_t(512) << 20;
+#if defined(__unix__) && defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+  long Pages = sysconf(_SC_PHYS_PAGES);
+  long PageSize = sysconf(_SC_PAGESIZE);
+  if (Pages > 0 && PageSize > 0)
+    Limit = size_t(Pages) / 4 * size_t(PageSize);
+#endif
+  return Limit;
+}
+
 CacheImpl::ImplTy CacheImpl::create(StringRef Name, const CallBacks &CBs) {
-  return new DefaultCache(CBs);
+  return new DefaultCache(CBs, getDefaultCostLimit());
 }
 
 void CacheImpl::setAndRetain(void *Key, void *Value, size_t Cost) {
@@ -77,16 +159,23 @@ void CacheImpl::setAndRetain(void *Key, void *Value, size_t Cost) {
 
   DefaultCacheKey CKey(Key, &DCache.CBs);
   auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    DCache.CBs.keyDestroyCB(Entry->first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry->second, nullptr);
-    DCache.Entries.erase(Entry);
+  if (Entry != DCache.Entries.end())
+    DCache.removeEntry(Entry->second);
+
+  // One reference for the entry and one for the caller.
+  DCache.retainValue(Value);
+  DCache.retainValue(Value);
+  DCache.LRU.push_front({ Key, Value, Cost });
+  DCache.Entries[CKey] = DCache.LRU.begin();
+  DCache.TotalCost += Cost;
+
+  // A value that can't fit at all shouldn't flush the rest of the cache. The
+  // caller's reference keeps it alive until it is released.
+  if (Cost > DCache.CostLimit) {
+    DCache.removeEntry(DCache.LRU.begin());
+    return;
   }
-
-  DCache.Entries[CKey] = Value;
-
-  // FIXME: Not thread-safe! It should avoid deleting the value until
-  // 'releaseValue is called on it.
+  DCache.evictIfNeeded();
 }
 
 bool CacheImpl::getAndRetain(const void *Key, void **Value_out) {
@@ -95,17 +184,23 @@ bool CacheImpl::getAndRetain(const void *Key, void **Value_out) {
 
   DefaultCacheKey CKey(const_cast<void*>(Key), &DCache.CBs);
   auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    // FIXME: Not thread-safe! It should avoid deleting the value until
-    // 'releaseValue is called on it.
-    *Value_out = Entry->second;
-    return true;
+  if (Entry == DCache.Entries.end()) {
+    ++Misses;
+    return false;
   }
-  return false;
+
+  ++Hits;
+  auto Pos = Entry->second;
+  DCache.LRU.splice(DCache.LRU.begin(), DCache.LRU, Pos);
+  DCache.retainValue(Pos->Value);
+  *Value_out = Pos->Value;
+  return true;
 }
 
 void CacheImpl::releaseValue(void *Value) {
-  // FIXME: Implementation.
+  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
+  llvm::sys::ScopedLock L(DCache.Mux);
+  DCache.releaseValue(Value, /*FromEntry=*/false);
 }
 
 bool CacheImpl::remove(const void *Key) {
@@ -115,9 +210,7 @@ bool CacheImpl::remove(const void *Key) {
   DefaultCacheKey CKey(const_cast<void*>(Key), &DCache.CBs);
   auto Entry = DCache.Entries.find(CKey);
   if (Entry != DCache.Entries.end()) {
-    DCache.CBs.keyDestroyCB(Entry->first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry->second, nullptr);
-    DCache.Entries.erase(Entry);
+    DCache.removeEntry(Entry->second);
     return true;
   }
   return false;
@@ -127,11 +220,16 @@ void CacheImpl::removeAll() {
   DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
   llvm::sys::ScopedLock L(DCache.Mux);
 
-  for (auto Entry : DCache.Entries) {
-    DCache.CBs.keyDestroyCB(Entry.first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry.second, nullptr);
-  }
-  DCache.Entries.clear();
+  while (!DCache.LRU.empty())
+    DCache.removeEntry(DCache.LRU.begin());
+}
+
+void CacheImpl::setCostLimit(size_t Limit) {
+  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
+  llvm::sys::ScopedLock L(DCache.Mux);
+
+  DCache.CostLimit = Limit;
+  DCache.evictIfNeeded();
 }
 
 void CacheImpl::destroy() {
@@ -49,7 +49,12 @@ void CacheImpl::setAndRetain(void *Key, void *Value, size_t Cost) {
 bool CacheImpl::getAndRetain(const void *Key, void **Value_out) {
   int Ret = cache_get_and_retain(static_cast<cache_t*>(Impl),
                                  const_cast<void*>(Key), Value_out);
-  return Ret == 0;
+  if (Ret == 0) {
+    ++Hits;
+    return true;
+  }
+  ++Misses;
+  return false;
 }
 
 void CacheImpl::releaseValue(void *Value) {
@@ -65,6 +70,10 @@ void CacheImpl::removeAll() {
   cache_remove_all(static_cast<cache_t*>(Impl));
 }
 
+void CacheImpl::setCostLimit(size_t Limit) {
+  cache_set_cost_hint(static_cast<cache_t*>(Impl), Limit);
+}
+
 void CacheImpl::destroy() {
   cache_destroy(static_cast<cache_t*>(Impl));
 }
@@ -0,0 +1,255 @@
+//===--- ReferenceDependencyFile.cpp - Swift-style dependencies -----------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// The binary format is laid out as follows. All integers are 32-bit little
+// endian unless noted otherwise.
+//
+//   header:   magic, version, interface hash string (or NoString),
+//             string count, entry count
+//   strings:  string count x (offset into string data, length)
+//   entries:  entry count x (section (8 bits), flags (8 bits), reserved
+//             (16 bits), name string, member string (or NoString))
+//   string data
+//
+// The magic starts with a NUL byte, which can't start a YAML document.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/ReferenceDependencyFile.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/YAMLParser.h"
+
+using namespace swift;
+
+static const char BinaryMagic[4] = { '\0', 'S', 'D', 'P' };
+
+/// The version of the binary format. Bump this when changing the layout.
+static const uint32_t BinaryVersion = 1;
+
+static const uint32_t NoString = ~0U;
+
+static const size_t HeaderSize = 5 * sizeof(uint32_t);
+static const size_t StringRecordSize = 2 * sizeof(uint32_t);
+static const size_t EntryRecordSize = 3 * sizeof(uint32_t);
+
+enum : uint8_t {
+  EntryIsPrivate = 1 << 0
+};
+
+StringRef
+swift::getReferenceDependencySectionName(ReferenceDependencySection section) {
+  switch (section) {
+  case ReferenceDependencySection::ProvidesTopLevel:
+    return "provides-top-level";
+  case ReferenceDependencySection::ProvidesNominal:
+    return "provides-nominal";
+  case ReferenceDependencySection::ProvidesMember:
+    return "provides-member";
+  case ReferenceDependencySection::ProvidesDynamicLookup:
+    return "provides-dynamic-lookup";
+  case ReferenceDependencySection::DependsTopLevel:
+    return "depends-top-level";
+  case ReferenceDependencySection::DependsNominal:
+    return "depends-nominal";
+  case ReferenceDependencySection::DependsMember:
+    return "depends-member";
+  case ReferenceDependencySection::DependsDynamicLookup:
+    return "depends-dynamic-lookup";
+  case ReferenceDependencySection::DependsExternal:
+    return "depends-external";
+  }
+  llvm_unreachable("unhandled section");
+}
+
+//===----------------------------------------------------------------------===//
+// YAML
+//===----------------------------------------------------------------------===//
+
+YAMLReferenceDependencyWriter::YAMLReferenceDependencyWriter(raw_ostream &out)
+    : Out(out) {
+  Out << "### Swift dependencies file v0 ###\n";
+}
+
+void
+YAMLReferenceDependencyWriter::beginSection(ReferenceDependencySection section){
+  Out << getReferenceDependencySectionName(section) << ":\n";
+}
+
+void YAMLReferenceDependencyWriter::addName(StringRef name, bool isCascading) {
+  Out << "- ";
+  if (!isCascading)
+    Out << "!private ";
+  Out << "\"" << llvm::yaml::escape(name) << "\"\n";
+}
+
+void YAMLReferenceDependencyWriter::addMember(StringRef base, StringRef member,
+                                              bool isCascading) {
+  Out << "- ";
+  if (!isCascading)
+    Out << "!private ";
+  Out << "[\"" << llvm::yaml::escape(base) << "\", \""
+      << llvm::yaml::escape(member) << "\"]\n";
+}
+
+void YAMLReferenceDependencyWriter::setInterfaceHash(StringRef hash) {
+  Out << "interface-hash: \"" << hash << "\"\n";
+}
+
+//===----------------------------------------------------------------------===//
+// Binary
+//===----------------------------------------------------------------------===//
+
+BinaryReferenceDependencyWriter::BinaryReferenceDependencyWriter(
+    raw_ostream &out)
+  : Out(out), InterfaceHashIndex(NoString) {}
+
+uint32_t BinaryReferenceDependencyWriter::intern(StringRef str) {
+  auto insertResult = StringIndices.insert({str, Strings.size()});
+  if (insertResult.second)
+    Strings.push_back(insertResult.first->getKey());
+  return insertResult.first->getValue();
+}
+
+void BinaryReferenceDependencyWriter::beginSection(
+    ReferenceDependencySection section) {
+  CurrentSection = section;
+}
+
+void BinaryReferenceDependencyWriter::addName(StringRef name,
+                                              bool isCascading) {
+  assert(!isMemberSection(CurrentSection) && "use addMember");
+  Entries.push_back({CurrentSection, isCascading, intern(name), NoString});
+}
+
+void BinaryReferenceDependencyWriter::addMember(StringRef base,
+                                                StringRef member,
+                                                bool isCascading) {
+  assert(isMemberSection(CurrentSection) && "use addName");
+  Entries.push_back({CurrentSection, isCascading, intern(base),
+                     intern(member)});
+}
+
+void BinaryReferenceDependencyWriter::setInterfaceHash(StringRef hash) {
+  InterfaceHashIndex = intern(hash);
+}
+
+void BinaryReferenceDependencyWriter::finish() {
+  using namespace llvm::support;
+  endian::Writer<little> LE(Out);
+
+  Out.write(BinaryMagic, sizeof(BinaryMagic));
+  LE.write<uint32_t>(BinaryVersion);
+  LE.write<uint32_t>(InterfaceHashIndex);
+  LE.write<uint32_t>(Strings.size());
+  LE.write<uint32_t>(Entries.size());
+
+  uint32_t offset = 0;
+  for (StringRef str : Strings) {
+    LE.write<uint32_t>(offset);
+    LE.write<uint32_t>(str.size());
+    offset += str.size();
+  }
+
+  for (const Entry &entry : Entries) {
+    LE.write<uint8_t>(static_cast<uint8_t>(entry.Section));
+    LE.write<uint8_t>(entry.IsCascading ? 0 : EntryIsPrivate);
+    LE.write<uint16_t>(0);
+    LE.write<uint32_t>(entry.NameIndex);
+    LE.write<uint32_t>(entry.MemberIndex);
+  }
+
+  for (StringRef str : Strings)
+    Out << str;
+}
+
+bool swift::isBinaryReferenceDependencyFile(StringRef data) {
+  return data.startswith(StringRef(BinaryMagic, sizeof(BinaryMagic)));
+}
+
+bool swift::readBinaryReferenceDependencies(
+    StringRef data,
+    llvm::function_ref<bool(ReferenceDependencySection, StringRef, StringRef,
+                            bool)> entryCallback,
+    llvm::function_ref<bool(StringRef)> interfaceHashCallback) {
+  using namespace llvm::support;
+
+  if (!isBinaryReferenceDependencyFile(data) || data.size() < HeaderSize)
+    return false;
+
+  const char *header = data.data() + sizeof(BinaryMagic);
+  uint32_t version = endian::read32le(header);
+  uint32_t interfaceHashIndex = endian::read32le(header + 4);
+  uint32_t stringCount = endian::read32le(header + 8);
+  uint32_t entryCount = endian::read32le(header + 12);
+  if (version != BinaryVersion)
+    return false;
+
+  // Check the table sizes in 64 bits so that huge counts can't wrap around.
+  uint64_t tablesSize = uint64_t(stringCount) * StringRecordSize +
+                        uint64_t(entryCount) * EntryRecordSize;
+  if (tablesSize > data.size() - HeaderSize)
+    return false;
+
+  const char *strings = data.data() + HeaderSize;
+  const char *entries = strings + stringCount * StringRecordSize;
+  StringRef stringData = data.substr(HeaderSize + tablesSize);
+
+  // Strings are resolved lazily, so that a file only pays for the ones its
+  // entries actually use.
+  bool malformed = false;
+  auto getString = [&](uint32_t index) -> StringRef {
+    if (index >= stringCount) {
+      malformed = true;
+      return StringRef();
+    }
+    const char *record = strings + index * StringRecordSize;
+    uint32_t offset = endian::read32le(record);
+    uint32_t length = endian::read32le(record + 4);
+    if (offset > stringData.size() || length > stringData.size() - offset) {
+      malformed = true;
+      return StringRef();
+    }
+    return stringData.substr(offset, length);
+  };
+
+  if (interfaceHashIndex != NoString) {
+    StringRef hash = getString(interfaceHashIndex);
+    if (malformed || !interfaceHashCallback(hash))
+      return false;
+  }
+
+  for (uint32_t i = 0; i != entryCount; ++i) {
+    const char *record = entries + i * EntryRecordSize;
+    uint8_t rawSection = record[0];
+    uint8_t flags = record[1];
+    if (rawSection > static_cast<uint8_t>(ReferenceDependencySection::Last))
+      return false;
+    auto section = static_cast<ReferenceDependencySection>(rawSection);
+
+    StringRef name = getString(endian::read32le(record + 4));
+    uint32_t memberIndex = endian::read32le(record + 8);
+    StringRef member;
+    if (isMemberSection(section))
+      member = getString(memberIndex);
+    else if (memberIndex != NoString)
+      return false;
+    if (malformed)
+      return false;
+
+    if (!entryCallback(section, name, member, !(flags & EntryIsPrivate)))
+      return false;
+  }
+
+  return true;
+}
@@ -42,7 +42,10 @@ DummyTaskQueue::DummyTaskQueue(unsigned NumberOfParallelTasks)
 DummyTaskQueue::~DummyTaskQueue() = default;
 
 void DummyTaskQueue::addTask(const char *ExecPath, ArrayRef<const char *> Args,
-                             ArrayRef<const char *> Env, void *Context) {
+                             ArrayRef<const char *> Env, void *Context,
+                             uint64_t Cost) {
+  // Simulated tasks take no time, so they always begin in the order they were
+  // added, which keeps the simulated output stable.
   QueuedTasks.emplace(
     std::unique_ptr<DummyTask>(new DummyTask(ExecPath, Args, Env, Context)));
 }
@@ -45,6 +45,7 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Frontend/Utils.h"
 #include "clang/Serialization/ASTReader.h"
+#include "clang/Serialization/ASTWriter.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Parse/Parser.h"
 #include "clang/Rewrite/Frontend/FrontendActions.h"
@@ -54,6 +55,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SaveAndRestore.h"
 #include <algorithm>
 #include <memory>
 
@@ -138,6 +140,30 @@ namespace {
   };
 }
 
+namespace swift {
+/// Module file extension that stores a Swift lookup table in each Clang
+/// module the importer builds, and loads it from each module it reads.
+class SwiftNameLookupExtension : public clang::ModuleFileExtension {
+  ClangImporter::Implementation &Impl;
+
+public:
+  explicit SwiftNameLookupExtension(ClangImporter::Implementation &impl)
+    : Impl(impl) { }
+
+  clang::ModuleFileExtensionMetadata getExtensionMetadata() const override;
+  llvm::hash_code hashExtension(llvm::hash_code code) const override;
+
+  std::unique_ptr<clang::ModuleFileExtensionWriter>
+  createExtensionWriter(clang::ASTWriter &writer) override;
+
+  std::unique_ptr<clang::ModuleFileExtensionReader>
+  createExtensionReader(const clang::ModuleFileExtensionMetadata &metadata,
+                        clang::ASTReader &reader,
+                        clang::serialization::ModuleFile &mod,
+                        const llvm::BitstreamCursor &stream) override;
+};
+}
+
 namespace {
 class BridgingPPTracker : public clang::PPCallbacks {
   ClangImporter::Implementation &Impl;
@@ -526,6 +552,13 @@ ClangImporter::create(ASTContext &ctx,
     return nullptr;
   importer->Impl.Invocation = invocation;
 
+  // Store Swift lookup tables in the Clang modules we build, and read them
+  // back from the modules we load.
+  if (importerOpts.UseSwiftLookupTables) {
+    invocation->getFrontendOpts().ModuleFileExtensions.push_back(
+      new SwiftNameLookupExtension(importer->Impl));
+  }
+
   // Don't stop emitting messages if we ever can't load a module.
   // FIXME: This is actually a general problem: any "fatal" error could mess up
   // the CompilerInvocation.
@@ -725,6 +758,98 @@ void ClangImporter::Implementation::addEntryToLookupTable(
   }
 }
 
+clang::ModuleFileExtensionMetadata
+SwiftNameLookupExtension::getExtensionMetadata() const {
+  clang::ModuleFileExtensionMetadata metadata;
+  metadata.BlockName = "swift.lookup";
+  metadata.MajorVersion = SWIFT_LOOKUP_TABLE_VERSION_MAJOR;
+  metadata.MinorVersion = SWIFT_LOOKUP_TABLE_VERSION_MINOR;
+  metadata.UserInfo = version::getSwiftFullVersion();
+  return metadata;
+}
+
+llvm::hash_code
+SwiftNameLookupExtension::hashExtension(llvm::hash_code code) const {
+  // The table depends on how names are translated, so a different compiler
+  // or different naming options need a different module.
+  return llvm::hash_combine(code, StringRef("swift.lookup"),
+                            SWIFT_LOOKUP_TABLE_VERSION_MAJOR,
+                            SWIFT_LOOKUP_TABLE_VERSION_MINOR,
+                            version::getSwiftFullVersion(),
+                            Impl.InferImplicitProperties,
+                            Impl.OmitNeedlessWords,
+                            Impl.InferDefaultArguments);
+}
+
+std::unique_ptr<clang::ModuleFileExtensionWriter>
+SwiftNameLookupExtension::createExtensionWriter(clang::ASTWriter &writer) {
+  // Local function to populate the lookup table for the module being written.
+  auto populateTable = [this](clang::Sema &sema, SwiftLookupTable &table) {
+    // Translate names against the module's own AST. Anything cached about
+    // its declarations has to be dropped afterwards, because that AST goes
+    // away once the module has been built.
+    llvm::SaveAndRestore<clang::Sema *> writingModule(
+      Impl.ModuleBeingWrittenSema, &sema);
+    decltype(Impl.EnumConstantNamePrefixes) savedPrefixes;
+    std::swap(savedPrefixes, Impl.EnumConstantNamePrefixes);
+
+    for (auto decl : sema.Context.getTranslationUnitDecl()->noload_decls()) {
+      // Skip anything from an AST file; it belongs to another module. Also
+      // skip the builtin declarations Clang adds to every translation unit.
+      if (decl->isFromASTFile() || decl->isImplicit())
+        continue;
+
+      if (auto named = dyn_cast<clang::NamedDecl>(decl))
+        Impl.addEntryToLookupTable(table, named);
+    }
+
+    std::swap(savedPrefixes, Impl.EnumConstantNamePrefixes);
+    Impl.SwiftContext.forgetAllPropertyNames(sema.Context);
+  };
+
+  return llvm::make_unique<SwiftLookupTableWriter>(this, writer,
+                                                   populateTable);
+}
+
+std::unique_ptr<clang::ModuleFileExtensionReader>
+SwiftNameLookupExtension::createExtensionReader(
+    const clang::ModuleFileExtensionMetadata &metadata,
+    clang::ASTReader &reader,
+    clang::serialization::ModuleFile &mod,
+    const llvm::BitstreamCursor &stream) {
+  // The version is part of the module hash, but a module file can also be
+  // named explicitly; ignore tables we can't read.
+  if (metadata.MajorVersion != SWIFT_LOOKUP_TABLE_VERSION_MAJOR ||
+      metadata.MinorVersion != SWIFT_LOOKUP_TABLE_VERSION_MINOR ||
+      metadata.UserInfo != version::getSwiftFullVersion())
+    return nullptr;
+
+  // Clang instances that build other modules read these tables as well;
+  // only the ones loaded into our own AST are of any use to Swift.
+  if (&reader.getContext() != &Impl.Instance->getASTContext())
+    return nullptr;
+
+  // We only need one table per module.
+  std::string moduleName = mod.ModuleName;
+  if (Impl.LookupTables.count(moduleName))
+    return nullptr;
+
+  // Drop the table when the reader that backs it goes away.
+  auto onRemove = [this, moduleName]() {
+    Impl.LookupTables.erase(moduleName);
+  };
+
+  auto tableReader = SwiftLookupTableReader::create(this, reader, mod,
+                                                    Impl.SwiftContext,
+                                                    onRemove, stream);
+  if (!tableReader)
+    return nullptr;
+
+  Impl.LookupTables[moduleName].reset(
+    new SwiftLookupTable(tableReader.get()));
+  return std::move(tableReader);
+}
+
 bool ClangImporter::Implementation::importHeader(
     Module *adapter, StringRef headerName, SourceLoc diagLoc,
     bool trackParsedSymbols,
@@ -3031,6 +3156,60 @@ bool ClangImporter::Implementation::shouldImportAsInitializer(
 }
 
 #pragma mark Name lookup
+/// Report the preprocessor macro with the given name, if there is one that
+/// can be imported.
+static void lookupMacro(ClangImporter::Implementation &Impl, Identifier name,
+                        clang::DeclarationName clangName,
+                        VisibleDeclConsumer &consumer) {
+  clang::IdentifierInfo *clangID = clangName.getAsIdentifierInfo();
+  if (clangID && clangID->hasMacroDefinition()) {
+    if (auto clangMacro = Impl.getClangPreprocessor().getMacroInfo(clangID)) {
+      if (auto valueDecl = Impl.importMacro(name, clangMacro)) {
+        consumer.foundDecl(valueDecl, DeclVisibilityKind::VisibleAtTopLevel);
+      }
+    }
+  }
+}
+
+bool ClangImporter::Implementation::lookupValueInSwiftLookupTable(
+       StringRef moduleName, Identifier name, VisibleDeclConsumer &consumer) {
+  auto known = LookupTables.find(moduleName);
+  if (known == LookupTables.end())
+    return false;
+
+  // Only top-level declarations are visible by name.
+  SmallVector<clang::NamedDecl *, 4> scratch;
+  auto results = known->second->lookup(
+                   name, getClangASTContext().getTranslationUnitDecl(),
+                   scratch);
+
+  bool foundAny = false;
+  for (auto decl : results) {
+    auto valueDecl = dyn_cast_or_null<ValueDecl>(
+                       importDeclReal(decl->getUnderlyingDecl()));
+    if (!valueDecl)
+      continue;
+
+    // Same filtering as ClangImporter::lookupValue.
+    if (valueDecl->getDeclContext()->isModuleScopeContext() &&
+        valueDecl->getModuleContext() == getStdlibModule())
+      continue;
+    if (valueDecl->getName() != name)
+      continue;
+
+    consumer.foundDecl(valueDecl, DeclVisibilityKind::VisibleAtTopLevel);
+    foundAny = true;
+  }
+
+  if (!foundAny)
+    return false;
+
+  // Macros aren't in the table.
+  if (auto clangName = exportName(name))
+    lookupMacro(*this, name, clangName, consumer);
+  return true;
+}
+
 void ClangImporter::lookupValue(Identifier name, VisibleDeclConsumer &consumer){
   auto &pp = Impl.Instance->getPreprocessor();
   auto &sema = Impl.Instance->getSema();
@@ -3041,14 +3220,8 @@ void ClangImporter::lookupValue(Identifier name, VisibleDeclConsumer &consumer){
     return;
   
   // See if there's a preprocessor macro we can import by this name.
+  lookupMacro(Impl, name, clangName, consumer);
   clang::IdentifierInfo *clangID = clangName.getAsIdentifierInfo();
-  if (clangID && clangID->hasMacroDefinition()) {
-    if (auto clangMacro = pp.getMacroInfo(clangID)) {
-      if (auto valueDecl = Impl.importMacro(name, clangMacro)) {
-        consumer.foundDecl(valueDecl, DeclVisibilityKind::VisibleAtTopLevel);
-      }
-    }
-  }
 
   bool FoundType = false;
   bool FoundAny = false;
@@ -3721,6 +3894,14 @@ void ClangModuleUnit::lookupValue(Module::AccessPathTy accessPath,
     consumer = &darwinBlacklistConsumer;
   }
 
+  // Look for the Swift name in the module's own lookup table first. It finds
+  // declarations that were renamed on the way into Swift, which Clang's
+  // name lookup can't. Anything else falls back to Clang.
+  if (owner.Impl.UseSwiftLookupTables && clangModule &&
+      owner.Impl.lookupValueInSwiftLookupTable(
+        clangModule->getTopLevelModuleName(), name.getBaseName(), *consumer))
+    return;
+
   owner.lookupValue(name.getBaseName(), *consumer);
 }
 
@@ -4279,5 +4460,17 @@ void ClangImporter::dumpSwiftLookupTables() {
 }
 
 void ClangImporter::Implementation::dumpSwiftLookupTables() {
+  llvm::errs() << "<<Bridging header lookup table>>\n";
   BridgingHeaderLookupTable.dump();
+
+  // Sort the module names so we can print in a deterministic order.
+  SmallVector<StringRef, 4> moduleNames;
+  for (const auto &lookupTable : LookupTables)
+    moduleNames.push_back(lookupTable.getKey());
+  llvm::array_pod_sort(moduleNames.begin(), moduleNames.end());
+
+  for (auto moduleName : moduleNames) {
+    llvm::errs() << "\n<<" << moduleName << " lookup table>>\n";
+    LookupTables[moduleName]->dump();
+  }
 }
@@ -28,12 +28,14 @@
 #include "clang/APINotes/APINotesReader.h"
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Sema/Sema.h"
 #include "clang/AST/Attr.h"
 #include "llvm/ADT/APSInt.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include <set>
 
@@ -74,7 +76,9 @@ class FuncDecl;
 class Identifier;
 class Pattern;
 class SubscriptDecl;
+class SwiftNameLookupExtension;
 class ValueDecl;
+class VisibleDeclConsumer;
 
 /// \brief Describes the kind of conversion to apply to a constant value.
 enum class ConstantConvertKind {
@@ -222,6 +226,7 @@ class LLVM_LIBRARY_VISIBILITY ClangImporter::Implementation
   : public LazyMemberLoader 
 {
   friend class ClangImporter;
+  friend class SwiftNameLookupExtension;
 
 public:
   /// \brief Describes how a particular C enumeration type will be imported
@@ -269,6 +274,13 @@ private:
   /// verified.
   unsigned VerifiedImportCounter = 0;
 
+  /// The Swift lookup tables stored in loaded Clang modules, keyed by
+  /// module name.
+  ///
+  /// Each table is removed by the Clang module reader that backs it, so
+  /// this must outlive \c Instance.
+  llvm::StringMap<std::unique_ptr<SwiftLookupTable>> LookupTables;
+
   /// \brief Clang compiler invocation.
   llvm::IntrusiveRefCntPtr<clang::CompilerInvocation> Invocation;
 
@@ -295,6 +307,13 @@ private:
   /// The Swift lookup table for the bridging header.
   SwiftLookupTable BridgingHeaderLookupTable;
 
+  /// The Clang Sema of a module whose Swift lookup table is being written,
+  /// or null.
+  ///
+  /// Names are translated while the module is being built, so the Clang
+  /// accessors below must answer with that module's AST rather than ours.
+  clang::Sema *ModuleBeingWrittenSema = nullptr;
+
 public:
   /// \brief Mapping of already-imported declarations.
   llvm::DenseMap<const clang::Decl *, Decl *> ImportedDecls;
@@ -660,16 +679,22 @@ public:
 
   /// \brief Retrieve the Clang AST context.
   clang::ASTContext &getClangASTContext() const {
+    if (ModuleBeingWrittenSema)
+      return ModuleBeingWrittenSema->getASTContext();
     return Instance->getASTContext();
   }
 
   /// \brief Retrieve the Clang Sema object.
   clang::Sema &getClangSema() const {
+    if (ModuleBeingWrittenSema)
+      return *ModuleBeingWrittenSema;
     return Instance->getSema();
   }
 
   /// \brief Retrieve the Clang AST context.
   clang::Preprocessor &getClangPreprocessor() const {
+    if (ModuleBeingWrittenSema)
+      return ModuleBeingWrittenSema->getPreprocessor();
     return Instance->getPreprocessor();
   }
   
@@ -1166,6 +1191,14 @@ public:
   /// \brief Look up a name, accepting only typedef results.
   const clang::TypedefNameDecl *lookupTypedef(clang::DeclarationName);
 
+  /// Look for top-level declarations with the given Swift name in the Swift
+  /// lookup table stored in the named Clang module.
+  ///
+  /// \returns true if the table had a declaration with this name. Otherwise
+  /// the caller has to fall back to Clang's name lookup.
+  bool lookupValueInSwiftLookupTable(StringRef moduleName, Identifier name,
+                                     VisibleDeclConsumer &consumer);
+
   /// \brief Return whether a global of the given type should be imported as a
   /// 'let' declaration as opposed to 'var'.
   bool shouldImportGlobalAsLet(clang::QualType type);
@@ -15,9 +15,19 @@
 //
 //===----------------------------------------------------------------------===//
 #include "SwiftLookupTable.h"
+#include "swift/AST/ASTContext.h"
 #include "swift/Basic/STLExtras.h"
 #include "clang/AST/DeclObjC.h"
+#include "clang/Serialization/ASTReader.h"
+#include "clang/Serialization/ASTWriter.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/BitstreamWriter.h"
+#include "llvm/Bitcode/RecordLayout.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/OnDiskHashTable.h"
+
 using namespace swift;
+using namespace llvm::support;
 
 bool SwiftLookupTable::matchesContext(clang::DeclContext *foundContext,
                                       clang::DeclContext *requestedContext) {
@@ -51,6 +61,52 @@ static bool matchesExistingDecl(clang::Decl *decl, clang::Decl *existingDecl) {
   return false;
 }
 
+void SwiftLookupTable::deserializeBaseName(Identifier baseName) {
+  if (!Reader || !DeserializedBaseNames.insert(baseName).second)
+    return;
+
+  SmallVector<SwiftLookupTableReader::SerializedFullName, 2> fullNames;
+  if (!Reader->lookup(baseName.str(), fullNames))
+    return;
+
+  auto &ctx = Reader->getSwiftContext();
+  for (const auto &fullName : fullNames) {
+    // Reconstitute the full name.
+    DeclName name;
+    if (fullName.ArgumentLabels) {
+      SmallVector<Identifier, 2> argumentLabels;
+      for (auto label : *fullName.ArgumentLabels) {
+        argumentLabels.push_back(label.empty() ? Identifier()
+                                               : ctx.getIdentifier(label));
+      }
+      name = DeclName(ctx, baseName, argumentLabels);
+    } else {
+      name = baseName;
+    }
+
+    // Resolve the declarations in each context.
+    for (const auto &context : fullName.Contexts) {
+      auto dc = Reader->getContext(context.first);
+      if (!dc)
+        continue;
+
+      for (auto declID : context.second) {
+        if (auto decl = Reader->getDecl(declID))
+          addEntry(name, decl, dc);
+      }
+    }
+  }
+}
+
+void SwiftLookupTable::deserializeAll() {
+  if (!Reader)
+    return;
+
+  auto &ctx = Reader->getSwiftContext();
+  for (auto baseName : Reader->getBaseNames())
+    deserializeBaseName(ctx.getIdentifier(baseName));
+}
+
 void SwiftLookupTable::addEntry(DeclName name, clang::NamedDecl *decl,
                                 clang::DeclContext *effectiveContext) {
   clang::DeclContext *context = effectiveContext->getPrimaryContext();
@@ -91,6 +147,48 @@ void SwiftLookupTable::addEntry(DeclName name, clang::NamedDecl *decl,
   fullEntries.push_back(newEntry);
 }
 
+ArrayRef<clang::NamedDecl *>
+SwiftLookupTable::lookup(Identifier baseName,
+                         clang::DeclContext *context,
+                         SmallVectorImpl<clang::NamedDecl *> &scratch) {
+  deserializeBaseName(baseName);
+
+  scratch.clear();
+  auto known = BaseNameTable.find(baseName);
+  if (known == BaseNameTable.end())
+    return { };
+
+  // Collect the results for each of the full names.
+  SmallVector<clang::NamedDecl *, 4> fullNameScratch;
+  for (auto fullName : known->second) {
+    auto decls = lookup(fullName, context, fullNameScratch);
+    scratch.append(decls.begin(), decls.end());
+  }
+  return scratch;
+}
+
+ArrayRef<clang::NamedDecl *>
+SwiftLookupTable::lookup(DeclName name,
+                         clang::DeclContext *context,
+                         SmallVectorImpl<clang::NamedDecl *> &scratch) {
+  deserializeBaseName(name.getBaseName());
+
+  scratch.clear();
+  auto known = FullNameTable.find(name);
+  if (known == FullNameTable.end())
+    return { };
+
+  if (context)
+    context = context->getPrimaryContext();
+  for (const auto &fullEntry : known->second) {
+    if (!matchesContext(fullEntry.Context, context))
+      continue;
+
+    scratch.append(fullEntry.Decls.begin(), fullEntry.Decls.end());
+  }
+  return scratch;
+}
+
 static void printName(clang::NamedDecl *named, llvm::raw_ostream &out) {
   // If there is a name, print it.
   if (!named->getDeclName().isEmpty()) {
@@ -142,7 +240,9 @@ static void printName(clang::NamedDecl *named, llvm::raw_ostream &out) {
   }
 }
 
-void SwiftLookupTable::dump() const {
+void SwiftLookupTable::dump() {
+  deserializeAll();
+
   // Dump the base name -> full name mappings.
   SmallVector<Identifier, 4> baseNames;
   for (const auto &entry : BaseNameTable) {
@@ -205,3 +305,346 @@ void SwiftLookupTable::dump() const {
     }
   }
 }
+
+namespace {
+  enum RecordTypes {
+    /// Record that contains the mapping from base names to the full names
+    /// and entities that have them.
+    BASE_NAME_TO_ENTITIES_RECORD_ID
+      = clang::serialization::FIRST_EXTENSION_RECORD_ID,
+  };
+
+  using BaseNameToEntitiesTableRecordLayout
+    = llvm::BCRecordLayout<BASE_NAME_TO_ENTITIES_RECORD_ID,
+                           llvm::BCVBR<16>,  // table offset within the blob
+                           llvm::BCBlob>;    // the on-disk hash table
+}
+
+/// Trait used to write the on-disk hash table for the base name -> entities
+/// mapping.
+///
+/// Each entry is a list of full names, each of which is:
+///   uint16 number of argument labels plus one, or zero for a simple name
+///   for each argument label: uint16 length, then the characters
+///   uint16 number of contexts
+///   for each context:
+///     uint32 context declaration ID, or zero for the translation unit
+///     uint16 number of declarations
+///     uint32 ID of each declaration
+class SwiftLookupTableWriter::BaseNameToEntitiesTableWriterInfo {
+  SwiftLookupTable &Table;
+  clang::ASTWriter &Writer;
+
+public:
+  using key_type = Identifier;
+  using key_type_ref = key_type;
+  using data_type = SmallVector<DeclName, 2>;
+  using data_type_ref = const data_type &;
+  using hash_value_type = uint32_t;
+  using offset_type = unsigned;
+
+  BaseNameToEntitiesTableWriterInfo(SwiftLookupTable &table,
+                                    clang::ASTWriter &writer)
+    : Table(table), Writer(writer) { }
+
+  /// Argument labels may be empty, i.e. '_'.
+  static StringRef getLabelText(Identifier label) {
+    return label.empty() ? StringRef() : label.str();
+  }
+
+  hash_value_type ComputeHash(key_type_ref key) {
+    assert(!key.empty());
+    return llvm::HashString(key.str());
+  }
+
+  std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
+                                                  key_type_ref key,
+                                                  data_type_ref data) {
+    uint32_t keyLength = key.str().size();
+
+    // # of full names.
+    uint32_t dataLength = sizeof(uint16_t);
+    for (auto fullName : data) {
+      // # of argument labels, then the labels themselves.
+      dataLength += sizeof(uint16_t);
+      for (auto label : fullName.getArgumentNames())
+        dataLength += sizeof(uint16_t) + getLabelText(label).size();
+
+      // # of contexts, then each context with its declarations.
+      dataLength += sizeof(uint16_t);
+      for (const auto &entry : Table.FullNameTable.find(fullName)->second) {
+        dataLength += sizeof(uint32_t) + sizeof(uint16_t);
+        dataLength += sizeof(uint32_t) * entry.Decls.size();
+      }
+    }
+
+    endian::Writer<little> writer(out);
+    writer.write<uint16_t>(keyLength);
+    writer.write<uint32_t>(dataLength);
+    return { keyLength, dataLength };
+  }
+
+  void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
+    out << key.str();
+  }
+
+  void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
+                unsigned len) {
+    static_assert(sizeof(clang::serialization::DeclID) <= 4,
+                  "DeclID too large");
+    endian::Writer<little> writer(out);
+
+    writer.write<uint16_t>(data.size());
+    for (auto fullName : data) {
+      if (fullName.isSimpleName()) {
+        writer.write<uint16_t>(0);
+      } else {
+        auto labels = fullName.getArgumentNames();
+        writer.write<uint16_t>(labels.size() + 1);
+        for (auto label : labels) {
+          StringRef text = getLabelText(label);
+          writer.write<uint16_t>(text.size());
+          out << text;
+        }
+      }
+
+      const auto &entries = Table.FullNameTable.find(fullName)->second;
+      writer.write<uint16_t>(entries.size());
+      for (const auto &entry : entries) {
+        if (entry.Context->isTranslationUnit())
+          writer.write<uint32_t>(0);
+        else
+          writer.write<uint32_t>(
+            Writer.getDeclID(cast<clang::Decl>(entry.Context)));
+
+        writer.write<uint16_t>(entry.Decls.size());
+        for (auto decl : entry.Decls)
+          writer.write<uint32_t>(Writer.getDeclID(decl));
+      }
+    }
+  }
+};
+
+void SwiftLookupTableWriter::writeExtensionContents(
+       clang::Sema &sema,
+       llvm::BitstreamWriter &stream) {
+  // Populate the lookup table.
+  SwiftLookupTable table;
+  PopulateTable(sema, table);
+  if (table.BaseNameTable.empty())
+    return;
+
+  // Sort the base names so the output is deterministic.
+  SmallVector<Identifier, 4> baseNames;
+  for (const auto &entry : table.BaseNameTable)
+    baseNames.push_back(entry.first);
+  std::sort(baseNames.begin(), baseNames.end(),
+            [&](Identifier x, Identifier y) {
+              return x.compare(y) < 0;
+            });
+
+  SmallVector<uint64_t, 8> scratch;
+  llvm::SmallString<4096> hashTableBlob;
+  uint32_t tableOffset;
+  {
+    llvm::OnDiskChainedHashTableGenerator<BaseNameToEntitiesTableWriterInfo>
+      generator;
+    BaseNameToEntitiesTableWriterInfo info(table, Writer);
+    for (auto baseName : baseNames)
+      generator.insert(baseName, table.BaseNameTable[baseName], info);
+
+    llvm::raw_svector_ostream blobStream(hashTableBlob);
+    // Make sure that no bucket is at offset 0
+    endian::Writer<little>(blobStream).write<uint32_t>(0);
+    tableOffset = generator.Emit(blobStream, info);
+  }
+
+  BaseNameToEntitiesTableRecordLayout layout(stream);
+  layout.emit(scratch, tableOffset, hashTableBlob);
+}
+
+/// Used to deserialize the on-disk base name -> entities table.
+class SwiftLookupTableReader::BaseNameTableInfo {
+public:
+  using internal_key_type = StringRef;
+  using external_key_type = internal_key_type;
+  using data_type = SmallVector<SerializedFullName, 2>;
+  using hash_value_type = uint32_t;
+  using offset_type = unsigned;
+
+  internal_key_type GetInternalKey(external_key_type key) {
+    return key;
+  }
+
+  external_key_type GetExternalKey(internal_key_type key) {
+    return key;
+  }
+
+  hash_value_type ComputeHash(internal_key_type key) {
+    return llvm::HashString(key);
+  }
+
+  static bool EqualKey(internal_key_type lhs, internal_key_type rhs) {
+    return lhs == rhs;
+  }
+
+  static std::pair<unsigned, unsigned> ReadKeyDataLength(const uint8_t *&data) {
+    unsigned keyLength = endian::readNext<uint16_t, little, unaligned>(data);
+    unsigned dataLength = endian::readNext<uint32_t, little, unaligned>(data);
+    return { keyLength, dataLength };
+  }
+
+  static internal_key_type ReadKey(const uint8_t *data, unsigned length) {
+    return StringRef(reinterpret_cast<const char *>(data), length);
+  }
+
+  static data_type ReadData(internal_key_type key, const uint8_t *data,
+                            unsigned length) {
+    data_type result;
+    unsigned numFullNames = endian::readNext<uint16_t, little, unaligned>(data);
+    while (numFullNames--) {
+      SerializedFullName fullName;
+
+      unsigned numLabels = endian::readNext<uint16_t, little, unaligned>(data);
+      if (numLabels > 0) {
+        fullName.ArgumentLabels = SmallVector<StringRef, 2>();
+        for (--numLabels; numLabels > 0; --numLabels) {
+          unsigned labelLength =
+            endian::readNext<uint16_t, little, unaligned>(data);
+          fullName.ArgumentLabels->push_back(
+            StringRef(reinterpret_cast<const char *>(data), labelLength));
+          data += labelLength;
+        }
+      }
+
+      unsigned numContexts =
+        endian::readNext<uint16_t, little, unaligned>(data);
+      while (numContexts--) {
+        auto contextID = endian::readNext<uint32_t, little, unaligned>(data);
+        unsigned numDecls = endian::readNext<uint16_t, little, unaligned>(data);
+        SmallVector<clang::serialization::DeclID, 2> decls;
+        while (numDecls--)
+          decls.push_back(endian::readNext<uint32_t, little, unaligned>(data));
+        fullName.Contexts.push_back({ contextID, std::move(decls) });
+      }
+
+      result.push_back(std::move(fullName));
+    }
+
+    return result;
+  }
+};
+
+SwiftLookupTableReader::SwiftLookupTableReader(
+    clang::ModuleFileExtension *extension,
+    clang::ASTReader &reader,
+    clang::serialization::ModuleFile &moduleFile,
+    ASTContext &swiftContext,
+    std::function<void()> onRemove,
+    std::unique_ptr<SerializedBaseNameTable> table)
+  : ModuleFileExtensionReader(extension), Reader(reader),
+    ModFile(moduleFile), SwiftContext(swiftContext),
+    OnRemove(std::move(onRemove)), BaseNameTable(std::move(table)) { }
+
+std::unique_ptr<SwiftLookupTableReader>
+SwiftLookupTableReader::create(clang::ModuleFileExtension *extension,
+                               clang::ASTReader &reader,
+                               clang::serialization::ModuleFile &moduleFile,
+                               ASTContext &swiftContext,
+                               std::function<void()> onRemove,
+                               const llvm::BitstreamCursor &stream) {
+  // Look for the base name -> entities table record.
+  llvm::BitstreamCursor cursor = stream;
+  std::unique_ptr<SerializedBaseNameTable> table;
+  SmallVector<uint64_t, 8> scratch;
+  auto next = cursor.advance();
+  while (next.Kind != llvm::BitstreamEntry::EndBlock) {
+    if (next.Kind == llvm::BitstreamEntry::Error)
+      return nullptr;
+
+    if (next.Kind == llvm::BitstreamEntry::SubBlock) {
+      // Unknown sub-block, possibly for use by a future version of the
+      // table format.
+      if (cursor.SkipBlock())
+        return nullptr;
+
+      next = cursor.advance();
+      continue;
+    }
+
+    scratch.clear();
+    StringRef blobData;
+    unsigned kind = cursor.readRecord(next.ID, scratch, &blobData);
+    switch (kind) {
+    case BASE_NAME_TO_ENTITIES_RECORD_ID: {
+      // There should only be one table.
+      if (table)
+        return nullptr;
+
+      uint32_t tableOffset;
+      BaseNameToEntitiesTableRecordLayout::readRecord(scratch, tableOffset);
+      auto base = reinterpret_cast<const uint8_t *>(blobData.data());
+      table.reset(SerializedBaseNameTable::Create(base + tableOffset,
+                                                  base + sizeof(uint32_t),
+                                                  base));
+      break;
+    }
+
+    default:
+      // Unknown record, possibly for use by a future version of the
+      // table format.
+      break;
+    }
+
+    next = cursor.advance();
+  }
+
+  if (!table)
+    return nullptr;
+
+  return std::unique_ptr<SwiftLookupTableReader>(
+    new SwiftLookupTableReader(extension, reader, moduleFile, swiftContext,
+                               std::move(onRemove), std::move(table)));
+}
+
+SwiftLookupTableReader::~SwiftLookupTableReader() {
+  OnRemove();
+}
+
+SmallVector<StringRef, 4> SwiftLookupTableReader::getBaseNames() {
+  SmallVector<StringRef, 4> results;
+  for (auto key = BaseNameTable->key_begin(), keyEnd = BaseNameTable->key_end();
+       key != keyEnd; ++key)
+    results.push_back(*key);
+  return results;
+}
+
+bool SwiftLookupTableReader::lookup(
+       StringRef baseName,
+       SmallVectorImpl<SerializedFullName> &entries) {
+  auto known = BaseNameTable->find(baseName);
+  if (known == BaseNameTable->end())
+    return false;
+
+  auto data = *known;
+  entries.append(data.begin(), data.end());
+  return true;
+}
+
+clang::NamedDecl *
+SwiftLookupTableReader::getDecl(clang::serialization::DeclID localID) {
+  return cast_or_null<clang::NamedDecl>(
+           Reader.GetLocalDecl(ModFile, localID));
+}
+
+clang::DeclContext *
+SwiftLookupTableReader::getContext(clang::serialization::DeclID localID) {
+  if (localID == 0)
+    return Reader.getContext().getTranslationUnitDecl();
+
+  auto decl = Reader.GetLocalDecl(ModFile, localID);
+  if (!decl)
+    return nullptr;
+
+  return dyn_cast<clang::DeclContext>(decl);
+}
@@ -20,16 +20,45 @@
 #include "swift/Basic/LLVM.h"
 #include "swift/AST/Identifier.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
+#include "clang/Serialization/ASTBitCodes.h"
+#include "clang/Serialization/ModuleFileExtension.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+class BitstreamCursor;
+template <typename Info> class OnDiskIterableChainedHashTable;
+}
 
 namespace clang {
+class ASTReader;
 class NamedDecl;
 class DeclContext;
+
+namespace serialization {
+class ModuleFile;
+}
 }
 
 namespace swift {
 
+class ASTContext;
+class SwiftLookupTableReader;
+class SwiftLookupTableWriter;
+
+/// Lookup table major version number.
+///
+const uint16_t SWIFT_LOOKUP_TABLE_VERSION_MAJOR = 1;
+
+/// Lookup table minor version number.
+///
+/// When the format changes IN ANY WAY, this number should be incremented.
+const uint16_t SWIFT_LOOKUP_TABLE_VERSION_MINOR = 0;
+
 /// A lookup table that maps Swift names to the set of Clang
 /// declarations with that particular name.
 ///
@@ -62,11 +91,35 @@ class SwiftLookupTable {
   /// full Swift names based on that identifier.
   llvm::DenseMap<Identifier, SmallVector<DeclName, 2>> BaseNameTable;
 
+  /// The reader responsible for lazily loading the contents of this table,
+  /// or null if the table was built in memory.
+  SwiftLookupTableReader *Reader;
+
+  /// The base names whose entries have already been loaded from \c Reader.
+  llvm::DenseSet<Identifier> DeserializedBaseNames;
+
+  friend class SwiftLookupTableReader;
+  friend class SwiftLookupTableWriter;
+
   /// Determine whether the given context we found matches the
   /// requested context.
   bool matchesContext(clang::DeclContext *foundContext,
                       clang::DeclContext *requestedContext);
+
+  /// Load the entries with the given base name from the reader, if they
+  /// have not been loaded already.
+  void deserializeBaseName(Identifier baseName);
+
+  /// Load every entry from the reader.
+  void deserializeAll();
+
 public:
+  explicit SwiftLookupTable(SwiftLookupTableReader *reader = nullptr)
+    : Reader(reader) { }
+
+  /// Whether this table is backed by a serialized table in a module file.
+  bool isLazilyLoaded() const { return Reader != nullptr; }
+
   /// Add an entry to the lookup table.
   ///
   /// \param name The Swift name of the entry.
@@ -102,7 +155,102 @@ public:
          SmallVectorImpl<clang::NamedDecl *> &scratch);
 
   /// Dump the internal representation of this lookup table.
-  void dump() const;
+  void dump();
+};
+
+/// Writes the Swift lookup table for a Clang module into the extension
+/// block of that module's file.
+class SwiftLookupTableWriter : public clang::ModuleFileExtensionWriter {
+  class BaseNameToEntitiesTableWriterInfo;
+
+  clang::ASTWriter &Writer;
+
+  /// Populates a lookup table with the declarations of the module
+  /// being written, given that module's Sema.
+  std::function<void(clang::Sema &, SwiftLookupTable &)> PopulateTable;
+
+public:
+  SwiftLookupTableWriter(
+      clang::ModuleFileExtension *extension,
+      clang::ASTWriter &writer,
+      std::function<void(clang::Sema &, SwiftLookupTable &)> populateTable)
+    : ModuleFileExtensionWriter(extension), Writer(writer),
+      PopulateTable(std::move(populateTable)) { }
+
+  void writeExtensionContents(clang::Sema &sema,
+                              llvm::BitstreamWriter &stream) override;
+};
+
+/// Reads the Swift lookup table stored in the extension block of a
+/// Clang module file.
+///
+/// Entries are decoded one base name at a time, as the owning
+/// \c SwiftLookupTable asks for them.
+class SwiftLookupTableReader : public clang::ModuleFileExtensionReader {
+public:
+  class BaseNameTableInfo;
+  using SerializedBaseNameTable =
+    llvm::OnDiskIterableChainedHashTable<BaseNameTableInfo>;
+
+  /// A full name and the entities with that name, as stored on disk.
+  struct SerializedFullName {
+    /// The argument labels, or \c None for a simple name.
+    Optional<SmallVector<StringRef, 2>> ArgumentLabels;
+
+    /// The contexts with their declarations. Local declaration ID 0
+    /// denotes the translation unit.
+    SmallVector<std::pair<clang::serialization::DeclID,
+                          SmallVector<clang::serialization::DeclID, 2>>, 1>
+      Contexts;
+  };
+
+private:
+  clang::ASTReader &Reader;
+  clang::serialization::ModuleFile &ModFile;
+  ASTContext &SwiftContext;
+
+  /// Called when the reader goes away, so the owner can drop the table that
+  /// refers to it.
+  std::function<void()> OnRemove;
+
+  /// The base name to entities table.
+  std::unique_ptr<SerializedBaseNameTable> BaseNameTable;
+
+  SwiftLookupTableReader(clang::ModuleFileExtension *extension,
+                         clang::ASTReader &reader,
+                         clang::serialization::ModuleFile &moduleFile,
+                         ASTContext &swiftContext,
+                         std::function<void()> onRemove,
+                         std::unique_ptr<SerializedBaseNameTable> table);
+
+public:
+  /// Create a reader for the lookup table in the given extension block.
+  ///
+  /// \returns the reader, or null if the block is malformed.
+  static std::unique_ptr<SwiftLookupTableReader>
+  create(clang::ModuleFileExtension *extension, clang::ASTReader &reader,
+         clang::serialization::ModuleFile &moduleFile,
+         ASTContext &swiftContext, std::function<void()> onRemove,
+         const llvm::BitstreamCursor &stream);
+
+  ~SwiftLookupTableReader();
+
+  /// Retrieve the base names stored in the table.
+  SmallVector<StringRef, 4> getBaseNames();
+
+  /// Retrieve the entries with the given base name.
+  ///
+  /// \returns true if any entries were found.
+  bool lookup(StringRef baseName,
+              SmallVectorImpl<SerializedFullName> &entries);
+
+  /// Resolve a local declaration ID from this module file.
+  clang::NamedDecl *getDecl(clang::serialization::DeclID localID);
+
+  /// Resolve a context's local declaration ID from this module file.
+  clang::DeclContext *getContext(clang::serialization::DeclID localID);
+
+  ASTContext &getSwiftContext() const { return SwiftContext; }
 };
 
 }
@@ -83,6 +83,24 @@ namespace {
     ///
     /// Only intended for source files.
     llvm::SmallDenseMap<const Job *, bool, 16> UnfinishedCommands;
+
+    /// When each job that has begun execution began.
+    llvm::SmallDenseMap<const Job *, llvm::sys::TimeValue, 16> StartTimes;
+
+    /// How long each job that finished execution took, in milliseconds.
+    llvm::SmallDenseMap<const Job *, uint64_t, 16> Durations;
+
+    /// Compile jobs which are ready to run but have not yet been grouped into
+    /// batches, in batch mode.
+    SmallVector<const Job *, 16> PendingBatchCommands;
+
+    /// The jobs created to run several compile jobs in a single frontend
+    /// invocation, mapped to the compile jobs they run.
+    llvm::SmallDenseMap<const Job *, SmallVector<const Job *, 4>, 4>
+        BatchedCommands;
+
+    /// Owns the jobs in BatchedCommands.
+    SmallVector<std::unique_ptr<const Job>, 4> BatchJobs;
   };
 }
 
@@ -114,6 +132,7 @@ static void populateInputInfoMap(InputInfoMap &inputs,
 
       CompileJobAction::InputInfo info;
       info.previousModTime = entry.first->getInputModTime();
+      info.previousDuration = entry.first->getPreviousDuration();
       info.status = entry.second ?
           CompileJobAction::InputInfo::NeedsCascadingBuild :
           CompileJobAction::InputInfo::NeedsNonCascadingBuild;
@@ -126,11 +145,20 @@ static void populateInputInfoMap(InputInfoMap &inputs,
     if (!compileAction)
       continue;
 
+    // A job with several inputs says nothing about how long each one takes.
+    uint64_t duration = 0;
+    if (compileAction->size() == 1) {
+      duration = endState.Durations.lookup(entry);
+      if (duration == 0)
+        duration = entry->getPreviousDuration();
+    }
+
     for (auto *action : compileAction->getInputs()) {
       auto inputFile = cast<InputAction>(action);
 
       CompileJobAction::InputInfo info;
       info.previousModTime = entry->getInputModTime();
+      info.previousDuration = duration;
       info.status = CompileJobAction::InputInfo::UpToDate;
       inputs[&inputFile->getInputArg()] = info;
     }
@@ -213,6 +241,133 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
     writeTimeValue(out, entry.second.previousModTime);
     out << "\n";
   }
+
+  bool wroteDurationsKey = false;
+  for (auto &entry : inputs) {
+    if (entry.second.previousDuration == 0)
+      continue;
+    // An empty mapping would not parse as one, so only write the key if there
+    // is at least one duration.
+    if (!wroteDurationsKey) {
+      out << "durations:\n";
+      wroteDurationsKey = true;
+    }
+    out << "  \"" << llvm::yaml::escape(entry.first->getValue()) << "\": "
+        << entry.second.previousDuration << "\n";
+  }
+}
+
+/// Estimate how long each job will take to execute, including the longest
+/// chain of jobs that depend on it, so that jobs on the critical path can be
+/// started first.
+///
+/// A compile job's own cost is its duration in the previous build if that is
+/// known. Otherwise it is the total size of its inputs, scaled by the
+/// duration per byte of the jobs whose durations are known.
+static void estimateJobCosts(ArrayRef<std::unique_ptr<const Job>> jobs,
+                             llvm::DenseMap<const Job *, uint64_t> &costs) {
+  llvm::DenseMap<const Job *, uint64_t> inputSizes;
+  uint64_t knownDuration = 0, knownSize = 0;
+  for (auto &job : jobs) {
+    const auto *compileAction = dyn_cast<CompileJobAction>(&job->getSource());
+    if (!compileAction)
+      continue;
+
+    uint64_t size = 0;
+    for (auto *action : compileAction->getInputs()) {
+      auto inputFile = cast<InputAction>(action);
+      uint64_t inputSize;
+      if (!llvm::sys::fs::file_size(inputFile->getInputArg().getValue(),
+                                    inputSize))
+        size += inputSize;
+    }
+    inputSizes[job.get()] = size;
+
+    if (job->getPreviousDuration() != 0) {
+      knownDuration += job->getPreviousDuration();
+      knownSize += size;
+    }
+  }
+
+  auto getOwnCost = [&](const Job *job) -> uint64_t {
+    if (job->getPreviousDuration() != 0)
+      return job->getPreviousDuration();
+    uint64_t size = inputSizes.lookup(job);
+    if (knownDuration == 0 || knownSize == 0)
+      return size;
+    return std::max<uint64_t>(size * knownDuration / knownSize, 1);
+  };
+
+  // Jobs are created after the jobs they depend on, so walking them in
+  // reverse sees every job's dependents before the job itself.
+  llvm::DenseMap<const Job *, uint64_t> dependentCosts;
+  for (auto i = jobs.rbegin(), e = jobs.rend(); i != e; ++i) {
+    const Job *job = i->get();
+    uint64_t cost = getOwnCost(job) + dependentCosts.lookup(job);
+    costs[job] = cost;
+    for (const Job *input : job->getInputs()) {
+      uint64_t &inputDependentCost = dependentCosts[input];
+      inputDependentCost = std::max(inputDependentCost, cost);
+    }
+  }
+}
+
+/// Returns true if \p Cmd can be run as part of a frontend invocation with
+/// several primary files.
+///
+/// Serialized diagnostics and fix-its are written per invocation rather than
+/// per primary file, so jobs that ask for them always run on their own.
+static bool isBatchable(const Job *Cmd) {
+  if (!isa<CompileJobAction>(Cmd->getSource()))
+    return false;
+  if (Cmd->getSource().getInputs().size() != 1)
+    return false;
+  const CommandOutput &Output = Cmd->getOutput();
+  return Output.getPrimaryOutputFilenames().size() == 1 &&
+         Output.getAdditionalOutputForType(
+             types::TY_SerializedDiagnostics).empty() &&
+         Output.getAdditionalOutputForType(types::TY_Remapping).empty();
+}
+
+/// Creates a job that compiles all of the compile jobs in \p Batch in a single
+/// frontend invocation.
+///
+/// The invocation uses the command line of the first job. Every other job's
+/// primary file is named with -batch-primary-file, together with the outputs
+/// that job would have written.
+static std::unique_ptr<Job> makeBatchJob(ArrayRef<const Job *> Batch) {
+  const Job *First = Batch.front();
+  types::ID OutputType = First->getOutput().getPrimaryOutputType();
+  std::unique_ptr<CommandOutput> Output(new CommandOutput(OutputType));
+  llvm::opt::ArgStringList Arguments = First->getArguments();
+
+  for (const Job *Cmd : Batch) {
+    const CommandOutput &CmdOutput = Cmd->getOutput();
+    Output->addPrimaryOutput(CmdOutput.getPrimaryOutputFilename(),
+                             CmdOutput.getBaseInput(0));
+    if (Cmd == First)
+      continue;
+
+    auto *Input = cast<InputAction>(Cmd->getSource().getInputs().front());
+    Arguments.push_back("-batch-primary-file");
+    Arguments.push_back(Input->getInputArg().getValue());
+    if (OutputType == types::TY_Nothing)
+      Arguments.push_back("");
+    else
+      Arguments.push_back(CmdOutput.getPrimaryOutputFilename().c_str());
+    for (auto Type : { types::TY_SwiftModuleFile,
+                       types::TY_SwiftModuleDocFile,
+                       types::TY_Dependencies,
+                       types::TY_SwiftDeps }) {
+      Arguments.push_back(CmdOutput.getAdditionalOutputForType(Type).c_str());
+    }
+  }
+
+  SmallVector<const Job *, 1> Inputs;
+  return std::unique_ptr<Job>(new Job(First->getSource(), std::move(Inputs),
+                                      std::move(Output),
+                                      First->getExecutable(),
+                                      std::move(Arguments)));
 }
 
 int Compilation::performJobsImpl() {
@@ -225,6 +380,12 @@ int Compilation::performJobsImpl() {
 
   PerformJobsState State;
 
+  // When jobs run one at a time their order does not matter, so keep the
+  // order in which they were created.
+  llvm::DenseMap<const Job *, uint64_t> JobCosts;
+  if (TQ->getNumberOfParallelTasks() > 1)
+    estimateJobCosts(Jobs, JobCosts);
+
   using DependencyGraph = DependencyGraph<const Job *>;
   DependencyGraph DepGraph;
   SmallPtrSet<const Job *, 16> DeferredCommands;
@@ -263,8 +424,63 @@ int Compilation::performJobsImpl() {
     }
 
     State.ScheduledCommands.insert(Cmd);
+    if (getBatchModeEnabled() && isBatchable(Cmd)) {
+      State.PendingBatchCommands.push_back(Cmd);
+      return;
+    }
     TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
-                (void *)Cmd);
+                (void *)Cmd, JobCosts.lookup(Cmd));
+  };
+
+  // In batch mode, group the compile jobs that became ready since the last
+  // call into one batch per task that can run in parallel, and schedule the
+  // batches. Each job goes to the batch with the least work so far, starting
+  // with the most expensive jobs.
+  auto scheduleBatches = [&] {
+    auto &Pending = State.PendingBatchCommands;
+    if (Pending.empty())
+      return;
+
+    std::stable_sort(Pending.begin(), Pending.end(),
+                     [&](const Job *LHS, const Job *RHS) {
+      return JobCosts.lookup(LHS) > JobCosts.lookup(RHS);
+    });
+
+    size_t NumBatches = std::min<size_t>(TQ->getNumberOfParallelTasks(),
+                                         Pending.size());
+    SmallVector<SmallVector<const Job *, 4>, 4> Batches(NumBatches);
+    SmallVector<uint64_t, 4> BatchCosts(NumBatches, 0);
+    for (const Job *Cmd : Pending) {
+      auto Cheapest = std::min_element(BatchCosts.begin(), BatchCosts.end());
+      Batches[Cheapest - BatchCosts.begin()].push_back(Cmd);
+      *Cheapest += std::max<uint64_t>(JobCosts.lookup(Cmd), 1);
+    }
+    Pending.clear();
+
+    for (size_t i = 0; i != NumBatches; ++i) {
+      if (Batches[i].size() == 1) {
+        const Job *Cmd = Batches[i].front();
+        TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
+                    (void *)Cmd, BatchCosts[i]);
+        continue;
+      }
+
+      std::unique_ptr<Job> BatchCmd = makeBatchJob(Batches[i]);
+      TQ->addTask(BatchCmd->getExecutable(), BatchCmd->getArguments(),
+                  llvm::None, (void *)BatchCmd.get(), BatchCosts[i]);
+      State.BatchedCommands[BatchCmd.get()] = std::move(Batches[i]);
+      State.BatchJobs.push_back(std::move(BatchCmd));
+    }
+  };
+
+  // Returns the jobs run by the task for \p Cmd: the jobs in its batch if it
+  // is a batch job, or else just \p Cmd itself.
+  auto getBatchedCommands =
+      [&](const Job *const &Cmd) -> ArrayRef<const Job *> {
+    auto Found = State.BatchedCommands.find(Cmd);
+    if (Found != State.BatchedCommands.end())
+      return Found->second;
+    return Cmd;
   };
 
   // When a task finishes, we need to reevaluate the other commands that
@@ -381,15 +597,20 @@ int Compilation::performJobsImpl() {
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
   // task began.
-  auto taskBegan = [this] (ProcessId Pid, void *Context) {
+  auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
+    State.StartTimes[BeganCmd] = llvm::sys::TimeValue::now();
 
     // For verbose output, print out each command as it begins execution.
-    if (Level == OutputLevel::Verbose)
+    if (Level == OutputLevel::Verbose) {
       BeganCmd->printCommandLine(llvm::errs());
-    else if (Level == OutputLevel::Parseable)
-      parseable_output::emitBeganMessage(llvm::errs(), *BeganCmd, Pid);
+    } else if (Level == OutputLevel::Parseable) {
+      // Clients expect a message for each compile job, even when several of
+      // them share a process.
+      for (const Job *Cmd : getBatchedCommands(BeganCmd))
+        parseable_output::emitBeganMessage(llvm::errs(), *Cmd, Pid);
+    }
   };
 
   // Set up a callback which will be called immediately after a task has
@@ -401,10 +622,26 @@ int Compilation::performJobsImpl() {
                            void *Context) -> TaskFinishedResponse {
     const Job *FinishedCmd = (const Job *)Context;
 
+    ArrayRef<const Job *> FinishedCmds = getBatchedCommands(FinishedCmd);
+
+    // Remember how long the task took, to help schedule the next build. The
+    // jobs in a batch share its duration evenly.
+    auto StartTime = State.StartTimes.find(FinishedCmd);
+    if (StartTime != State.StartTimes.end()) {
+      uint64_t Duration =
+        (llvm::sys::TimeValue::now() - StartTime->second).msec();
+      for (const Job *Cmd : FinishedCmds)
+        State.Durations[Cmd] = Duration / FinishedCmds.size();
+    }
+
     if (Level == OutputLevel::Parseable) {
-      // Parseable output was requested.
-      parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
-                                            ReturnCode, Output);
+      // Parseable output was requested. The task's output is reported once,
+      // with the first job in its batch.
+      for (const Job *Cmd : FinishedCmds) {
+        parseable_output::emitFinishedMessage(
+            llvm::errs(), *Cmd, Pid, ReturnCode,
+            Cmd == FinishedCmds.front() ? Output : StringRef());
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -433,45 +670,52 @@ int Compilation::performJobsImpl() {
           TaskFinishedResponse::StopExecution;
     }
 
-    // When a task finishes, we need to reevaluate the other commands that
-    // might have been blocked.
-    markFinished(FinishedCmd);
+    for (const Job *FinishedJob : FinishedCmds) {
+      // When a task finishes, we need to reevaluate the other commands that
+      // might have been blocked.
+      markFinished(FinishedJob);
 
-    // In order to handle both old dependencies that have disappeared and new
-    // dependencies that have arisen, we need to reload the dependency file.
-    if (getIncrementalBuildEnabled()) {
-      const CommandOutput &Output = FinishedCmd->getOutput();
+      // In order to handle both old dependencies that have disappeared and new
+      // dependencies that have arisen, we need to reload the dependency file.
+      // Each job in a batch wrote its own, so this works just as it does for
+      // a job that ran on its own.
+      if (!getIncrementalBuildEnabled())
+        continue;
+
+      const CommandOutput &Output = FinishedJob->getOutput();
       StringRef DependenciesFile =
         Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-      if (!DependenciesFile.empty()) {
-        SmallVector<const Job *, 16> Dependents;
-        bool wasCascading = DepGraph.isMarked(FinishedCmd);
+      if (DependenciesFile.empty())
+        continue;
 
-        switch (DepGraph.loadFromPath(FinishedCmd, DependenciesFile)) {
-        case DependencyGraphImpl::LoadResult::HadError:
-          disableIncrementalBuild();
-          for (const Job *Cmd : DeferredCommands)
-            scheduleCommandIfNecessaryAndPossible(Cmd);
-          DeferredCommands.clear();
-          Dependents.clear();
-          break;
-        case DependencyGraphImpl::LoadResult::UpToDate:
-          if (!wasCascading)
-            break;
-          SWIFT_FALLTHROUGH;
-        case DependencyGraphImpl::LoadResult::AffectsDownstream:
-          DepGraph.markTransitive(Dependents, FinishedCmd);
-          break;
-        }
+      SmallVector<const Job *, 16> Dependents;
+      bool wasCascading = DepGraph.isMarked(FinishedJob);
 
-        for (const Job *Cmd : Dependents) {
-          DeferredCommands.erase(Cmd);
-          noteBuilding(Cmd, "because of dependencies discovered later");
+      switch (DepGraph.loadFromPath(FinishedJob, DependenciesFile)) {
+      case DependencyGraphImpl::LoadResult::HadError:
+        disableIncrementalBuild();
+        for (const Job *Cmd : DeferredCommands)
           scheduleCommandIfNecessaryAndPossible(Cmd);
-        }
+        DeferredCommands.clear();
+        Dependents.clear();
+        break;
+      case DependencyGraphImpl::LoadResult::UpToDate:
+        if (!wasCascading)
+          break;
+        SWIFT_FALLTHROUGH;
+      case DependencyGraphImpl::LoadResult::AffectsDownstream:
+        DepGraph.markTransitive(Dependents, FinishedJob);
+        break;
+      }
+
+      for (const Job *Cmd : Dependents) {
+        DeferredCommands.erase(Cmd);
+        noteBuilding(Cmd, "because of dependencies discovered later");
+        scheduleCommandIfNecessaryAndPossible(Cmd);
       }
     }
 
+    scheduleBatches();
     return TaskFinishedResponse::ContinueExecution;
   };
 
@@ -481,8 +725,12 @@ int Compilation::performJobsImpl() {
 
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
-      parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
-                                             ErrorMsg, Output);
+      ArrayRef<const Job *> SignalledCmds = getBatchedCommands(SignalledCmd);
+      for (const Job *Cmd : SignalledCmds) {
+        parseable_output::emitSignalledMessage(
+            llvm::errs(), *Cmd, Pid, ErrorMsg,
+            Cmd == SignalledCmds.front() ? Output : StringRef());
+      }
     } else {
       // Otherwise, send the buffered output to stderr, though only if we
       // support getting buffered output.
@@ -503,6 +751,8 @@ int Compilation::performJobsImpl() {
     return TaskFinishedResponse::StopExecution;
   };
 
+  scheduleBatches();
+
   do {
     // Ask the TaskQueue to execute.
     TQ->execute(taskBegan, taskFinished, taskSignalled);
@@ -518,6 +768,7 @@ int Compilation::performJobsImpl() {
       State.ScheduledCommands.insert(Cmd);
       markFinished(Cmd);
     }
+    scheduleBatches();
 
     // ...which may allow us to go on and do later tasks.
   } while (Result == 0 && TQ->hasRemainingTasks());
@@ -12,9 +12,9 @@
 
 #include "swift/Driver/DependencyGraph.h"
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/ReferenceDependencyFile.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
-#include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -49,14 +49,100 @@ using DependencyKind = DependencyGraphImpl::DependencyKind;
 using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
 using InterfaceHashCallbackTy = LoadResult(StringRef);
 
+namespace {
+enum class DependencyDirection : bool {
+  Depends,
+  Provides
+};
+} // end anonymous namespace
+
+/// Returns the kind of dependency listed in \p section and whether it is a
+/// "depends" or a "provides" entry.
+static std::pair<DependencyKind, DependencyDirection>
+classifySection(ReferenceDependencySection section) {
+  switch (section) {
+  case ReferenceDependencySection::ProvidesTopLevel:
+    return {DependencyKind::TopLevelName, DependencyDirection::Provides};
+  case ReferenceDependencySection::ProvidesNominal:
+    return {DependencyKind::NominalType, DependencyDirection::Provides};
+  case ReferenceDependencySection::ProvidesMember:
+    return {DependencyKind::NominalTypeMember, DependencyDirection::Provides};
+  case ReferenceDependencySection::ProvidesDynamicLookup:
+    return {DependencyKind::DynamicLookupName, DependencyDirection::Provides};
+  case ReferenceDependencySection::DependsTopLevel:
+    return {DependencyKind::TopLevelName, DependencyDirection::Depends};
+  case ReferenceDependencySection::DependsNominal:
+    return {DependencyKind::NominalType, DependencyDirection::Depends};
+  case ReferenceDependencySection::DependsMember:
+    return {DependencyKind::NominalTypeMember, DependencyDirection::Depends};
+  case ReferenceDependencySection::DependsDynamicLookup:
+    return {DependencyKind::DynamicLookupName, DependencyDirection::Depends};
+  case ReferenceDependencySection::DependsExternal:
+    return {DependencyKind::ExternalFile, DependencyDirection::Depends};
+  }
+  llvm_unreachable("unhandled section");
+}
+
+/// Folds the result of loading one more entry into \p result.
+///
+/// \returns false if loading should stop because of an error.
+static bool mergeLoadResult(LoadResult &result, LoadResult update) {
+  switch (update) {
+  case LoadResult::HadError:
+    result = LoadResult::HadError;
+    return false;
+  case LoadResult::UpToDate:
+    return true;
+  case LoadResult::AffectsDownstream:
+    result = LoadResult::AffectsDownstream;
+    return true;
+  }
+  llvm_unreachable("unhandled result");
+}
+
 static LoadResult
-parseDependencyFile(llvm::MemoryBuffer &buffer,
-                    llvm::function_ref<DependencyCallbackTy> providesCallback,
-                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
-                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+parseBinaryDependencyFile(llvm::MemoryBuffer &buffer,
+                          llvm::function_ref<DependencyCallbackTy> providesCallback,
+                          llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                          llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+  LoadResult result = LoadResult::UpToDate;
+  SmallString<64> appended;
+
+  auto entryCallback = [&](ReferenceDependencySection section, StringRef name,
+                           StringRef member, bool isCascading) -> bool {
+    auto dirAndKind = classifySection(section);
+    bool isDepends = dirAndKind.second == DependencyDirection::Depends;
+    auto &callback = isDepends ? dependsCallback : providesCallback;
+
+    if (isMemberSection(section)) {
+      // Smash the type and member names together, as for YAML below.
+      appended = name;
+      appended.push_back('\0');
+      appended += member;
+      name = appended.str();
+    }
+
+    return mergeLoadResult(result,
+                           callback(name, dirAndKind.first, isCascading));
+  };
+
+  auto hashCallback = [&](StringRef hash) -> bool {
+    return mergeLoadResult(result, interfaceHashCallback(hash));
+  };
+
+  if (!readBinaryReferenceDependencies(buffer.getBuffer(), entryCallback,
+                                       hashCallback))
+    return LoadResult::HadError;
+  return result;
+}
+
+static LoadResult
+parseYAMLDependencyFile(llvm::MemoryBuffer &buffer,
+                        llvm::function_ref<DependencyCallbackTy> providesCallback,
+                        llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                        llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
   namespace yaml = llvm::yaml;
 
-  // FIXME: Switch to a format other than YAML.
   llvm::SourceMgr SM;
   yaml::Stream stream(buffer.getMemBufferRef(), SM);
   auto I = stream.begin();
@@ -94,44 +180,19 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       resultUpdate = interfaceHashCallback(valueString);
 
     } else {
-      enum class DependencyDirection : bool {
-        Depends,
-        Provides
-      };
-      using KindPair = std::pair<DependencyKind, DependencyDirection>;
-
-      KindPair dirAndKind = llvm::StringSwitch<KindPair>(key->getValue(scratch))
-        .Case("depends-top-level",
-              std::make_pair(DependencyKind::TopLevelName,
-                             DependencyDirection::Depends))
-        .Case("depends-nominal",
-              std::make_pair(DependencyKind::NominalType,
-                             DependencyDirection::Depends))
-        .Case("depends-member",
-              std::make_pair(DependencyKind::NominalTypeMember,
-                             DependencyDirection::Depends))
-        .Case("depends-dynamic-lookup",
-              std::make_pair(DependencyKind::DynamicLookupName,
-                             DependencyDirection::Depends))
-        .Case("depends-external",
-              std::make_pair(DependencyKind::ExternalFile,
-                             DependencyDirection::Depends))
-        .Case("provides-top-level",
-              std::make_pair(DependencyKind::TopLevelName,
-                             DependencyDirection::Provides))
-        .Case("provides-nominal",
-              std::make_pair(DependencyKind::NominalType,
-                             DependencyDirection::Provides))
-        .Case("provides-member",
-              std::make_pair(DependencyKind::NominalTypeMember,
-                             DependencyDirection::Provides))
-        .Case("provides-dynamic-lookup",
-              std::make_pair(DependencyKind::DynamicLookupName,
-                             DependencyDirection::Provides))
-        .Default(std::make_pair(DependencyKind(),
-                                DependencyDirection::Depends));
-      if (dirAndKind.first == DependencyKind())
+      Optional<ReferenceDependencySection> section;
+      for (unsigned raw = 0,
+             last = unsigned(ReferenceDependencySection::Last);
+           raw <= last; ++raw) {
+        auto candidate = ReferenceDependencySection(raw);
+        if (keyString == getReferenceDependencySectionName(candidate)) {
+          section = candidate;
+          break;
+        }
+      }
+      if (!section)
         return LoadResult::HadError;
+      auto dirAndKind = classifySection(*section);
 
       auto *entries = dyn_cast<yaml::SequenceNode>(i->getValue());
       if (!entries)
@@ -191,22 +252,30 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
     }
 
     // After processing this entry, we now know more about the node as a whole.
-    switch (resultUpdate) {
-    case LoadResult::HadError:
+    if (!mergeLoadResult(result, resultUpdate))
       return LoadResult::HadError;
-    case LoadResult::UpToDate:
-      break;
-    case LoadResult::AffectsDownstream:
-      result = LoadResult::AffectsDownstream;
-      break;
-    }
   }
 
   return result;
 }
 
+static LoadResult
+parseDependencyFile(llvm::MemoryBuffer &buffer,
+                    llvm::function_ref<DependencyCallbackTy> providesCallback,
+                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
+                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+  if (isBinaryReferenceDependencyFile(buffer.getBuffer()))
+    return parseBinaryDependencyFile(buffer, providesCallback, dependsCallback,
+                                     interfaceHashCallback);
+  return parseYAMLDependencyFile(buffer, providesCallback, dependsCallback,
+                                 interfaceHashCallback);
+}
+
 LoadResult DependencyGraphImpl::loadFromPath(const void *node, StringRef path) {
-  auto buffer = llvm::MemoryBuffer::getFile(path);
+  // Neither format needs a null terminator; not asking for one lets larger
+  // files be mapped instead of read.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
   if (!buffer)
     return LoadResult::HadError;
   return loadFromBuffer(node, *buffer.get());
@@ -214,7 +283,8 @@ LoadResult DependencyGraphImpl::loadFromPath(const void *node, StringRef path) {
 
 LoadResult
 DependencyGraphImpl::loadFromString(const void *node, StringRef data) {
-  auto buffer = llvm::MemoryBuffer::getMemBuffer(data);
+  auto buffer = llvm::MemoryBuffer::getMemBuffer(
+      data, "", /*RequiresNullTerminator=*/false);
   return loadFromBuffer(node, *buffer);
 }
 
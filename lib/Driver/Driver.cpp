@@ -207,6 +207,7 @@ static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
   SmallString<64> scratch;
 
   llvm::StringMap<InputInfo> previousInputs;
+  llvm::StringMap<uint64_t> previousDurations;
   bool versionValid = false;
   bool optionsMatch = true;
 
@@ -310,9 +311,41 @@ static bool populateOutOfDateMap(InputInfoMap &map, StringRef argsHashStr,
         auto inputName = key->getValue(scratch);
         previousInputs[inputName] = { *previousBuildState, timeValue };
       }
+
+    } else if (keyStr == "durations") {
+      auto *durationMap = dyn_cast<yaml::MappingNode>(i->getValue());
+      if (!durationMap)
+        return true;
+
+      // FIXME: LLVM's YAML support does incremental parsing in such a way that
+      // for-range loops break.
+      for (auto i = durationMap->begin(), e = durationMap->end(); i != e; ++i) {
+        auto *key = dyn_cast<yaml::ScalarNode>(i->getKey());
+        if (!key)
+          return true;
+
+        auto *value = dyn_cast<yaml::ScalarNode>(i->getValue());
+        if (!value)
+          return true;
+
+        uint64_t duration;
+        if (value->getValue(scratch).getAsInteger(10, duration))
+          return true;
+
+        auto inputName = key->getValue(scratch);
+        previousDurations[inputName] = duration;
+      }
     }
   }
 
+  // Durations are only a scheduling hint, so attach them after all inputs
+  // have been read, regardless of the order of the keys.
+  for (auto &entry : previousDurations) {
+    auto iter = previousInputs.find(entry.getKey());
+    if (iter != previousInputs.end())
+      iter->getValue().previousDuration = entry.getValue();
+  }
+
   if (!versionValid || !optionsMatch)
     return true;
 
@@ -507,6 +540,13 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  // Batch mode groups the per-file compile jobs of a standard compile; other
+  // modes either have a single compile job or don't invoke the frontend.
+  if (C->getArgs().hasArg(options::OPT_enable_batch_mode) &&
+      OI.CompilerMode == OutputInfo::Mode::StandardCompile &&
+      !OI.isMultiThreading())
+    C->setBatchModeEnabled();
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -1871,6 +1911,7 @@ Job *Driver::buildJobsForAction(Compilation &C, const Action *A,
           C.getArgs().hasArg(options::OPT_driver_always_rebuild_dependents);
       handleCompileJobCondition(J, compileJob->getInputInfo(), BaseInput,
                                 alwaysRebuildDependents);
+      J->setPreviousDuration(compileJob->getInputInfo().previousDuration);
     }
   }
 
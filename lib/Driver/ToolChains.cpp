@@ -337,6 +337,7 @@ ToolChain::constructInvocation(const CompileJobAction &job,
   if (!ReferenceDependenciesPath.empty()) {
     Arguments.push_back("-emit-reference-dependencies-path");
     Arguments.push_back(ReferenceDependenciesPath.c_str());
+    Arguments.push_back("-emit-binary-reference-dependencies");
   }
 
   const std::string &FixitsPath =
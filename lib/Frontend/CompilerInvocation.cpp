@@ -115,6 +115,10 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     Opts.DumpAPIPath = A->getValue();
   }
 
+  if (const Arg *A = Args.getLastArg(OPT_immediate_cache_path)) {
+    Opts.ImmediateCachePath = A->getValue();
+  }
+
   Opts.EmitVerboseSIL |= Args.hasArg(OPT_emit_verbose_sil);
   Opts.EmitSortedSIL |= Args.hasArg(OPT_emit_sorted_sil);
 
@@ -124,6 +128,8 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.PrintStats |= Args.hasArg(OPT_print_stats);
   Opts.PrintClangStats |= Args.hasArg(OPT_print_clang_stats);
   Opts.DebugTimeFunctionBodies |= Args.hasArg(OPT_debug_time_function_bodies);
+  Opts.DebugTimeExpressionTypeChecking |=
+    Args.hasArg(OPT_debug_time_expression_type_checking);
 
   Opts.PlaygroundTransform |= Args.hasArg(OPT_playground);
   if (Args.hasArg(OPT_disable_playground_transform))
@@ -154,6 +160,34 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  for (const Arg *A : make_range(Args.filtered_begin(OPT_batch_primary_file),
+                                 Args.filtered_end())) {
+    if (!Opts.PrimaryInput.hasValue()) {
+      Diags.diagnose(SourceLoc(),
+                     diag::error_batch_primary_file_without_primary_file);
+      return true;
+    }
+
+    // The file is also passed as an ordinary input, so that it's parsed in
+    // the same position as it would be when compiled on its own.
+    StringRef File = A->getValue(0);
+    auto Found = std::find(Opts.InputFilenames.begin(),
+                           Opts.InputFilenames.end(), File);
+    if (Found == Opts.InputFilenames.end()) {
+      Diags.diagnose(SourceLoc(), diag::error_batch_primary_file_not_input,
+                     File);
+      return true;
+    }
+
+    BatchPrimaryInput Input(Found - Opts.InputFilenames.begin());
+    Input.OutputFilename = A->getValue(1);
+    Input.ModuleOutputPath = A->getValue(2);
+    Input.ModuleDocOutputPath = A->getValue(3);
+    Input.DependenciesFilePath = A->getValue(4);
+    Input.ReferenceDependenciesFilePath = A->getValue(5);
+    Opts.BatchPrimaryInputs.push_back(std::move(Input));
+  }
+
   Opts.ParseStdlib |= Args.hasArg(OPT_parse_stdlib);
 
   // Determine what the user has asked the frontend to do.
@@ -506,6 +540,8 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
                           OPT_emit_reference_dependencies,
                           OPT_emit_reference_dependencies_path,
                           "swiftdeps", false);
+  Opts.EmitBinaryReferenceDependencies |=
+    Args.hasArg(OPT_emit_binary_reference_dependencies);
   determineOutputFilename(Opts.SerializedDiagnosticsPath,
                           OPT_serialize_diagnostics,
                           OPT_serialize_diagnostics_path,
@@ -691,6 +727,8 @@ static bool ParseLangArgs(LangOptions &Opts, ArgList &Args,
   
   Opts.DebugConstraintSolver |= Args.hasArg(OPT_debug_constraints);
   Opts.IterativeTypeChecker |= Args.hasArg(OPT_iterative_type_checker);
+  Opts.NamedLazyMemberLoading |=
+    Args.hasArg(OPT_enable_named_lazy_member_loading);
   Opts.DebugGenericSignatures |= Args.hasArg(OPT_debug_generic_signatures);
 
   Opts.DebuggerSupport |= Args.hasArg(OPT_debugger_support);
@@ -738,6 +776,17 @@ static bool ParseLangArgs(LangOptions &Opts, ArgList &Args,
     
     Opts.SolverMemoryThreshold = threshold;
   }
+
+  if (const Arg *A = Args.getLastArg(OPT_warn_long_expression_type_checking)) {
+    unsigned threshold;
+    if (StringRef(A->getValue()).getAsInteger(10, threshold)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(Args), A->getValue());
+      return true;
+    }
+
+    Opts.WarnLongExpressionTypeChecking = threshold;
+  }
   
   for (const Arg *A : make_range(Args.filtered_begin(OPT_D),
                                  Args.filtered_end())) {
@@ -1097,6 +1146,8 @@ static bool ParseIRGenArgs(IRGenOptions &Opts, ArgList &Args,
     Opts.StackPromotionSizeLimit = limit;
   }
 
+  Opts.BalanceCodeGenUnits |= Args.hasArg(OPT_balance_codegen_units);
+
   if (Args.hasArg(OPT_autolink_force_load))
     Opts.ForceLoadSymbolName = Args.getLastArgValue(OPT_module_link_name);
 
@@ -1113,6 +1164,9 @@ static bool ParseIRGenArgs(IRGenOptions &Opts, ArgList &Args,
 
   if (Args.hasArg(OPT_use_jit))
     Opts.UseJIT = true;
+
+  if (Args.hasArg(OPT_enable_jit_profiling))
+    Opts.EnableJITProfiling = true;
   
   for (const Arg *A : make_range(Args.filtered_begin(OPT_verify_type_layout),
                                  Args.filtered_end())) {
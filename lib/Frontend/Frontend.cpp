@@ -27,6 +27,7 @@
 #include "swift/Parse/Lexer.h"
 #include "swift/SIL/SILModule.h"
 #include "swift/Serialization/SerializedModuleLoader.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Support/CommandLine.h"
@@ -52,6 +53,26 @@ void CompilerInstance::setPrimarySourceFile(SourceFile *SF) {
   PrimarySourceFile->setReferencedNameTracker(NameTracker);
 }
 
+void CompilerInstance::noteBatchPrimarySourceFile(SourceFile *SF) {
+  assert(SF->getBufferID().hasValue());
+  unsigned BufferID = SF->getBufferID().getValue();
+  for (unsigned i = 0, e = BatchPrimaryBufferIDs.size(); i != e; ++i) {
+    if (BatchPrimaryBufferIDs[i] != BufferID)
+      continue;
+    assert(!BatchPrimarySourceFiles[i] && "already has a source file");
+    BatchPrimarySourceFiles[i] = SF;
+    SF->setReferencedNameTracker(BatchNameTrackers[i]);
+    return;
+  }
+}
+
+bool CompilerInstance::isPrimarySourceFile(const SourceFile *SF) const {
+  return SF == PrimarySourceFile ||
+         std::find(BatchPrimarySourceFiles.begin(),
+                   BatchPrimarySourceFiles.end(),
+                   SF) != BatchPrimarySourceFiles.end();
+}
+
 bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   Invocation = Invok;
 
@@ -124,6 +145,18 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   const Optional<SelectedInput> &PrimaryInput =
     Invocation.getFrontendOptions().PrimaryInput;
 
+  ArrayRef<BatchPrimaryInput> BatchPrimaryInputs =
+    Invocation.getFrontendOptions().BatchPrimaryInputs;
+  BatchPrimaryBufferIDs.assign(BatchPrimaryInputs.size(), NO_SUCH_BUFFER);
+  BatchPrimarySourceFiles.assign(BatchPrimaryInputs.size(), nullptr);
+  BatchNameTrackers.resize(BatchPrimaryInputs.size());
+  auto noteBatchPrimaryBuffer = [&](unsigned Index, unsigned BufferID) {
+    for (unsigned i = 0, e = BatchPrimaryInputs.size(); i != e; ++i)
+      if (BatchPrimaryInputs[i].Input.isFilename() &&
+          BatchPrimaryInputs[i].Input.Index == Index)
+        BatchPrimaryBufferIDs[i] = BufferID;
+  };
+
   // Add the memory buffers first, these will be associated with a filename
   // and they can replace the contents of an input filename.
   for (unsigned i = 0, e = Invocation.getInputBuffers().size(); i != e; ++i) {
@@ -160,6 +193,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       if (PrimaryInput && PrimaryInput->isFilename() &&
           PrimaryInput->Index == i)
         PrimaryBufferID = ExistingBufferID.getValue();
+      noteBatchPrimaryBuffer(i, ExistingBufferID.getValue());
 
       continue; // replaced by a memory buffer.
     }
@@ -202,6 +236,7 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
     if (PrimaryInput && PrimaryInput->isFilename() && PrimaryInput->Index == i)
       PrimaryBufferID = BufferID;
+    noteBatchPrimaryBuffer(i, BufferID);
   }
 
   // Set the primary file to the code-completion point if one exists.
@@ -375,6 +410,8 @@ void CompilerInstance::performSema() {
 
     if (MainBufferID == PrimaryBufferID)
       setPrimarySourceFile(MainFile);
+    else
+      noteBatchPrimarySourceFile(MainFile);
   }
 
   bool hadLoadError = false;
@@ -401,6 +438,8 @@ void CompilerInstance::performSema() {
 
     if (BufferID == PrimaryBufferID)
       setPrimarySourceFile(NextInput);
+    else
+      noteBatchPrimarySourceFile(NextInput);
 
     bool Done;
     do {
@@ -432,17 +471,19 @@ void CompilerInstance::performSema() {
   if (Invocation.getFrontendOptions().DebugTimeFunctionBodies) {
     TypeCheckOptions |= TypeCheckingFlags::DebugTimeFunctionBodies;
   }
+  if (Invocation.getFrontendOptions().DebugTimeExpressionTypeChecking) {
+    TypeCheckOptions |= TypeCheckingFlags::DebugTimeExpressionTypeChecking;
+  }
   if (Invocation.getFrontendOptions().actionIsImmediate()) {
     TypeCheckOptions |= TypeCheckingFlags::ForImmediateMode;
   }
 
   // Parse the main file last.
   if (MainBufferID != NO_SUCH_BUFFER) {
-    bool mainIsPrimary =
-      (PrimaryBufferID == NO_SUCH_BUFFER || MainBufferID == PrimaryBufferID);
-
     SourceFile &MainFile =
       MainModule->getMainSourceFile(Invocation.getSourceFileKind());
+    bool mainIsPrimary =
+      (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(&MainFile));
     SILParserState SILContext(TheSILModule.get());
     unsigned CurTUElem = 0;
     bool Done;
@@ -471,7 +512,7 @@ void CompilerInstance::performSema() {
   // Type-check each top-level input besides the main source file.
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF))
         performTypeChecking(*SF, PersistentState.getTopLevelContext(),
                             TypeCheckOptions);
 
@@ -88,3 +88,23 @@ void FrontendOptions::forAllOutputPaths(
       fn(*next);
   }
 }
+
+FrontendOptions
+FrontendOptions::getOptionsForBatchPrimary(const BatchPrimaryInput &input) const {
+  FrontendOptions result = *this;
+  result.PrimaryInput = input.Input;
+  result.BatchPrimaryInputs.clear();
+
+  result.OutputFilenames.clear();
+  if (!input.OutputFilename.empty())
+    result.OutputFilenames.push_back(input.OutputFilename);
+  result.ModuleOutputPath = input.ModuleOutputPath;
+  result.ModuleDocOutputPath = input.ModuleDocOutputPath;
+  result.DependenciesFilePath = input.DependenciesFilePath;
+  result.ReferenceDependenciesFilePath = input.ReferenceDependenciesFilePath;
+
+  // The Objective-C header describes the whole module, so it is only written
+  // along with the outputs for the first primary file.
+  result.ObjCHeaderOutputPath.clear();
+  return result;
+}
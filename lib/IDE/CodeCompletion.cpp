@@ -4771,7 +4771,7 @@ void SimpleCachingCodeCompletionConsumer::handleResultsAndModules(
     // FIXME(thread-safety): lock the whole AST context.  We might load a
     // module.
     llvm::Optional<CodeCompletionCache::ValueRefCntPtr> V =
-        context.Cache.get(R.Key);
+        context.Cache.get(R.Key, context.CachedResultsNamePrefix);
     if (!V.hasValue()) {
       // No cached results found. Fill the cache.
       V = context.Cache.createValue();
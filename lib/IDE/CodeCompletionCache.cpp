@@ -38,7 +38,7 @@ CodeCompletionCache::ValueRefCntPtr CodeCompletionCache::createValue() {
 }
 
 Optional<CodeCompletionCache::ValueRefCntPtr>
-CodeCompletionCache::get(const Key &K) {
+CodeCompletionCache::get(const Key &K, StringRef NamePrefix) {
   auto &TheCache = Impl->TheCache;
   llvm::Optional<ValueRefCntPtr> V = TheCache.get(K);
   if (V) {
@@ -51,6 +51,10 @@ CodeCompletionCache::get(const Key &K) {
       V = None;
       TheCache.remove(K);
     }
+  } else if (nextCache && !NamePrefix.empty()) {
+    // Only read the matching results from the chained cache. They are not a
+    // complete value, so they don't go into our own cache.
+    V = nextCache->get(K, NamePrefix);
   } else if (nextCache && (V = nextCache->get(K))) {
     // Hit the chained cache. Update our own cache to match.
     setImpl(K, *V, /*setChain*/ false);
@@ -88,7 +92,7 @@ CodeCompletionCache::~CodeCompletionCache() {}
 ///
 /// This should be incremented any time we commit a change to the format of the
 /// cached results. This isn't expected to change very often.
-static constexpr uint32_t onDiskCompletionCacheVersion = 0;
+static constexpr uint32_t onDiskCompletionCacheVersion = 1;
 
 static StringRef copyString(llvm::BumpPtrAllocator &Allocator, StringRef Str) {
   char *Mem = Allocator.Allocate<char>(Str.size());
@@ -112,15 +116,32 @@ static ArrayRef<std::pair<StringRef, StringRef>> copyStringPairArray(
   return llvm::makeArrayRef(Buff, Arr.size());
 }
 
+/// The size of a serialized CodeCompletionResult in the RESULTS section.
+/// \see writeCachedModule.
+static constexpr unsigned resultRecordSize = 5 + 7 * sizeof(uint32_t);
+
+/// The size of an entry in the NAMES section.
+static constexpr unsigned nameRecordSize = 2 * sizeof(uint32_t);
+
 /// Deserializes CodeCompletionResults from \p in and stores them in \p V.
+///
+/// If \p namePrefix is not empty, only the results whose name starts with it,
+/// ignoring case, are deserialized. They are found with the NAMES index, so
+/// the other results aren't touched at all.
 /// \see writeCacheModule.
 static bool readCachedModule(llvm::MemoryBuffer *in,
                              const CodeCompletionCache::Key &K,
                              CodeCompletionCache::Value &V,
-                             bool allowOutOfDate = false) {
+                             bool allowOutOfDate = false,
+                             StringRef namePrefix = StringRef()) {
   const char *cursor = in->getBufferStart();
   const char *end = in->getBufferEnd();
 
+  // Returns true if \p size bytes starting at \p p are within the buffer.
+  auto fits = [end](const char *p, size_t size) {
+    return size <= size_t(end - p);
+  };
+
   auto read32le = [end](const char *&cursor) {
     auto result = llvm::support::endian::read32le(cursor);
     cursor += sizeof(result);
@@ -130,6 +151,8 @@ static bool readCachedModule(llvm::MemoryBuffer *in,
 
   // HEADER
   {
+    if (!fits(cursor, sizeof(uint32_t) + sizeof(uint64_t)))
+      return false;
     auto version = read32le(cursor);
     if (version != onDiskCompletionCacheVersion)
       return false; // File written with different format.
@@ -147,19 +170,38 @@ static bool readCachedModule(llvm::MemoryBuffer *in,
     }
   }
 
+  // Returns the start of the next length-prefixed section and moves \p cursor
+  // past it, or returns null if the section doesn't fit in the buffer.
+  auto readSection = [&](const char *&cursor, uint32_t elementSize = 1)
+      -> const char * {
+    if (!fits(cursor, sizeof(uint32_t)))
+      return nullptr;
+    uint64_t size = uint64_t(read32le(cursor)) * elementSize;
+    if (!fits(cursor, size))
+      return nullptr;
+    const char *start = cursor;
+    cursor += size;
+    return start;
+  };
+
   // DEBUG INFO
-  cursor += read32le(cursor); // Skip the whole debug section.
-
-  // Get the size of the various sections.
-  auto resultSize = read32le(cursor);
-  const char *resultEnd = cursor + resultSize;
-  const char *chunks = resultEnd;
-  auto chunkSize = read32le(chunks);
-  const char *strings = chunks + chunkSize;
-  auto stringCount = read32le(strings);
-  assert(strings + stringCount == end && "incorrect file size");
-  (void)stringCount; // so it is not seen as "unused" in release builds.
-  
+  if (!readSection(cursor)) // Skip the whole debug section.
+    return false;
+
+  // Get the various sections.
+  const char *results = readSection(cursor);
+  const char *resultEnd = cursor;
+  const char *chunks = readSection(cursor);
+  const char *strings = readSection(cursor);
+  if (!results || !chunks || !strings || !fits(cursor, sizeof(uint32_t)))
+    return false;
+  uint32_t nameCount = llvm::support::endian::read32le(cursor);
+  const char *names = readSection(cursor, nameRecordSize);
+  if (!names || cursor != end)
+    return false;
+  if ((resultEnd - results) % resultRecordSize != 0)
+    return false;
+
   // STRINGS
   auto getString = [&](uint32_t index) -> StringRef {
     if (index == ~0u)
@@ -195,7 +237,7 @@ static bool readCachedModule(llvm::MemoryBuffer *in,
   };
 
   // RESULTS
-  while (cursor != resultEnd) {
+  auto readResult = [&](const char *cursor) {
     auto kind = static_cast<CodeCompletionResult::ResultKind>(*cursor++);
     auto declKind = static_cast<CodeCompletionDeclKind>(*cursor++);
     auto context = static_cast<SemanticContextKind>(*cursor++);
@@ -243,6 +285,46 @@ static bool readCachedModule(llvm::MemoryBuffer *in,
     }
 
     V.Sink.Results.push_back(result);
+  };
+
+  if (namePrefix.empty()) {
+    for (const char *p = results; p != resultEnd; p += resultRecordSize)
+      readResult(p);
+    return true;
+  }
+
+  // NAMES
+  // The names are stored in lowercase and sorted, so the matching ones form a
+  // contiguous range.
+  std::string lowerPrefix = namePrefix.lower();
+  auto getName = [&](uint32_t nameIndex) -> StringRef {
+    const char *p = names + nameIndex * nameRecordSize;
+    uint32_t stringIndex = read32le(p);
+    if (stringIndex == ~0u)
+      return "";
+    p = strings + stringIndex;
+    auto size = read32le(p);
+    return StringRef(p, size);
+  };
+
+  uint32_t lower = 0, upper = nameCount;
+  while (lower < upper) {
+    uint32_t middle = lower + (upper - lower) / 2;
+    if (getName(middle) < lowerPrefix)
+      lower = middle + 1;
+    else
+      upper = middle;
+  }
+
+  uint32_t resultCount = (resultEnd - results) / resultRecordSize;
+  for (uint32_t i = lower; i < nameCount; ++i) {
+    if (!getName(i).startswith(lowerPrefix))
+      break;
+    const char *p = names + i * nameRecordSize + sizeof(uint32_t);
+    uint32_t resultIndex = read32le(p);
+    if (resultIndex >= resultCount)
+      return false;
+    readResult(results + resultIndex * resultRecordSize);
   }
 
   return true;
@@ -262,6 +344,7 @@ static bool readCachedModule(llvm::MemoryBuffer *in,
 ///   RESULTS
 ///     * A length-prefixed array of fixed size CodeCompletionResults.
 ///     * Contains offsets into CHUNKS and STRINGS.
+///     * The results can be read individually, see NAMES.
 ///
 ///   CHUNKS
 ///     * A length-prefixed array of CodeCompletionStrings.
@@ -269,7 +352,14 @@ static bool readCachedModule(llvm::MemoryBuffer *in,
 ///       CodeCompletionString::Chunks.
 ///
 ///   STRINGS
-///     * A blob of length-prefixed strings referred to in CHUNKS or RESULTS.
+///     * A blob of length-prefixed strings referred to in CHUNKS, RESULTS or
+///       NAMES.
+///
+///   NAMES
+///     * A count-prefixed array of (name, result index) pairs, sorted by name.
+///     * The names are lowercase and stored in STRINGS.
+///     * Lets a reader deserialize only the results whose name starts with a
+///       given prefix.
 static void writeCachedModule(llvm::raw_ostream &out,
                               const CodeCompletionCache::Key &K,
                               CodeCompletionCache::Value &V) {
@@ -381,9 +471,41 @@ static void writeCachedModule(llvm::raw_ostream &out,
   LE.write(static_cast<uint32_t>(chunks.tell()));
   out << chunks.str();
 
+  // NAMES
+  // Computed before STRINGS is written out, since the names go in there.
+  std::vector<std::pair<std::string, uint32_t>> sortedNames;
+  sortedNames.reserve(V.Sink.Results.size());
+  for (unsigned i = 0, e = V.Sink.Results.size(); i != e; ++i) {
+    const CodeCompletionString *str = V.Sink.Results[i]->getCompletionString();
+    std::string name;
+    if (str->getFirstTextChunkIndex().hasValue()) {
+      llvm::raw_string_ostream OSS(name);
+      str->getName(OSS);
+    }
+    sortedNames.push_back({StringRef(name).lower(), i});
+  }
+  std::stable_sort(sortedNames.begin(), sortedNames.end(),
+                   [](const std::pair<std::string, uint32_t> &LHS,
+                      const std::pair<std::string, uint32_t> &RHS) {
+    return LHS.first < RHS.first;
+  });
+  std::string names_;
+  llvm::raw_string_ostream names(names_);
+  {
+    endian::Writer<little> LE(names);
+    for (auto &entry : sortedNames) {
+      LE.write(addString(entry.first));
+      LE.write(entry.second);
+    }
+  }
+
   // STRINGS
   LE.write(static_cast<uint32_t>(strings.tell()));
   out << strings.str();
+
+  // NAMES
+  LE.write(static_cast<uint32_t>(sortedNames.size()));
+  out << names.str();
 }
 
 /// Get the name for the cached code completion results for a given key \p K in
@@ -415,16 +537,25 @@ static std::string getName(StringRef cacheDirectory,
   return name.str();
 }
 
+/// Opens a cached results file, memory-mapping it if it is large enough for
+/// that to pay off.
+static llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+openCachedModule(const Twine &filename) {
+  return llvm::MemoryBuffer::getFile(filename, /*FileSize*/ -1,
+                                     /*RequiresNullTerminator*/ false);
+}
+
 Optional<CodeCompletionCache::ValueRefCntPtr>
-OnDiskCodeCompletionCache::get(const Key &K) {
+OnDiskCodeCompletionCache::get(const Key &K, StringRef NamePrefix) {
   // Try to find the cached file.
-  auto bufferOrErr = llvm::MemoryBuffer::getFile(getName(cacheDirectory, K));
+  auto bufferOrErr = openCachedModule(getName(cacheDirectory, K));
   if (!bufferOrErr)
     return None;
 
   // Read the cached results, failing if they are out of date.
   auto V = CodeCompletionCache::createValue();
-  if (!readCachedModule(bufferOrErr.get().get(), K, *V))
+  if (!readCachedModule(bufferOrErr.get().get(), K, *V,
+                        /*allowOutOfDate*/ false, NamePrefix))
     return None;
 
   return V;
@@ -458,9 +589,10 @@ std::error_code OnDiskCodeCompletionCache::set(const Key &K, ValueRefCntPtr V) {
 }
 
 Optional<CodeCompletionCache::ValueRefCntPtr>
-OnDiskCodeCompletionCache::getFromFile(StringRef filename) {
+OnDiskCodeCompletionCache::getFromFile(StringRef filename,
+                                       StringRef NamePrefix) {
   // Try to find the cached file.
-  auto bufferOrErr = llvm::MemoryBuffer::getFile(filename);
+  auto bufferOrErr = openCachedModule(filename);
   if (!bufferOrErr)
     return None;
 
@@ -470,7 +602,7 @@ OnDiskCodeCompletionCache::getFromFile(StringRef filename) {
   // Read the cached results.
   auto V = CodeCompletionCache::createValue();
   if (!readCachedModule(bufferOrErr.get().get(), K, *V,
-                        /*allowOutOfDate*/ true))
+                        /*allowOutOfDate*/ true, NamePrefix))
     return None;
 
   return V;
@@ -725,8 +725,7 @@ void IRGenModuleDispatcher::emitGlobalTopLevel() {
   }
 
   // Emit static initializers.
-  for (auto Iter : *this) {
-    IRGenModule *IGM = Iter.second;
+  for (IRGenModule *IGM : *this) {
     IGM->emitSILStaticInitializer();
   }
 
@@ -736,8 +735,7 @@ void IRGenModuleDispatcher::emitGlobalTopLevel() {
     IGM->emitSILWitnessTable(&wt);
   }
   
-  for (auto Iter : *this) {
-    IRGenModule *IGM = Iter.second;
+  for (IRGenModule *IGM : *this) {
     IGM->finishEmitAfterTopLevel();
   }
 }
@@ -783,8 +781,8 @@ static void emitLazyTypeMetadata(IRGenModule &IGM, CanType type) {
 }
 
 void IRGenModuleDispatcher::emitProtocolConformances() {
-  for (auto &m : *this) {
-    m.second->emitProtocolConformances();
+  for (IRGenModule *IGM : *this) {
+    IGM->emitProtocolConformances();
   }
 }
 
@@ -481,7 +481,29 @@ static std::unique_ptr<llvm::Module> performIRGeneration(IRGenOptions &Opts,
   return std::unique_ptr<llvm::Module>(IGM.releaseModule());
 }
 
+/// Update the linkage of shared functions/globals.
+/// If a shared function/global is referenced from another file it must have
+/// weak instead of linkonce linkage. Otherwise LLVM would remove the
+/// definition (if it's not referenced in the same file).
+static void updateSharedLinkage(llvm::Module *M,
+                                const llvm::StringSet<> &referencedGlobals) {
+  auto updateLinkage = [&](llvm::GlobalObject &G) {
+    if (!G.isDeclaration()
+        && G.getLinkage() == GlobalValue::LinkOnceODRLinkage
+        && referencedGlobals.count(G.getName()) != 0) {
+      G.setLinkage(GlobalValue::WeakODRLinkage);
+    }
+  };
+  for (llvm::GlobalVariable &G : M->getGlobalList()) {
+    updateLinkage(G);
+  }
+  for (llvm::Function &F : M->getFunctionList()) {
+    updateLinkage(F);
+  }
+}
+
 static void ThreadEntryPoint(IRGenModuleDispatcher *dispatcher,
+                             const llvm::StringSet<> *referencedGlobals,
                              llvm::sys::Mutex *DiagMutex, int ThreadIdx) {
   while (IRGenModule *IGM = dispatcher->fetchFromQueue()) {
     DEBUG(
@@ -490,6 +512,9 @@ static void ThreadEntryPoint(IRGenModuleDispatcher *dispatcher,
           "\n";
       DiagMutex->unlock();
     );
+    // Each IRGenModule has its own LLVMContext, so anything which only
+    // touches the LLVM module can be done here, in parallel.
+    updateSharedLinkage(IGM->getModule(), *referencedGlobals);
     embedBitcode(IGM->getModule(), IGM->Opts);
     performLLVM(IGM->Opts, IGM->Context.Diags, DiagMutex, IGM->getModule(),
                 IGM->TargetMachine, IGM->OutputFilename);
@@ -513,15 +538,30 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
   IRGenModuleDispatcher dispatcher;
   
   auto OutputIter = Opts.OutputFilenames.begin();
-  bool IGMcreated = false;
   
   auto &Ctx = M->getASTContext();
-  // Create an IRGenModule for each source file.
+  SmallVector<SourceFile *, 8> SourceFiles;
   for (auto *File : M->getFiles()) {
     auto nextSF = dyn_cast<SourceFile>(File);
-    if (!nextSF || nextSF->ASTStage < SourceFile::TypeChecked)
-      continue;
-    
+    if (nextSF && nextSF->ASTStage >= SourceFile::TypeChecked)
+      SourceFiles.push_back(nextSF);
+  }
+  
+  if (SourceFiles.empty()) {
+    // TODO: Check this already at argument parsing.
+    Ctx.Diags.diagnose(SourceLoc(), diag::no_input_files_for_mt);
+    return;
+  }
+
+  // By default there is an IRGenModule for each source file. If the functions
+  // are distributed over the IRGenModules by size, there is one for each
+  // thread instead, however many source files there are.
+  unsigned numGenModules = SourceFiles.size();
+  if (Opts.BalanceCodeGenUnits)
+    numGenModules = numThreads;
+
+  SmallVector<IRGenModule *, 8> IGMs;
+  for (unsigned Idx = 0; Idx != numGenModules; ++Idx) {
     // Create a target machine.
     llvm::TargetMachine *TargetMachine = createTargetMachine(Opts, Ctx);
     
@@ -530,29 +570,38 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
     LLVMContext *Context = new LLVMContext();
     const llvm::Triple &Triple = Ctx.LangOpts.Target;
 
-    // There must be an output filename for each source file.
+    // There must be an output filename for each IRGenModule.
     // We ignore additional output filenames.
     if (OutputIter == Opts.OutputFilenames.end()) {
       // TODO: Check this already at argument parsing.
       Ctx.Diags.diagnose(SourceLoc(), diag::too_few_output_filenames);
       return;
     }
+
+    // If there are more IRGenModules than source files, the remaining ones
+    // only get the functions which are assigned to them.
+    SourceFile *SF = Idx < SourceFiles.size() ? SourceFiles[Idx] : nullptr;
   
     // Create the IR emitter.
-    IRGenModule *IGM = new IRGenModule(dispatcher, nextSF, Ctx, *Context,
+    IRGenModule *IGM = new IRGenModule(dispatcher, SF, Ctx, *Context,
                                        Opts, ModuleName, DataLayout, Triple,
                                        TargetMachine, SILMod, *OutputIter++);
-    IGMcreated = true;
+    IGMs.push_back(IGM);
 
     initLLVMModule(*IGM);
   }
-  
-  if (!IGMcreated) {
-    // TODO: Check this already at argument parsing.
-    Ctx.Diags.diagnose(SourceLoc(), diag::no_input_files_for_mt);
-    return;
+
+  // If there are fewer IRGenModules than source files, the remaining source
+  // files share the IRGenModules round-robin.
+  for (unsigned Idx = numGenModules, End = SourceFiles.size(); Idx < End;
+       ++Idx) {
+    dispatcher.addSourceFile(SourceFiles[Idx],
+                             IGMs[Idx % numGenModules]);
   }
 
+  if (Opts.BalanceCodeGenUnits)
+    dispatcher.partitionFunctionsBySize();
+
   // Emit the module contents.
   dispatcher.emitGlobalTopLevel();
   
@@ -605,8 +654,7 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
   
   llvm::StringSet<> referencedGlobals;
 
-  for (auto it = dispatcher.begin(); it != dispatcher.end(); ++it) {
-    IRGenModule *IGM = it->second;
+  for (IRGenModule *IGM : dispatcher) {
     llvm::Module *M = IGM->getModule();
     auto collectReference = [&](llvm::GlobalObject &G) {
       if (G.isDeclaration()
@@ -623,28 +671,9 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
     }
   }
 
-  for (auto it = dispatcher.begin(); it != dispatcher.end(); ++it) {
-    IRGenModule *IGM = it->second;
-    llvm::Module *M = IGM->getModule();
-    
-    // Update the linkage of shared functions/globals.
-    // If a shared function/global is referenced from another file it must have
-    // weak instead of linkonce linkage. Otherwise LLVM would remove the
-    // definition (if it's not referenced in the same file).
-    auto updateLinkage = [&](llvm::GlobalObject &G) {
-      if (!G.isDeclaration()
-          && G.getLinkage() == GlobalValue::LinkOnceODRLinkage
-          && referencedGlobals.count(G.getName()) != 0) {
-        G.setLinkage(GlobalValue::WeakODRLinkage);
-      }
-    };
-    for (llvm::GlobalVariable &G : M->getGlobalList()) {
-      updateLinkage(G);
-    }
-    for (llvm::Function &F : M->getFunctionList()) {
-      updateLinkage(F);
-    }
-
+  // Finalizing may still look at the AST, so it can't be moved into the
+  // threads. The linkage is updated there.
+  for (IRGenModule *IGM : dispatcher) {
     IGM->finalize();
     setModuleFlags(*IGM);
   }
@@ -652,16 +681,20 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
   // Bail out if there are any errors.
   if (Ctx.hadError()) return;
 
+  // Start with the largest modules, so that no thread is left with a big one
+  // at the end.
+  dispatcher.sortQueueByModuleSize();
+
   std::vector<std::thread> Threads;
   llvm::sys::Mutex DiagMutex;
 
   // Start all the threads an do the LLVM compilation.
   for (int ThreadIdx = 1; ThreadIdx < numThreads; ++ThreadIdx) {
-    Threads.push_back(std::thread(ThreadEntryPoint, &dispatcher, &DiagMutex,
-                                  ThreadIdx));
+    Threads.push_back(std::thread(ThreadEntryPoint, &dispatcher,
+                                  &referencedGlobals, &DiagMutex, ThreadIdx));
   }
 
-  ThreadEntryPoint(&dispatcher, &DiagMutex, 0);
+  ThreadEntryPoint(&dispatcher, &referencedGlobals, &DiagMutex, 0);
 
   // Wait for all threads.
   for (std::thread &Thread : Threads) {
@@ -669,8 +702,7 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
   }
 
   // Cleanup.
-  for (auto it = dispatcher.begin(); it != dispatcher.end(); ++it) {
-    IRGenModule *IGM = it->second;
+  for (IRGenModule *IGM : dispatcher) {
     LLVMContext *Context = &IGM->LLVMContext;
     delete IGM;
     delete Context;
@@ -20,6 +20,7 @@
 #include "swift/AST/IRGenOptions.h"
 #include "swift/Basic/Dwarf.h"
 #include "swift/ClangImporter/ClangImporter.h"
+#include "swift/SIL/SILModule.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/Basic/CharInfo.h"
 #include "clang/Basic/TargetInfo.h"
@@ -45,6 +46,7 @@
 #include "IRGenDebugInfo.h"
 #include "Linking.h"
 
+#include <algorithm>
 #include <initializer_list>
 
 using namespace swift;
@@ -802,16 +804,79 @@ void IRGenModule::error(SourceLoc loc, const Twine &message) {
 }
 
 void IRGenModuleDispatcher::addGenModule(SourceFile *SF, IRGenModule *IGM) {
-  assert(GenModules.count(SF) == 0);
-  GenModules[SF] = IGM;
+  if (SF)
+    addSourceFile(SF, IGM);
+  AllGenModules.push_back(IGM);
   if (!PrimaryIGM) {
     PrimaryIGM = IGM;
   }
   Queue.push_back(IGM);
 }
 
+void IRGenModuleDispatcher::addSourceFile(SourceFile *SF, IRGenModule *IGM) {
+  assert(GenModules.count(SF) == 0);
+  GenModules[SF] = IGM;
+}
+
+void IRGenModuleDispatcher::sortQueueByModuleSize() {
+  assert(QueueIndex == 0 && "queue is already being processed");
+
+  llvm::DenseMap<IRGenModule *, size_t> Sizes;
+  for (IRGenModule *IGM : Queue) {
+    size_t Size = 0;
+    for (llvm::Function &F : *IGM->getModule())
+      for (llvm::BasicBlock &BB : F)
+        Size += BB.size();
+    Sizes[IGM] = Size;
+  }
+
+  // Keep the original order for equally sized modules, so that the schedule
+  // is deterministic.
+  std::stable_sort(Queue.begin(), Queue.end(),
+                   [&](IRGenModule *LHS, IRGenModule *RHS) {
+    return Sizes[LHS] > Sizes[RHS];
+  });
+}
+
+void IRGenModuleDispatcher::partitionFunctionsBySize() {
+  if (!hasMultipleIGMs())
+    return;
+
+  std::vector<std::pair<SILFunction *, size_t>> Functions;
+  for (SILFunction &F : *PrimaryIGM->SILMod) {
+    if (!F.isDefinition())
+      continue;
+    size_t Size = 0;
+    for (SILBasicBlock &BB : F)
+      Size += std::distance(BB.begin(), BB.end());
+    Functions.push_back({&F, Size});
+  }
+
+  // Place the largest functions first, each into the IRGenModule with the
+  // fewest instructions so far. Ties go to the earlier function and the
+  // earlier IRGenModule.
+  std::stable_sort(Functions.begin(), Functions.end(),
+                   [](const std::pair<SILFunction *, size_t> &LHS,
+                      const std::pair<SILFunction *, size_t> &RHS) {
+    return LHS.second > RHS.second;
+  });
+
+  SmallVector<size_t, 8> Load(Queue.size(), 0);
+  for (auto &Entry : Functions) {
+    unsigned Smallest = 0;
+    for (unsigned Idx = 1, End = Load.size(); Idx != End; ++Idx) {
+      if (Load[Idx] < Load[Smallest])
+        Smallest = Idx;
+    }
+    // Count empty functions as one instruction, so that they are spread
+    // out as well.
+    Load[Smallest] += std::max(Entry.second, size_t(1));
+    FunctionPartition[Entry.first] = Queue[Smallest];
+  }
+}
+
 IRGenModule *IRGenModuleDispatcher::getGenModule(DeclContext *ctxt) {
-  if (GenModules.size() == 1 || !ctxt) {
+  if (!hasMultipleIGMs() || !ctxt) {
     return getPrimaryIGM();
   }
   SourceFile *SF = ctxt->getParentSourceFile();
@@ -824,10 +889,14 @@ IRGenModule *IRGenModuleDispatcher::getGenModule(DeclContext *ctxt) {
 }
 
 IRGenModule *IRGenModuleDispatcher::getGenModule(SILFunction *f) {
-  if (GenModules.size() == 1) {
+  if (!hasMultipleIGMs()) {
     return getPrimaryIGM();
   }
 
+  auto partitionIt = FunctionPartition.find(f);
+  if (partitionIt != FunctionPartition.end())
+    return partitionIt->second;
+
   if (DeclContext *ctxt = f->getDeclContext()) {
     if (SourceFile *SF = ctxt->getParentSourceFile()) {
       IRGenModule *IGM = GenModules[SF];
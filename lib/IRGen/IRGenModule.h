@@ -148,7 +148,8 @@ public:
 ///
 /// In single-threaded compilation IRGenModuleDispatcher contains a single
 /// IRGenModule. In multi-threaded compilation it contains multiple
-/// IRGenModules - one for each LLVM module (= one for each input/output file).
+/// IRGenModules - one for each LLVM module (= one for each output file). By
+/// default there is one LLVM module for each input file.
 class IRGenModuleDispatcher {
   
 public:
@@ -156,9 +157,14 @@ public:
     QueueIndex(0)
   {}
 
-  /// Add an IRGenModule for a source file.
+  /// Add an IRGenModule for a source file, or for no particular source file
+  /// if \p SF is null.
   /// Should only be called from IRGenModule's constructor.
   void addGenModule(SourceFile *SF, IRGenModule *IGM);
+
+  /// Emit the declarations of an additional source file into an existing
+  /// IRGenModule. Used if there are fewer IRGenModules than source files.
+  void addSourceFile(SourceFile *SF, IRGenModule *IGM);
   
   /// Get an IRGenModule for a source file.
   IRGenModule *getGenModule(SourceFile *SF) {
@@ -187,16 +193,25 @@ public:
     return PrimaryIGM;
   }
   
-  bool hasMultipleIGMs() const { return GenModules.size() >= 2; }
+  bool hasMultipleIGMs() const { return AllGenModules.size() >= 2; }
   
-  llvm::DenseMap<SourceFile *, IRGenModule *>::iterator begin() {
-    return GenModules.begin();
+  /// Iterates over the IRGenModules in the order they were added.
+  SmallVectorImpl<IRGenModule *>::iterator begin() {
+    return AllGenModules.begin();
   }
   
-  llvm::DenseMap<SourceFile *, IRGenModule *>::iterator end() {
-    return GenModules.end();
+  SmallVectorImpl<IRGenModule *>::iterator end() {
+    return AllGenModules.end();
   }
   
+  /// Assign the SIL function definitions to the IRGenModules so that all
+  /// IRGenModules get about the same number of SIL instructions. After this,
+  /// getGenModule(SILFunction *) ignores the source file of a function.
+  ///
+  /// The assignment only depends on the order of the functions in the SIL
+  /// module and on their sizes, so it is the same in every run.
+  void partitionFunctionsBySize();
+
   /// Emit functions, variables and tables which are needed anyway, e.g. because
   /// they are externally visible.
   void emitGlobalTopLevel();
@@ -237,6 +252,12 @@ public:
     return it->second;
   }
   
+  /// In multi-threaded compilation, reorder the queue so that the
+  /// IRGenModules with the most LLVM instructions are fetched first. This
+  /// keeps a large file from being compiled last while the other threads
+  /// are already idle. Must be called before any thread fetches from it.
+  void sortQueueByModuleSize();
+
   /// In multi-threaded compilation fetch the next IRGenModule from the queue.
   IRGenModule *fetchFromQueue() {
     int idx = QueueIndex++;
@@ -248,7 +269,13 @@ public:
 
 private:
   llvm::DenseMap<SourceFile *, IRGenModule *> GenModules;
+
+  // All IRGenModules, in the order they were added.
+  SmallVector<IRGenModule *, 8> AllGenModules;
   
+  // Stores the IGM of each function if the functions are partitioned by size.
+  llvm::DenseMap<SILFunction *, IRGenModule *> FunctionPartition;
+
   // Stores the IGM from which a function is referenced the first time.
   // It is used if a function has no source-file association.
   llvm::DenseMap<SILFunction *, IRGenModule *> DefaultIGMForFunction;
@@ -24,20 +24,33 @@
 #include "swift/AST/DiagnosticsFrontend.h"
 #include "swift/AST/IRGenOptions.h"
 #include "swift/AST/Module.h"
+#include "swift/AST/ModuleLoader.h"
 #include "swift/Frontend/Frontend.h"
 #include "swift/SILPasses/Passes.h"
+#include "swift/Basic/Demangle.h"
 #include "swift/Basic/LLVM.h"
+#include "swift/Basic/Version.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Config/config.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include <dlfcn.h>
+#include <unistd.h>
 
 using namespace swift;
 using namespace swift::immediate;
@@ -185,17 +198,15 @@ bool swift::immediate::linkLLVMModules(llvm::Module *Module,
   return !Failed;
 }
 
-bool swift::immediate::IRGenImportedModules(
-    CompilerInstance &CI,
-    llvm::Module &Module,
-    llvm::SmallPtrSet<swift::Module *, 8> &ImportedModules,
-    SmallVectorImpl<llvm::Function*> &InitFns,
-    IRGenOptions &IRGenOpts,
-    const SILOptions &SILOpts) {
+/// Collects the libraries the main module of \p CI and everything it
+/// imports link against.
+static void collectLinkLibraries(CompilerInstance &CI,
+                                 const IRGenOptions &IRGenOpts,
+                                 SmallVectorImpl<LinkLibrary> &AllLinkLibraries) {
   swift::Module *M = CI.getMainModule();
 
-  // Perform autolinking.
-  SmallVector<LinkLibrary, 4> AllLinkLibraries(IRGenOpts.LinkLibraries);
+  AllLinkLibraries.append(IRGenOpts.LinkLibraries.begin(),
+                          IRGenOpts.LinkLibraries.end());
   auto addLinkLibrary = [&](LinkLibrary linkLib) {
     AllLinkLibraries.push_back(linkLib);
   };
@@ -214,7 +225,20 @@ bool swift::immediate::IRGenImportedModules(
     next->collectLinkLibraries(addLinkLibrary);
     prev = next;
   }
+}
+
+bool swift::immediate::IRGenImportedModules(
+    CompilerInstance &CI,
+    llvm::Module &Module,
+    llvm::SmallPtrSet<swift::Module *, 8> &ImportedModules,
+    SmallVectorImpl<llvm::Function*> &InitFns,
+    IRGenOptions &IRGenOpts,
+    const SILOptions &SILOpts) {
+  swift::Module *M = CI.getMainModule();
 
+  // Perform autolinking.
+  SmallVector<LinkLibrary, 4> AllLinkLibraries;
+  collectLinkLibraries(CI, IRGenOpts, AllLinkLibraries);
   tryLoadLibraries(AllLinkLibraries, CI.getASTContext().SearchPathOpts,
                    CI.getDiags());
 
@@ -273,8 +297,317 @@ bool swift::immediate::IRGenImportedModules(
   return hadError;
 }
 
+namespace {
+/// Appends the address, size, and demangled name of every function the JIT
+/// emits to /tmp/perf-<pid>.map, which is where the Linux perf tool looks for
+/// symbols of code that doesn't come from a file on disk.
+class PerfMapJITEventListener : public llvm::JITEventListener {
+  std::unique_ptr<llvm::raw_fd_ostream> OS;
+
+  static std::string getDisplayName(StringRef name) {
+    // Mach-O symbols have an extra leading underscore.
+    if (name.startswith("__T"))
+      name = name.drop_front();
+    if (!name.startswith("_T"))
+      return name;
+    return Demangle::demangleSymbolAsString(name.data(), name.size());
+  }
+
+public:
+  PerfMapJITEventListener() {
+    std::string path = "/tmp/perf-" + llvm::utostr(getpid()) + ".map";
+    std::error_code EC;
+    OS.reset(new llvm::raw_fd_ostream(path, EC,
+                                      llvm::sys::fs::F_Append |
+                                      llvm::sys::fs::F_Text));
+    if (EC) {
+      llvm::errs() << "warning: cannot open '" << path << "': "
+                   << EC.message() << '\n';
+      OS.reset();
+    }
+  }
+
+  void NotifyObjectEmitted(const llvm::object::ObjectFile &obj,
+                           const llvm::RuntimeDyld::LoadedObjectInfo &L)
+      override {
+    if (!OS)
+      return;
+
+    // The debug copy of the object has its sections relocated to the
+    // addresses the code was loaded at.
+    auto debugObjOwner = L.getObjectForDebug(obj);
+    const llvm::object::ObjectFile *debugObj = debugObjOwner.getBinary();
+    if (!debugObj)
+      return;
+
+    for (auto &symAndSize : llvm::object::computeSymbolSizes(*debugObj)) {
+      llvm::object::SymbolRef sym = symAndSize.first;
+      uint64_t size = symAndSize.second;
+      if (sym.getType() != llvm::object::SymbolRef::ST_Function || size == 0)
+        continue;
+
+      llvm::ErrorOr<StringRef> name = sym.getName();
+      if (!name)
+        continue;
+      llvm::ErrorOr<uint64_t> address = sym.getAddress();
+      if (!address)
+        continue;
+
+      *OS << llvm::utohexstr(*address) << ' ' << llvm::utohexstr(size) << ' '
+          << getDisplayName(*name) << '\n';
+    }
+
+    // perf may read the map while the process is still running.
+    OS->flush();
+  }
+};
+} // end anonymous namespace
+
+void swift::immediate::enableJITProfiling(llvm::ExecutionEngine &EE) {
+  static PerfMapJITEventListener perfMapListener;
+  EE.RegisterJITEventListener(&perfMapListener);
+  EE.RegisterJITEventListener(
+    llvm::JITEventListener::createGDBRegistrationListener());
+}
+
+/// Builds the JIT that runs \p Module.
+static llvm::ExecutionEngine *
+createExecutionEngine(std::unique_ptr<llvm::Module> Module,
+                      IRGenOptions &IRGenOpts, ASTContext &Context) {
+  llvm::EngineBuilder builder(std::move(Module));
+  std::string ErrorMsg;
+  llvm::TargetOptions TargetOpt;
+  std::string CPU;
+  std::vector<std::string> Features;
+  std::tie(TargetOpt, CPU, Features)
+    = getIRTargetOptions(IRGenOpts, Context);
+  builder.setRelocationModel(llvm::Reloc::PIC_);
+  builder.setTargetOptions(TargetOpt);
+  builder.setMCPU(CPU);
+  builder.setMAttrs(Features);
+  builder.setErrorStr(&ErrorMsg);
+  builder.setEngineKind(llvm::EngineKind::JIT);
+  llvm::ExecutionEngine *EE = builder.create();
+  if (!EE) {
+    llvm::errs() << "Error loading JIT: " << ErrorMsg;
+    return nullptr;
+  }
+
+  if (IRGenOpts.EnableJITProfiling)
+    enableJITProfiling(*EE);
+
+  return EE;
+}
+
+//===----------------------------------------------------------------------===//
+// Immediate mode object code cache
+//===----------------------------------------------------------------------===//
+//
+// Each cache entry is a pair of files named after the cache key: "<key>.o"
+// holds the object code of the script, and "<key>.manifest" lists the files
+// the script imported, with the MD5 hash of their contents, and the libraries
+// it links against:
+//
+//   dependency <md5> <path>
+//   library <library|framework> <name>
+//
+// The manifest is written last, so an entry without one is never used.
+
+static std::string stringifyHash(llvm::MD5 &Hash) {
+  llvm::MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Str;
+  llvm::MD5::stringifyResult(Result, Str);
+  return Str.str();
+}
+
+/// Returns the MD5 hash of the contents of \p Path, or an empty string if it
+/// can't be read.
+static std::string hashFileContents(StringRef Path) {
+  auto Buffer = llvm::MemoryBuffer::getFile(Path);
+  if (!Buffer)
+    return "";
+  llvm::MD5 Hash;
+  Hash.update((*Buffer)->getBuffer());
+  return stringifyHash(Hash);
+}
+
+static void getCacheEntryPaths(StringRef CachePath, StringRef CacheKey,
+                               SmallVectorImpl<char> &ObjectPath,
+                               SmallVectorImpl<char> &ManifestPath) {
+  ObjectPath.assign(CachePath.begin(), CachePath.end());
+  llvm::sys::path::append(ObjectPath, CacheKey + ".o");
+  ManifestPath.assign(CachePath.begin(), CachePath.end());
+  llvm::sys::path::append(ManifestPath, CacheKey + ".manifest");
+}
+
+/// Writes \p Contents to a temporary file and renames it to \p Path, so that
+/// concurrent runs never see a partially written file.
+static bool writeFileAtomically(StringRef Path, StringRef Contents) {
+  SmallString<128> TempPath;
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", FD, TempPath))
+    return false;
+
+  {
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    Out << Contents;
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return false;
+    }
+  }
+
+  if (llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::sys::fs::remove(TempPath);
+    return false;
+  }
+  return true;
+}
+
+namespace {
+/// Stores the object code the JIT emits for a script, together with its
+/// manifest, in the immediate mode cache.
+class ImmediateObjectCache : public llvm::ObjectCache {
+  SmallString<128> ObjectPath;
+  SmallString<128> ManifestPath;
+  std::string Manifest;
+
+public:
+  ImmediateObjectCache(StringRef CachePath, StringRef CacheKey,
+                       StringRef Manifest)
+    : Manifest(Manifest) {
+    getCacheEntryPaths(CachePath, CacheKey, ObjectPath, ManifestPath);
+  }
+
+  void notifyObjectCompiled(const llvm::Module *M,
+                            llvm::MemoryBufferRef Obj) override {
+    // Failing to write the cache isn't an error; the script just gets
+    // compiled again next time.
+    if (writeFileAtomically(ObjectPath, Obj.getBuffer()))
+      writeFileAtomically(ManifestPath, Manifest);
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *M) override {
+    // Cached objects are loaded by RunImmediatelyFromCache before anything
+    // is compiled.
+    return nullptr;
+  }
+};
+} // end anonymous namespace
+
+std::string swift::getImmediateCacheKey(const CompilerInvocation &Invocation,
+                                        ArrayRef<const char *> Args) {
+  llvm::MD5 Hash;
+  auto addString = [&Hash](StringRef Str) {
+    static const uint8_t Separator = 0;
+    Hash.update(Str);
+    Hash.update(llvm::makeArrayRef(Separator));
+  };
+
+  addString(version::getSwiftFullVersion());
+
+  // Arguments after "--" are passed to the script and don't affect its code.
+  for (StringRef Arg : Args) {
+    if (Arg == "--")
+      break;
+    addString(Arg);
+  }
+
+  for (const std::string &Input : Invocation.getInputFilenames()) {
+    if (Input == "-")
+      return "";
+    auto Buffer = llvm::MemoryBuffer::getFile(Input);
+    if (!Buffer)
+      return "";
+    addString((*Buffer)->getBuffer());
+  }
+
+  return stringifyHash(Hash);
+}
+
+bool swift::RunImmediatelyFromCache(CompilerInstance &CI, StringRef CacheKey,
+                                    const ProcessCmdLine &CmdLine,
+                                    IRGenOptions &IRGenOpts, int &Result) {
+  SmallString<128> ObjectPath;
+  SmallString<128> ManifestPath;
+  getCacheEntryPaths(CI.getImmediateCachePath(), CacheKey, ObjectPath,
+                     ManifestPath);
+
+  auto Manifest = llvm::MemoryBuffer::getFile(ManifestPath);
+  if (!Manifest)
+    return false;
+
+  // Make sure nothing the script imported has changed, and find out which
+  // libraries it needs.
+  SmallVector<LinkLibrary, 4> LinkLibraries;
+  SmallVector<StringRef, 32> Lines;
+  (*Manifest)->getBuffer().split(Lines, "\n", -1, /*KeepEmpty=*/false);
+  for (StringRef Line : Lines) {
+    StringRef Kind, Field, Rest;
+    std::tie(Kind, Rest) = Line.split(' ');
+    std::tie(Field, Rest) = Rest.split(' ');
+    if (Kind == "dependency") {
+      if (hashFileContents(Rest) != Field) {
+        DEBUG(llvm::dbgs() << "Cached object code is out of date: " << Rest
+                           << " has changed\n");
+        return false;
+      }
+    } else if (Kind == "library") {
+      LibraryKind LibKind = Field == "framework" ? LibraryKind::Framework
+                                                : LibraryKind::Library;
+      LinkLibraries.push_back(LinkLibrary(Rest, LibKind));
+    } else {
+      return false;
+    }
+  }
+
+  auto Object = llvm::object::ObjectFile::createObjectFile(ObjectPath);
+  if (!Object)
+    return false;
+
+  ASTContext &Context = CI.getASTContext();
+  if (!loadSwiftRuntime(Context.SearchPathOpts.RuntimeLibraryPath))
+    return false;
+  tryLoadLibraries(LinkLibraries, Context.SearchPathOpts, CI.getDiags());
+
+  // The JIT needs a module to set itself up, even though all of the code
+  // comes from the cached object.
+  auto ModuleOwner = llvm::make_unique<llvm::Module>(CacheKey,
+                                                     llvm::getGlobalContext());
+  ModuleOwner->setTargetTriple(Context.LangOpts.Target.str());
+  llvm::ExecutionEngine *EE =
+    createExecutionEngine(std::move(ModuleOwner), IRGenOpts, Context);
+  if (!EE)
+    return false;
+
+  DEBUG(llvm::dbgs() << "Loading cached object code from " << ObjectPath
+                     << '\n');
+  EE->addObjectFile(std::move(*Object));
+  EE->finalizeObject();
+
+  uint64_t MainAddress = EE->getFunctionAddress("main");
+  if (!MainAddress)
+    return false;
+
+  std::vector<const char *> Argv;
+  for (const std::string &Arg : CmdLine)
+    Argv.push_back(Arg.c_str());
+  Argv.push_back(nullptr);
+
+  DEBUG(llvm::dbgs() << "Running main\n");
+  using MainFnTy = int (*)(int, const char **);
+  Result = reinterpret_cast<MainFnTy>(MainAddress)(CmdLine.size(),
+                                                   Argv.data());
+  return true;
+}
+
 int swift::RunImmediately(CompilerInstance &CI, const ProcessCmdLine &CmdLine,
-                          IRGenOptions &IRGenOpts, const SILOptions &SILOpts) {
+                          IRGenOptions &IRGenOpts, const SILOptions &SILOpts,
+                          StringRef CacheKey) {
   ASTContext &Context = CI.getASTContext();
   
   // IRGen the main module.
@@ -305,25 +638,41 @@ int swift::RunImmediately(CompilerInstance &CI, const ProcessCmdLine &CmdLine,
     return -1;
   }
 
+  // Only a script whose code all ends up in this module, and which doesn't
+  // need static constructors run, can be run from its object code alone.
+  std::unique_ptr<ImmediateObjectCache> ObjectCache;
+  if (!CacheKey.empty() && !CI.hasSourceImport() && InitFns.empty() &&
+      !Module->getNamedGlobal("llvm.global_ctors") &&
+      CI.getDependencyTracker() &&
+      !llvm::sys::fs::create_directories(CI.getImmediateCachePath())) {
+    std::string Manifest;
+    llvm::raw_string_ostream Out(Manifest);
+    for (StringRef Dependency : CI.getDependencyTracker()->getDependencies()) {
+      std::string Hash = hashFileContents(Dependency);
+      if (!Hash.empty())
+        Out << "dependency " << Hash << ' ' << Dependency << '\n';
+    }
+    SmallVector<LinkLibrary, 4> LinkLibraries;
+    collectLinkLibraries(CI, IRGenOpts, LinkLibraries);
+    for (const LinkLibrary &LinkLib : LinkLibraries) {
+      Out << "library "
+          << (LinkLib.getKind() == LibraryKind::Framework ? "framework"
+                                                          : "library")
+          << ' ' << LinkLib.getName() << '\n';
+    }
+    Out.flush();
+
+    ObjectCache.reset(new ImmediateObjectCache(CI.getImmediateCachePath(),
+                                               CacheKey, Manifest));
+  }
+
   // Build the ExecutionEngine.
-  llvm::EngineBuilder builder(std::move(ModuleOwner));
-  std::string ErrorMsg;
-  llvm::TargetOptions TargetOpt;
-  std::string CPU;
-  std::vector<std::string> Features;
-  std::tie(TargetOpt, CPU, Features)
-    = getIRTargetOptions(IRGenOpts, swiftModule->getASTContext());
-  builder.setRelocationModel(llvm::Reloc::PIC_);
-  builder.setTargetOptions(TargetOpt);
-  builder.setMCPU(CPU);
-  builder.setMAttrs(Features);
-  builder.setErrorStr(&ErrorMsg);
-  builder.setEngineKind(llvm::EngineKind::JIT);
-  llvm::ExecutionEngine *EE = builder.create();
-  if (!EE) {
-    llvm::errs() << "Error loading JIT: " << ErrorMsg;
+  llvm::ExecutionEngine *EE = createExecutionEngine(std::move(ModuleOwner),
+                                                    IRGenOpts, Context);
+  if (!EE)
     return -1;
-  }
+  if (ObjectCache)
+    EE->setObjectCache(ObjectCache.get());
 
   DEBUG(llvm::dbgs() << "Module to be executed:\n";
         Module->dump());
@@ -21,6 +21,7 @@
 #include "llvm/ADT/SmallVector.h"
 
 namespace llvm {
+  class ExecutionEngine;
   class Function;
   class Module;
 }
@@ -47,6 +48,10 @@ bool IRGenImportedModules(
     IRGenOptions &IRGenOpts,
     const SILOptions &SILOpts);
 
+/// Make the code \p EE emits visible to the Linux perf tool, through
+/// /tmp/perf-<pid>.map, and to debuggers, through the GDB JIT interface.
+void enableJITProfiling(llvm::ExecutionEngine &EE);
+
 } // end namespace immediate
 } // end namespace swift
 
@@ -964,6 +964,8 @@ public:
     builder.setErrorStr(&ErrorMsg);
     builder.setEngineKind(llvm::EngineKind::JIT);
     EE = builder.create();
+    if (EE && CI.getIRGenOptions().EnableJITProfiling)
+      enableJITProfiling(*EE);
 
     IRGenOpts.OutputFilenames.clear();
     IRGenOpts.Optimize = false;
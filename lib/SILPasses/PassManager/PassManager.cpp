@@ -13,15 +13,21 @@
 #define DEBUG_TYPE "sil-passmanager"
 
 #include "swift/SILPasses/PassManager.h"
+#include "swift/Basic/JSONSerialization.h"
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILModule.h"
+#include "swift/SILAnalysis/FunctionOrder.h"
 #include "swift/SILPasses/PrettyStackTrace.h"
 #include "swift/SILPasses/Transforms.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 using namespace swift;
 
@@ -71,10 +77,224 @@ llvm::cl::list<std::string>
                      llvm::cl::desc("Disable passes "
                                     "which contain a string from this list"));
 
+llvm::cl::opt<bool> SILFunctionPassesBottomUp(
+    "sil-function-passes-bottom-up", llvm::cl::init(false),
+    llvm::cl::desc("Run function passes on callees before their callers"));
+
 llvm::cl::opt<bool> SILVerifyWithoutInvalidation(
     "sil-verify-without-invalidation", llvm::cl::init(false),
     llvm::cl::desc("Verify after passes even if the pass has not invalidated"));
 
+llvm::cl::opt<std::string> SILPassStatsJSON(
+    "sil-pass-stats-json", llvm::cl::init(""),
+    llvm::cl::desc("Write per-pass and per-function timing and instruction "
+                   "count statistics as JSON to this file"));
+
+namespace {
+/// Statistics for one pass within one stage of the pipeline.
+struct PassStats {
+  std::string Name;
+  bool IsModulePass = false;
+  uint64_t Invocations = 0;
+  /// Invocations after which the pass had not invalidated anything.
+  uint64_t Unchanged = 0;
+  uint64_t TotalNanoseconds = 0;
+  uint64_t MaxNanoseconds = 0;
+  /// The function the slowest invocation ran on, if it was a function pass.
+  std::string MaxFunction;
+  uint64_t InstructionsBefore = 0;
+  uint64_t InstructionsAfter = 0;
+};
+
+struct StageStats {
+  std::string Name;
+  std::vector<PassStats> Passes;
+  llvm::StringMap<unsigned> PassIndices;
+};
+
+/// Statistics for all function pass invocations on one function.
+struct FunctionStats {
+  std::string Name;
+  uint64_t Invocations = 0;
+  uint64_t Unchanged = 0;
+  uint64_t TotalNanoseconds = 0;
+  /// The size of the function before the first pass ran on it.
+  uint64_t InitialInstructions = 0;
+  /// The size of the function after the last pass ran on it.
+  uint64_t FinalInstructions = 0;
+};
+
+/// Statistics collected across all pass managers of a compilation, for
+/// -sil-pass-stats-json.
+struct PassStatistics {
+  std::vector<StageStats> Stages;
+  llvm::StringMap<unsigned> StageIndices;
+  std::vector<FunctionStats> Functions;
+  llvm::StringMap<unsigned> FunctionIndices;
+
+  static PassStatistics &get() {
+    static PassStatistics Stats;
+    return Stats;
+  }
+
+  PassStats &getPass(StringRef Stage, SILTransform *T) {
+    auto StageIdx = StageIndices.insert({Stage, Stages.size()});
+    if (StageIdx.second) {
+      Stages.emplace_back();
+      Stages.back().Name = Stage;
+    }
+    StageStats &SS = Stages[StageIdx.first->getValue()];
+
+    auto PassIdx = SS.PassIndices.insert({T->getName(), SS.Passes.size()});
+    if (PassIdx.second) {
+      SS.Passes.emplace_back();
+      SS.Passes.back().Name = T->getName();
+      SS.Passes.back().IsModulePass = isa<SILModuleTransform>(T);
+    }
+    return SS.Passes[PassIdx.first->getValue()];
+  }
+
+  void record(StringRef Stage, SILTransform *T, SILFunction *F,
+              uint64_t Nanoseconds, bool Changed, uint64_t InstsBefore,
+              uint64_t InstsAfter) {
+    PassStats &PS = getPass(Stage, T);
+    ++PS.Invocations;
+    if (!Changed)
+      ++PS.Unchanged;
+    PS.TotalNanoseconds += Nanoseconds;
+    if (Nanoseconds >= PS.MaxNanoseconds) {
+      PS.MaxNanoseconds = Nanoseconds;
+      PS.MaxFunction = F ? F->getName() : "";
+    }
+    PS.InstructionsBefore += InstsBefore;
+    PS.InstructionsAfter += InstsAfter;
+
+    if (!F)
+      return;
+    auto FnIdx = FunctionIndices.insert({F->getName(), Functions.size()});
+    if (FnIdx.second) {
+      Functions.emplace_back();
+      Functions.back().Name = F->getName();
+      Functions.back().InitialInstructions = InstsBefore;
+    }
+    FunctionStats &FS = Functions[FnIdx.first->getValue()];
+    ++FS.Invocations;
+    if (!Changed)
+      ++FS.Unchanged;
+    FS.TotalNanoseconds += Nanoseconds;
+    FS.FinalInstructions = InstsAfter;
+  }
+
+  void write(StringRef Path);
+};
+} // end anonymous namespace
+
+namespace swift {
+namespace json {
+template <> struct ObjectTraits<PassStats> {
+  static void mapping(Output &out, PassStats &PS) {
+    out.mapRequired("name", PS.Name);
+    out.mapRequired("module-pass", PS.IsModulePass);
+    out.mapRequired("invocations", PS.Invocations);
+    out.mapRequired("unchanged", PS.Unchanged);
+    out.mapRequired("total-ns", PS.TotalNanoseconds);
+    out.mapRequired("max-ns", PS.MaxNanoseconds);
+    if (!PS.MaxFunction.empty())
+      out.mapRequired("max-function", PS.MaxFunction);
+    out.mapRequired("instructions-before", PS.InstructionsBefore);
+    out.mapRequired("instructions-after", PS.InstructionsAfter);
+  }
+};
+
+template <> struct ObjectTraits<StageStats> {
+  static void mapping(Output &out, StageStats &SS) {
+    out.mapRequired("name", SS.Name);
+    out.mapRequired("passes", SS.Passes);
+  }
+};
+
+template <> struct ObjectTraits<FunctionStats> {
+  static void mapping(Output &out, FunctionStats &FS) {
+    out.mapRequired("name", FS.Name);
+    out.mapRequired("invocations", FS.Invocations);
+    out.mapRequired("unchanged", FS.Unchanged);
+    out.mapRequired("total-ns", FS.TotalNanoseconds);
+    out.mapRequired("initial-instructions", FS.InitialInstructions);
+    out.mapRequired("final-instructions", FS.FinalInstructions);
+  }
+};
+
+template <> struct ObjectTraits<PassStatistics> {
+  static void mapping(Output &out, PassStatistics &Stats) {
+    out.mapRequired("stages", Stats.Stages);
+    out.mapRequired("functions", Stats.Functions);
+  }
+};
+
+/// Array traits for the vectors of statistics. Only the element types
+/// local to this file are specialized, so that no other translation unit can
+/// see a conflicting definition for std::vector.
+template <typename T> struct StatsArrayTraits {
+  static size_t size(Output &out, std::vector<T> &seq) {
+    return seq.size();
+  }
+  static T &element(Output &out, std::vector<T> &seq, size_t index) {
+    return seq[index];
+  }
+};
+
+template <> struct ArrayTraits<std::vector<PassStats>>
+  : StatsArrayTraits<PassStats> {};
+template <> struct ArrayTraits<std::vector<StageStats>>
+  : StatsArrayTraits<StageStats> {};
+template <> struct ArrayTraits<std::vector<FunctionStats>>
+  : StatsArrayTraits<FunctionStats> {};
+} // end namespace json
+} // end namespace swift
+
+void PassStatistics::write(StringRef Path) {
+  // Report the most expensive functions first. The indices are rebuilt
+  // because they refer to positions in the unsorted list.
+  std::stable_sort(Functions.begin(), Functions.end(),
+                   [](const FunctionStats &LHS, const FunctionStats &RHS) {
+    return LHS.TotalNanoseconds > RHS.TotalNanoseconds;
+  });
+  FunctionIndices.clear();
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    FunctionIndices[Functions[i].Name] = i;
+
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+  if (EC) {
+    llvm::errs() << "error: cannot write SIL pass statistics to '" << Path
+                 << "': " << EC.message() << "\n";
+    return;
+  }
+  json::Output Out(OS);
+  Out << *this;
+  OS << '\n';
+}
+
+static uint64_t countInstructions(SILFunction &F) {
+  uint64_t Count = 0;
+  for (auto &BB : F)
+    Count += std::distance(BB.begin(), BB.end());
+  return Count;
+}
+
+static uint64_t countInstructions(SILModule &M) {
+  uint64_t Count = 0;
+  for (auto &F : M)
+    Count += countInstructions(F);
+  return Count;
+}
+
+static uint64_t getNanoseconds(llvm::sys::TimeValue Delta) {
+  using llvm::sys::TimeValue;
+  return uint64_t(Delta.seconds()) * TimeValue::NANOSECONDS_PER_SECOND +
+         Delta.nanoseconds();
+}
+
 static bool doPrintBefore(SILTransform *T, SILFunction *F) {
   if (!SILPrintOnlyFun.empty() && F && F->getName() != SILPrintOnlyFun)
     return false;
@@ -156,81 +376,122 @@ SILPassManager::SILPassManager(SILModule *M, llvm::StringRef Stage) :
   }
 }
 
-bool SILPassManager::runFunctionPasses(PassList FuncTransforms) {
+bool SILPassManager::runPassesOnFunction(PassList FuncTransforms,
+                                         SILFunction *F) {
   const SILOptions &Options = getOptions();
 
-  for (auto &F : *Mod) {
-    if (F.empty())
+  if (F->empty())
+    return false;
+
+  // Don't optimize functions that are marked with the opt.never attribute.
+  if (!F->shouldOptimize())
+    return false;
+
+  CompletedPasses &completedPasses = CompletedPassesMap[F];
+
+  for (auto SFT : FuncTransforms) {
+    PrettyStackTraceSILFunctionTransform X(SFT);
+    SFT->injectPassManager(this);
+    SFT->injectFunction(F);
+    
+    // If nothing changed since the last run of this pass, we can skip this
+    // pass.
+    if (completedPasses.test((size_t)SFT->getPassKind()))
       continue;
 
-    // Don't optimize functions that are marked with the opt.never attribute.
-    if (!F.shouldOptimize())
+    if (isDisabled(SFT))
       continue;
 
-    CompletedPasses &completedPasses = CompletedPassesMap[&F];
+    currentPassHasInvalidated = false;
 
-    for (auto SFT : FuncTransforms) {
-      PrettyStackTraceSILFunctionTransform X(SFT);
-      SFT->injectPassManager(this);
-      SFT->injectFunction(&F);
-      
-      // If nothing changed since the last run of this pass, we can skip this
-      // pass.
-      if (completedPasses.test((size_t)SFT->getPassKind()))
-        continue;
+    if (SILPrintPassName)
+      llvm::dbgs() << "#" << NumPassesRun << " Stage: " << StageName
+                   << " Pass: " << SFT->getName()
+                   << ", Function: " << F->getName() << "\n";
 
-      if (isDisabled(SFT))
-        continue;
+    if (doPrintBefore(SFT, F)) {
+      llvm::dbgs() << "*** SIL function before " << StageName << " "
+                   << SFT->getName() << " (" << NumOptimizationIterations
+                   << ") ***\n";
+      F->dump(Options.EmitVerboseSIL);
+    }
 
-      currentPassHasInvalidated = false;
+    bool CollectStats = !SILPassStatsJSON.empty();
+    uint64_t InstsBefore = CollectStats ? countInstructions(*F) : 0;
 
-      if (SILPrintPassName)
-        llvm::dbgs() << "#" << NumPassesRun << " Stage: " << StageName
-                     << " Pass: " << SFT->getName()
-                     << ", Function: " << F.getName() << "\n";
+    llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
+    SFT->run();
 
-      if (doPrintBefore(SFT, &F)) {
-        llvm::dbgs() << "*** SIL function before " << StageName << " "
-                     << SFT->getName() << " (" << NumOptimizationIterations
-                     << ") ***\n";
-        F.dump(Options.EmitVerboseSIL);
-      }
+    if (CollectStats) {
+      auto Elapsed = llvm::sys::TimeValue::now() - StartTime;
+      PassStatistics::get().record(StageName, SFT, F, getNanoseconds(Elapsed),
+                                   currentPassHasInvalidated, InstsBefore,
+                                   countInstructions(*F));
+    }
 
-      llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
-      SFT->run();
+    if (SILPrintPassTime) {
+      auto Delta = llvm::sys::TimeValue::now().nanoseconds() -
+        StartTime.nanoseconds();
+      llvm::dbgs() << Delta << " (" << SFT->getName() << "," << F->getName()
+                   << ")\n";
+    }
 
-      if (SILPrintPassTime) {
-        auto Delta = llvm::sys::TimeValue::now().nanoseconds() -
-          StartTime.nanoseconds();
-        llvm::dbgs() << Delta << " (" << SFT->getName() << "," << F.getName()
-                     << ")\n";
-      }
+    // If this pass invalidated anything, print and verify.
+    if (doPrintAfter(SFT, F,
+                     currentPassHasInvalidated && SILPrintAll)) {
+      llvm::dbgs() << "*** SIL function after " << StageName << " "
+                   << SFT->getName() << " (" << NumOptimizationIterations
+                   << ") ***\n";
+      F->dump(Options.EmitVerboseSIL);
+    }
 
-      // If this pass invalidated anything, print and verify.
-      if (doPrintAfter(SFT, &F,
-                       currentPassHasInvalidated && SILPrintAll)) {
-        llvm::dbgs() << "*** SIL function after " << StageName << " "
-                     << SFT->getName() << " (" << NumOptimizationIterations
-                     << ") ***\n";
-        F.dump(Options.EmitVerboseSIL);
-      }
+    // Remember if this pass didn't change anything.
+    if (!currentPassHasInvalidated)
+      completedPasses.set((size_t)SFT->getPassKind());
 
-      // Remember if this pass didn't change anything.
-      if (!currentPassHasInvalidated)
-        completedPasses.set((size_t)SFT->getPassKind());
+    if (Options.VerifyAll &&
+        (currentPassHasInvalidated || SILVerifyWithoutInvalidation)) {
+      F->verify();
+      verifyAnalyses(F);
+    }
 
-      if (Options.VerifyAll &&
-          (currentPassHasInvalidated || SILVerifyWithoutInvalidation)) {
-        F.verify();
-        verifyAnalyses(&F);
-      }
+    ++NumPassesRun;
+    // Request that we stop this optimization phase.
+    if (Mod->getStage() == SILStage::Canonical
+        && NumPassesRun >= SILNumOptPassesToRun)
+      return true;
+  }
 
-      ++NumPassesRun;
-      // Request that we stop this optimization phase.
-      if (Mod->getStage() == SILStage::Canonical
-          && NumPassesRun >= SILNumOptPassesToRun)
+  return false;
+}
+
+bool SILPassManager::runFunctionPasses(PassList FuncTransforms) {
+  if (!SILFunctionPassesBottomUp) {
+    for (auto &F : *Mod) {
+      if (runPassesOnFunction(FuncTransforms, &F))
         return true;
     }
+    return false;
+  }
+
+  // Optimize callees before their callers, so that interprocedural analyses
+  // queried by a caller's passes see the callees in their final state for
+  // this round instead of being recomputed after each callee changes.
+  auto *BCA = getAnalysis<BasicCalleeAnalysis>();
+  BottomUpFunctionOrder BottomUpOrder(*Mod, BCA);
+  llvm::SmallPtrSet<SILFunction *, 32> Visited;
+  for (auto *F : BottomUpOrder.getFunctions()) {
+    Visited.insert(F);
+    if (runPassesOnFunction(FuncTransforms, F))
+      return true;
+  }
+
+  // Pick up functions that were created while running the passes.
+  for (auto &F : *Mod) {
+    if (Visited.count(&F))
+      continue;
+    if (runPassesOnFunction(FuncTransforms, &F))
+      return true;
   }
 
   return false;
@@ -297,9 +558,20 @@ void SILPassManager::runOneIteration() {
         printModule(Mod, Options.EmitVerboseSIL);
       }
 
+      bool CollectStats = !SILPassStatsJSON.empty();
+      uint64_t InstsBefore = CollectStats ? countInstructions(*Mod) : 0;
+
       llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
       SMT->run();
 
+      if (CollectStats) {
+        auto Elapsed = llvm::sys::TimeValue::now() - StartTime;
+        PassStatistics::get().record(StageName, SMT, nullptr,
+                                     getNanoseconds(Elapsed),
+                                     currentPassHasInvalidated, InstsBefore,
+                                     countInstructions(*Mod));
+      }
+
       if (SILPrintPassTime) {
         auto Delta = llvm::sys::TimeValue::now().nanoseconds() -
           StartTime.nanoseconds();
@@ -382,6 +654,11 @@ SILPassManager::~SILPassManager() {
            "Deleting a locked analysis. Did we forget to unlock ?");
     delete A;
   }
+
+  // Rewrite the statistics file with everything collected so far, so that it
+  // is complete after the last pass manager of the compilation goes away.
+  if (!SILPassStatsJSON.empty())
+    PassStatistics::get().write(SILPassStatsJSON);
 }
 
 /// \brief Reset the state of the pass manager and remove all transformation
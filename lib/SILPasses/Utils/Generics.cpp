@@ -15,9 +15,18 @@
 #include "swift/Strings.h"
 #include "swift/SILPasses/Utils/Generics.h"
 #include "swift/SILPasses/Utils/GenericCloner.h"
+#include "llvm/ADT/Statistic.h"
 
 using namespace swift;
 
+STATISTIC(NumSerializedSpecializationsReused,
+          "Number of specializations reused from serialized modules");
+
+static llvm::cl::opt<bool> ReuseSerializedSpecializations(
+    "sil-reuse-serialized-specializations", llvm::cl::init(false),
+    llvm::cl::desc("Reuse optimized specializations serialized into imported "
+                   "modules instead of specializing again"));
+
 // Create a new apply based on an old one, but with a different
 // function being applied.
 ApplySite swift::replaceWithSpecializedFunction(ApplySite AI,
@@ -176,14 +185,13 @@ static bool cacheSpecialization(SILModule &M, SILFunction *F) {
 /// Try to look up an existing specialization in the specialization cache.
 /// If it is found, it tries to link this specialization.
 ///
-/// For now, it performs a lookup only in the standard library.
-/// But in the future, one could think of maintaining a cache
-/// of optimized specializations.
+/// This performs a lookup only for the whitelisted prespecializations in the
+/// standard library. Optimized specializations serialized into other modules
+/// are found by lookupSerializedSpecialization.
 static SILFunction *lookupExistingSpecialization(SILModule &M,
                                                  StringRef FunctionName) {
   // Try to link existing specialization only in -Onone mode.
   // All other compilation modes perform specialization themselves.
-  // TODO: Cache optimized specializations and perform lookup here?
   // TODO: Only check that this function exists, but don't read
   // its body. It can save some compile-time.
   if (isWhitelistedSpecialization(FunctionName) &&
@@ -193,6 +201,50 @@ static SILFunction *lookupExistingSpecialization(SILModule &M,
   return nullptr;
 }
 
+/// Try to link an optimized specialization that an imported module has
+/// serialized, i.e. a specialization of a fragile generic function.
+///
+/// The mangled name identifies the generic function \p Orig and the
+/// substitutions \p Subs, so together with the expected function type it acts
+/// as the key of the cache. Returns null if there is no such specialization.
+/// Sets \p Mismatch if there is one, but it has an unexpected type and cannot
+/// be used.
+static SILFunction *lookupSerializedSpecialization(SILModule &M,
+                                                   StringRef FunctionName,
+                                                   SILFunction *Orig,
+                                                   ArrayRef<Substitution> Subs,
+                                                   bool &Mismatch) {
+  Mismatch = false;
+  if (!ReuseSerializedSpecializations)
+    return nullptr;
+
+  if (!M.linkFunction(FunctionName, SILOptions::LinkingMode::LinkNormal))
+    return nullptr;
+
+  auto *Specialization = M.lookUpFunction(FunctionName);
+  if (!Specialization)
+    return nullptr;
+
+  auto FTy = Orig->getLoweredFunctionType()->substGenericArgs(
+      M, M.getSwiftModule(), Subs);
+
+  // Only shared specializations are a copy of what we would produce
+  // ourselves. A public one is a prespecialization, which is handled by
+  // getExistingSpecialization.
+  if (!hasSharedVisibility(Specialization->getLinkage()) ||
+      Specialization->getLoweredFunctionType() != FTy) {
+    DEBUG(llvm::dbgs() << "    Cannot reuse serialized specialization: "
+                       << FunctionName << '\n');
+    Mismatch = true;
+    return nullptr;
+  }
+
+  DEBUG(llvm::dbgs() << "    Reusing serialized specialization: "
+                     << FunctionName << '\n');
+  ++NumSerializedSpecializationsReused;
+  return Specialization;
+}
+
 SILFunction *swift::getExistingSpecialization(SILModule &M,
                                               StringRef FunctionName) {
   auto *Specialization = lookupExistingSpecialization(M, FunctionName);
@@ -302,6 +354,20 @@ ApplySite swift::trySpecializeApplyOfGeneric(ApplySite Apply,
     if (M.getOptions().Optimization <= SILOptions::SILOptMode::None)
       return ApplySite();
 
+    // If an imported module already has an optimized copy of this
+    // specialization, link it instead of cloning and optimizing again.
+    bool Mismatch;
+    NewF = lookupSerializedSpecialization(M, ClonedName, F,
+                                          Apply.getSubstitutions(), Mismatch);
+    if (NewF) {
+      NewFunction = NewF;
+      return replaceWithSpecializedFunction(Apply, NewF);
+    }
+    // The name is taken by a function we cannot use, so there is no way to
+    // create the specialization either.
+    if (Mismatch)
+      return ApplySite();
+
     DEBUG(
       if (M.getOptions().Optimization <= SILOptions::SILOptMode::Debug) {
         llvm::dbgs() << "Creating a specialization: " << ClonedName << "\n"; });
@@ -131,9 +131,17 @@ Solution ConstraintSystem::finalize(
     solution.typeBindings[tv] = reconstituteSugar(simplifyType(tv));
   }
 
+  // When producing a partial solution, only record the decisions made
+  // within the partial solution's scope; everything before it is part of
+  // the state the partial solution will be applied on top of.
+  SolverScope *partialScope
+    = solverState ? solverState->PartialSolutionScope : nullptr;
+
   // For each of the overload sets, get its overload choice.
   for (auto resolved = resolvedOverloadSets;
-       resolved; resolved = resolved->Previous) {
+       resolved && (!partialScope ||
+                    resolved != partialScope->resolvedOverloadSets);
+       resolved = resolved->Previous) {
     solution.overloadChoices[resolved->Locator]
       = { resolved->Choice, resolved->OpenedFullType, resolved->ImpliedType };
   }
@@ -141,7 +149,10 @@ Solution ConstraintSystem::finalize(
   // For each of the constraint restrictions, record it with simplified,
   // canonical types.
   if (solverState) {
-    for (auto &restriction : ConstraintRestrictions) {
+    unsigned firstRestriction
+      = partialScope ? partialScope->numConstraintRestrictions : 0;
+    for (auto &restriction : llvm::makeArrayRef(ConstraintRestrictions)
+                               .slice(firstRestriction)) {
       using std::get;
       CanType first = simplifyType(get<0>(restriction))->getCanonicalType();
       CanType second = simplifyType(get<1>(restriction))->getCanonicalType();
@@ -152,13 +163,16 @@ Solution ConstraintSystem::finalize(
   // For each of the fixes, record it as an operation on the affected
   // expression.
   unsigned firstFixIndex = 0;
-  if (solverState && solverState->PartialSolutionScope) {
-    firstFixIndex = solverState->PartialSolutionScope->numFixes;
+  if (partialScope) {
+    firstFixIndex = partialScope->numFixes;
   }
   solution.Fixes.append(Fixes.begin() + firstFixIndex, Fixes.end());
 
   // Remember all the disjunction choices we made.
-  for (auto &choice : DisjunctionChoices) {
+  unsigned firstDisjunctionChoice
+    = partialScope ? partialScope->numDisjunctionChoices : 0;
+  for (auto &choice : llvm::makeArrayRef(DisjunctionChoices)
+                        .slice(firstDisjunctionChoice)) {
     // We shouldn't ever register disjunction choices multiple times,
     // but saving and re-applying solutions can cause us to get
     // multiple entries.  We should use an optimized PartialSolution
@@ -170,7 +184,9 @@ Solution ConstraintSystem::finalize(
   }
 
   // Remember the opened types.
-  for (const auto &opened : OpenedTypes) {
+  unsigned firstOpenedType = partialScope ? partialScope->numOpenedTypes : 0;
+  for (const auto &opened : llvm::makeArrayRef(OpenedTypes)
+                              .slice(firstOpenedType)) {
     // We shouldn't ever register opened types multiple times,
     // but saving and re-applying solutions can cause us to get
     // multiple entries.  We should use an optimized PartialSolution
@@ -183,7 +199,11 @@ Solution ConstraintSystem::finalize(
   }
 
   // Remember the opened existential types.
-  for (const auto &openedExistential : OpenedExistentialTypes) {
+  unsigned firstOpenedExistential
+    = partialScope ? partialScope->numOpenedExistentialTypes : 0;
+  for (const auto &openedExistential
+         : llvm::makeArrayRef(OpenedExistentialTypes)
+             .slice(firstOpenedExistential)) {
     assert(solution.OpenedExistentialTypes.count(openedExistential.first) == 0||
            solution.OpenedExistentialTypes[openedExistential.first]
              == openedExistential.second &&
@@ -412,6 +432,11 @@ ConstraintSystem::SolverState::~SolverState() {
   LangOptions &langOpts = CS.getTypeChecker().Context.LangOpts;
   langOpts.DebugConstraintSolver = OldDebugConstraintSolver;
 
+  // Account the work done to the expression being type-checked.
+  TypeChecker &TC = CS.getTypeChecker();
+  TC.NumSolverStatesExplored += NumStatesExplored;
+  TC.NumSolverDisjunctions += NumDisjunctions;
+
   // Write our local statistics back to the overall statistics.
   #define CS_STATISTIC(Name, Description) JOIN2(Overall,Name) += Name;
   #include "ConstraintSolverStats.def"
@@ -1205,6 +1230,56 @@ bool ConstraintSystem::solve(SmallVectorImpl<Solution> &solutions,
   return solutions.empty();
 }
 
+/// Copy a solution. Solutions are move-only so that they aren't copied by
+/// accident; memoized component solutions are handed out repeatedly.
+static Solution copySolution(const Solution &solution) {
+  Solution copy(solution.getConstraintSystem(), solution.getFixedScore());
+  copy.typeBindings = solution.typeBindings;
+  copy.overloadChoices = solution.overloadChoices;
+  copy.ConstraintRestrictions = solution.ConstraintRestrictions;
+  copy.Fixes = solution.Fixes;
+  copy.DisjunctionChoices = solution.DisjunctionChoices;
+  copy.OpenedTypes = solution.OpenedTypes;
+  copy.OpenedExistentialTypes = solution.OpenedExistentialTypes;
+  return copy;
+}
+
+void ConstraintSystem::profileComponent(
+       llvm::FoldingSetNodeID &id,
+       FreeTypeVariableBinding allowFreeTypeVariables) {
+  // The component is identified by its constraints, which are only shared
+  // between paths that haven't regenerated them...
+  llvm::SmallPtrSet<TypeVariableType *, 16> referencedTypeVars;
+  for (auto &constraint : InactiveConstraints) {
+    id.AddPointer(&constraint);
+    id.AddBoolean(constraint.isFavored());
+    for (auto typeVar : constraint.getTypeVariables())
+      referencedTypeVars.insert(typeVar);
+  }
+
+  // ...and by what each of the type variables they mention currently
+  // resolves to, which also captures equivalence classes formed so far.
+  id.AddInteger(referencedTypeVars.size());
+  for (auto &constraint : InactiveConstraints) {
+    for (auto typeVar : constraint.getTypeVariables()) {
+      if (referencedTypeVars.erase(typeVar))
+        id.AddPointer(simplifyType(typeVar).getPointer());
+    }
+  }
+
+  // The current and best scores determine which solutions get pruned.
+  for (unsigned i = 0; i != NumScoreKinds; ++i)
+    id.AddInteger(CurrentScore.Data[i]);
+  id.AddBoolean(solverState->BestScore.hasValue());
+  if (solverState->BestScore) {
+    for (unsigned i = 0; i != NumScoreKinds; ++i)
+      id.AddInteger(solverState->BestScore->Data[i]);
+  }
+
+  id.AddInteger(static_cast<unsigned>(allowFreeTypeVariables));
+  id.AddBoolean(HandlingFavoredConstraint);
+}
+
 bool ConstraintSystem::solveRec(SmallVectorImpl<Solution> &solutions,
                                 FreeTypeVariableBinding allowFreeTypeVariables){
   // If we already failed, or simplification fails, we're done.
@@ -1317,14 +1392,52 @@ bool ConstraintSystem::solveRec(SmallVectorImpl<Solution> &solutions,
     // substituted all of those other type variables through.
     llvm::SmallVector<TypeVariableType *, 16> allTypeVariables 
       = std::move(TypeVariables);
+    llvm::SmallVector<TypeVariableType *, 4> boundTypeVariables;
     for (auto typeVar : allTypeVariables) {
       auto known = typeVarComponent.find(typeVar);
       if (known != typeVarComponent.end() && known->second != component)
         continue;
 
       TypeVariables.push_back(typeVar);
+      if (getFixedType(typeVar))
+        boundTypeVariables.push_back(typeVar);
     }
-    
+
+    // If an identical component was already solved along another path,
+    // e.g., for a different choice in an enclosing disjunction, reuse its
+    // solutions rather than exploring it again.
+    bool canMemoize = !solverState->recordFailures;
+    llvm::FoldingSetNodeID memoKey;
+    void *memoInsertPos = nullptr;
+    MemoizedComponent *memo = nullptr;
+    if (canMemoize) {
+      profileComponent(memoKey, allowFreeTypeVariables);
+      memo = solverState->ComponentMemo.FindNodeOrInsertPos(memoKey,
+                                                            memoInsertPos);
+    }
+    if (memo) {
+      ++solverState->NumComponentMemoHits;
+      if (TC.getLangOpts().DebugConstraintSolver) {
+        auto &log = getASTContext().TypeCheckerDebug->getStream();
+        log.indent(solverState->depth * 2)
+          << "(reusing " << (memo->Failed ? "failure" : "solutions")
+          << " for component #" << component << ")\n";
+      }
+
+      auto &bucket = constraintBuckets[component];
+      bucket.splice(bucket.end(), InactiveConstraints);
+      TypeVariables = std::move(allTypeVariables);
+
+      if (memo->Failed) {
+        returnAllConstraints();
+        return true;
+      }
+
+      for (const auto &solution : memo->Solutions)
+        partialSolutions[component].push_back(copySolution(solution));
+      continue;
+    }
+
     // Solve for this component. If it fails, we're done.
     bool failed;
     if (TC.getLangOpts().DebugConstraintSolver) {
@@ -1345,7 +1458,22 @@ bool ConstraintSystem::solveRec(SmallVectorImpl<Solution> &solutions,
     // Put the constraints back into their original bucket.
     auto &bucket = constraintBuckets[component];
     bucket.splice(bucket.end(), InactiveConstraints);
-    
+
+    // Remember the result for this component, unless the solver gave up
+    // part way through. Components memoized while solving this one may
+    // have invalidated the insertion position, so look it up again.
+    MemoizedComponent *newMemo = nullptr;
+    if (canMemoize && !getExpressionTooComplex() &&
+        !solverState->ComponentMemo.FindNodeOrInsertPos(memoKey,
+                                                        memoInsertPos)) {
+      ++solverState->NumComponentMemoMisses;
+      newMemo = new MemoizedComponent;
+      newMemo->Key = memoKey;
+      newMemo->Failed = failed;
+      solverState->ComponentMemoStorage.emplace_back(newMemo);
+      solverState->ComponentMemo.InsertNode(newMemo, memoInsertPos);
+    }
+
     if (failed) {
       if (TC.getLangOpts().DebugConstraintSolver) {
         auto &log = getASTContext().TypeCheckerDebug->getStream();
@@ -1371,9 +1499,17 @@ bool ConstraintSystem::solveRec(SmallVectorImpl<Solution> &solutions,
     TypeVariables = std::move(allTypeVariables);
 
     // For each of the partial solutions, substract off the current score.
-    // It doesn't contribute.
-    for (auto &solution : partialSolutions[component])
+    // It doesn't contribute. Drop the bindings of type variables that were
+    // bound before the component was solved, too; they belong to the state
+    // the partial solution is applied on top of.
+    for (auto &solution : partialSolutions[component]) {
       solution.getFixedScore() -= CurrentScore;
+      for (auto typeVar : boundTypeVariables)
+        solution.typeBindings.erase(typeVar);
+
+      if (newMemo)
+        newMemo->Solutions.push_back(copySolution(solution));
+    }
 
     // Restore the previous best score.
     solverState->BestScore = PreviousBestScore;
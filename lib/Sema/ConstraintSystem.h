@@ -31,6 +31,7 @@
 #include "swift/AST/Types.h"
 #include "swift/AST/TypeCheckerDebugConsumer.h"
 #include "llvm/ADT/Fixnum.h"
+#include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/SmallPtrSet.h"
@@ -38,6 +39,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include <cstddef>
 #include <functional>
+#include <memory>
 
 namespace swift {
 
@@ -1258,6 +1260,23 @@ private:
   SmallVector<std::pair<ConstraintLocator *, ArchetypeType *>, 4>
     OpenedExistentialTypes;
 
+  /// \brief The solutions computed for a connected component of the
+  /// constraint graph, remembered so that an identical component reached
+  /// along another path of the solver is not explored again.
+  struct MemoizedComponent : public llvm::FoldingSetNode {
+    /// The constraints, bound types and scores the solutions depend on.
+    llvm::FoldingSetNodeID Key;
+
+    /// Whether the component failed to solve.
+    bool Failed = false;
+
+    /// The partial solutions, with scores relative to the score at which
+    /// the component was solved.
+    SmallVector<Solution, 4> Solutions;
+
+    void Profile(llvm::FoldingSetNodeID &ID) const { ID = Key; }
+  };
+
   /// \brief Describes the current solver state.
   struct SolverState {
     SolverState(ConstraintSystem &cs);
@@ -1297,6 +1316,13 @@ private:
     /// Refers to the innermost partial solution scope.
     SolverScope *PartialSolutionScope = nullptr;
 
+    /// Connected components solved so far, keyed by the constraints
+    /// they contain and the types bound to their type variables.
+    llvm::FoldingSet<MemoizedComponent> ComponentMemo;
+
+    /// Owns the entries of \c ComponentMemo.
+    std::vector<std::unique_ptr<MemoizedComponent>> ComponentMemoStorage;
+
     // Statistics
     #define CS_STATISTIC(Name, Description) unsigned Name = 0;
     #include "ConstraintSolverStats.def"
@@ -2297,6 +2323,11 @@ private:
   /// \returns true if an error occurred, false otherwise.
   bool solveSimplified(SmallVectorImpl<Solution> &solutions,
                        FreeTypeVariableBinding allowFreeTypeVariables);
+
+  /// \brief Compute the memoization key for the connected component whose
+  /// constraints are currently in \c InactiveConstraints.
+  void profileComponent(llvm::FoldingSetNodeID &id,
+                        FreeTypeVariableBinding allowFreeTypeVariables);
  public:
   /// \brief Solve the system of constraints.
   ///
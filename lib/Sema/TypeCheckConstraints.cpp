@@ -1130,6 +1130,11 @@ bool TypeChecker::typeCheckExpression(Expr *&expr, DeclContext *dc,
                                       ExprTypeCheckListener *listener) {
   PrettyStackTraceExpr stackTrace(Context, "type-checking", expr);
 
+  // Time the outermost expression being type-checked.
+  Optional<TypeCheckingTimer> timer;
+  if (isTimingExpressions() && !TimingExpression)
+    timer.emplace(*this, expr);
+
   // Construct a constraint system from this expression.
   ConstraintSystem cs(*this, dc, ConstraintSystemFlags::AllowFixes);
   CleanupIllFormedExpressionRAII cleanup(Context, expr);
@@ -1208,6 +1208,9 @@ bool TypeChecker::typeCheckAbstractFunctionBody(AbstractFunctionDecl *AFD) {
   Optional<FunctionBodyTimer> timer;
   if (DebugTimeFunctionBodies)
     timer.emplace(AFD);
+  Optional<TypeCheckingTimer> profile;
+  if (isTimingFunctionBodies())
+    profile.emplace(*this, AFD);
 
   if (typeCheckAbstractFunctionBodyUntil(AFD, SourceLoc()))
     return true;
@@ -1452,6 +1455,9 @@ void TypeChecker::typeCheckClosureBody(ClosureExpr *closure) {
   Optional<FunctionBodyTimer> timer;
   if (DebugTimeFunctionBodies)
     timer.emplace(closure);
+  Optional<TypeCheckingTimer> profile;
+  if (isTimingFunctionBodies())
+    profile.emplace(*this, closure);
 
   StmtChecker(*this, closure).typeCheckBody(body);
   if (body) {
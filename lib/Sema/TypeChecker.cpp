@@ -38,6 +38,7 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/Format.h"
 #include <algorithm>
 
 using namespace swift;
@@ -58,6 +59,71 @@ TypeChecker::~TypeChecker() {
   clangImporter->clearTypeResolver();
 
   Context.setLazyResolver(nullptr);
+
+  if (DebugTimeExpressions && !TypeCheckingTimes.empty()) {
+    std::stable_sort(TypeCheckingTimes.begin(), TypeCheckingTimes.end(),
+                     [](const TypeCheckingTime &lhs,
+                        const TypeCheckingTime &rhs) {
+      return lhs.Milliseconds > rhs.Milliseconds;
+    });
+
+    auto &out = llvm::errs();
+    for (auto &time : TypeCheckingTimes) {
+      out << llvm::format("%0.1f", time.Milliseconds) << "ms\t";
+      time.Loc.print(out, Context.SourceMgr);
+      out << "\t" << time.NumStatesExplored << " states\t"
+          << time.NumDisjunctions << " disjunctions\t";
+      if (auto *AFD = time.Subject.dyn_cast<const AbstractFunctionDecl *>())
+        AFD->print(out, PrintOptions());
+      else if (time.IsFunctionBody)
+        out << "(closure)";
+      else
+        out << "(expression)";
+      out << "\n";
+    }
+  }
+}
+
+void TypeChecker::recordTypeCheckingTime(const TypeCheckingTime &time) {
+  auto limit = Context.LangOpts.WarnLongExpressionTypeChecking;
+  if (limit && !time.IsFunctionBody && time.Milliseconds >= *limit) {
+    diagnose(time.Loc, diag::debug_long_expression,
+             static_cast<unsigned>(time.Milliseconds), *limit);
+  }
+
+  if (DebugTimeExpressions)
+    TypeCheckingTimes.push_back(time);
+}
+
+TypeCheckingTimer::TypeCheckingTimer(TypeChecker &TC, const Expr *expr)
+  : TC(TC), Time{expr, /*IsFunctionBody=*/false, expr->getLoc(), 0,
+                 TC.NumSolverStatesExplored, TC.NumSolverDisjunctions},
+    OldTimingExpression(TC.TimingExpression) {
+  TC.TimingExpression = true;
+}
+
+TypeCheckingTimer::TypeCheckingTimer(TypeChecker &TC,
+                                     const AbstractFunctionDecl *AFD)
+  : TC(TC), Time{AFD, /*IsFunctionBody=*/true, AFD->getLoc(), 0,
+                 TC.NumSolverStatesExplored, TC.NumSolverDisjunctions},
+    OldTimingExpression(TC.TimingExpression) {}
+
+TypeCheckingTimer::TypeCheckingTimer(TypeChecker &TC,
+                                     const AbstractClosureExpr *closure)
+  : TC(TC), Time{closure, /*IsFunctionBody=*/true, closure->getLoc(), 0,
+                 TC.NumSolverStatesExplored, TC.NumSolverDisjunctions},
+    OldTimingExpression(TC.TimingExpression) {}
+
+TypeCheckingTimer::~TypeCheckingTimer() {
+  llvm::TimeRecord endTime = llvm::TimeRecord::getCurrentTime(false);
+  Time.Milliseconds = (endTime.getWallTime() - StartTime.getWallTime()) * 1000;
+
+  // The counts were seeded with the totals at the start; make them deltas.
+  Time.NumStatesExplored = TC.NumSolverStatesExplored - Time.NumStatesExplored;
+  Time.NumDisjunctions = TC.NumSolverDisjunctions - Time.NumDisjunctions;
+
+  TC.TimingExpression = OldTimingExpression;
+  TC.recordTypeCheckingTime(Time);
 }
 
 void TypeChecker::handleExternalDecl(Decl *decl) {
@@ -522,6 +588,9 @@ void swift::performTypeChecking(SourceFile &SF, TopLevelContext &TLC,
     if (Options.contains(TypeCheckingFlags::DebugTimeFunctionBodies))
       TC.enableDebugTimeFunctionBodies();
 
+    if (Options.contains(TypeCheckingFlags::DebugTimeExpressionTypeChecking))
+      TC.enableDebugTimeExpressions();
+
     if (Options.contains(TypeCheckingFlags::ForImmediateMode))
       TC.setInImmediateMode(true);
     
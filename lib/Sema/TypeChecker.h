@@ -29,7 +29,9 @@
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/OptionSet.h"
 #include "swift/Config.h"
+#include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/Support/Timer.h"
 #include <functional>
 
 namespace swift {
@@ -425,6 +427,21 @@ inline ConformanceCheckOptions operator|(ConformanceCheckFlags lhs,
   return ConformanceCheckOptions(lhs) | rhs;
 }
 
+/// The wall time and constraint solver work spent type-checking an
+/// expression or function body.
+struct TypeCheckingTime {
+  /// The function or closure whose body was checked, or the expression.
+  llvm::PointerUnion<const AbstractFunctionDecl *, const Expr *> Subject;
+
+  /// Whether this is the time spent checking a function or closure body.
+  bool IsFunctionBody;
+
+  SourceLoc Loc;
+  double Milliseconds;
+  unsigned NumStatesExplored;
+  unsigned NumDisjunctions;
+};
+
 /// The Swift type checker, which takes a parsed AST and performs name binding,
 /// type checking, and semantic analysis to produce a type-annotated AST.
 class TypeChecker final : public LazyResolver {
@@ -432,6 +449,16 @@ public:
   ASTContext &Context;
   DiagnosticEngine &Diags;
 
+  /// The number of constraint solver states explored and disjunctions
+  /// attempted so far, used to attribute solver work to the expression or
+  /// function body being type-checked.
+  unsigned NumSolverStatesExplored = 0;
+  unsigned NumSolverDisjunctions = 0;
+
+  /// Whether an expression is currently being timed; nested expressions
+  /// are accounted to the outermost one.
+  bool TimingExpression = false;
+
   /// \brief The list of implicitly-defined functions created by the
   /// type checker.
   std::vector<AbstractFunctionDecl *> implicitlyDefinedFunctions;
@@ -542,6 +569,14 @@ private:
   /// to llvm::errs().
   bool DebugTimeFunctionBodies = false;
 
+  /// If true, the time and constraint solver work it takes to type-check
+  /// each expression and function body is recorded, and dumped to
+  /// llvm::errs() slowest first when the type checker is destroyed.
+  bool DebugTimeExpressions = false;
+
+  /// The expressions and function bodies timed so far.
+  std::vector<TypeCheckingTime> TypeCheckingTimes;
+
   /// Indicate that the type checker is checking code that will be
   /// immediately executed. This will suppress certain warnings
   /// when executing scripts.
@@ -564,6 +599,29 @@ public:
     DebugTimeFunctionBodies = true;
   }
 
+  /// Dump the time and solver work it takes to type-check each expression
+  /// and function body to llvm::errs(), slowest first.
+  void enableDebugTimeExpressions() {
+    DebugTimeExpressions = true;
+  }
+
+  /// Whether expressions are being timed, either for a report or to warn
+  /// about slow ones.
+  bool isTimingExpressions() const {
+    return DebugTimeExpressions ||
+           Context.LangOpts.WarnLongExpressionTypeChecking.hasValue();
+  }
+
+  /// Whether function and closure bodies are being timed. They only appear
+  /// in the report; the warning is for individual expressions.
+  bool isTimingFunctionBodies() const {
+    return DebugTimeExpressions;
+  }
+
+  /// Record the time spent type-checking an expression or function body,
+  /// warning if an expression exceeded the configured limit.
+  void recordTypeCheckingTime(const TypeCheckingTime &time);
+
   bool getInImmediateMode() {
     return InImmediateMode;
   }
@@ -1742,6 +1800,29 @@ public:
   void checkOmitNeedlessWords(MemberRefExpr *memberRef);
 };
 
+/// \brief RAII object that measures the time and constraint solver work spent
+/// type-checking an expression or function body and records it with the
+/// type checker.
+class TypeCheckingTimer {
+  TypeChecker &TC;
+  TypeCheckingTime Time;
+  bool OldTimingExpression;
+  llvm::TimeRecord StartTime = llvm::TimeRecord::getCurrentTime();
+
+public:
+  /// Time the type-checking of the given expression.
+  TypeCheckingTimer(TypeChecker &TC, const Expr *expr);
+
+  /// Time the type-checking of the body of the given function or closure.
+  TypeCheckingTimer(TypeChecker &TC, const AbstractFunctionDecl *AFD);
+  TypeCheckingTimer(TypeChecker &TC, const AbstractClosureExpr *closure);
+
+  ~TypeCheckingTimer();
+
+  TypeCheckingTimer(const TypeCheckingTimer &) = delete;
+  TypeCheckingTimer &operator=(const TypeCheckingTimer &) = delete;
+};
+
 /// \brief RAII object that cleans up the given expression if not explicitly
 /// disabled.
 class CleanupIllFormedExpressionRAII {
@@ -18,8 +18,17 @@
 #include "swift/AST/PrettyStackTrace.h"
 #include "swift/ClangImporter/ClangImporter.h"
 #include "swift/Serialization/BCReadingExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 
+#define DEBUG_TYPE "Serialization"
+
+STATISTIC(NumMembersLoadedByName,
+          "# of members deserialized by name lookup");
+STATISTIC(NumMembersNotLoaded,
+          "# of members of types searched by name that were never "
+          "deserialized");
+
 using namespace swift;
 using namespace swift::serialization;
 
@@ -3912,6 +3921,65 @@ void ModuleFile::loadAllMembers(Decl *D,
 
   for (auto member : members)
     IDC->addMember(member);
+
+  // Members that weren't loaded by name have been loaded now.
+  auto notLoaded = MembersNotLoadedByOffset.find(contextData);
+  if (notLoaded != MembersNotLoadedByOffset.end()) {
+    NumMembersNotLoaded -= notLoaded->second;
+    MembersNotLoadedByOffset.erase(notLoaded);
+  }
+}
+
+bool ModuleFile::loadNamedMembers(const IterableDeclContext *IDC,
+                                  Identifier baseName,
+                                  uint64_t contextData,
+                                  SmallVectorImpl<ValueDecl *> &members) {
+  // Modules written before the member name table existed have to load all
+  // of their members.
+  if (!DeclMemberNames)
+    return false;
+
+  // Keep track of how many members of this context are still on disk.
+  if (!MembersNotLoadedByOffset.count(contextData)) {
+    BCOffsetRAII restoreOffset(DeclTypeCursor);
+    DeclTypeCursor.JumpToBit(contextData);
+    auto entry = DeclTypeCursor.advance();
+    if (entry.Kind != llvm::BitstreamEntry::Record)
+      return false;
+
+    SmallVector<uint64_t, 16> memberIDBuffer;
+    unsigned kind = DeclTypeCursor.readRecord(entry.ID, memberIDBuffer);
+    assert(kind == decls_block::MEMBERS);
+    (void)kind;
+
+    ArrayRef<uint64_t> rawMemberIDs;
+    decls_block::MembersLayout::readRecord(memberIDBuffer, rawMemberIDs);
+
+    MembersNotLoadedByOffset[contextData] = rawMemberIDs.size();
+    NumMembersNotLoaded += rawMemberIDs.size();
+  }
+
+  auto known = DeclMemberNames->find({contextData, baseName.str()});
+  if (known == DeclMemberNames->end())
+    return true;
+
+  auto memberIDs = *known;
+  for (DeclID memberID : memberIDs) {
+    Decl *D = getDecl(memberID);
+    assert(D && "unable to deserialize member by name");
+    members.push_back(cast<ValueDecl>(D));
+  }
+  NumMembersLoadedByName += memberIDs.size();
+
+  // Deserializing the members may have loaded the whole context already.
+  auto notLoaded = MembersNotLoadedByOffset.find(contextData);
+  if (notLoaded != MembersNotLoadedByOffset.end()) {
+    unsigned count = std::min<unsigned>(notLoaded->second, memberIDs.size());
+    notLoaded->second -= count;
+    NumMembersNotLoaded -= count;
+  }
+
+  return true;
 }
 
 void
@@ -456,6 +456,7 @@ void Serializer::writeBlockInfoBlock() {
   BLOCK_RECORD(index_block, DECL_CONTEXT_OFFSETS);
   BLOCK_RECORD(index_block, LOCAL_TYPE_DECLS);
   BLOCK_RECORD(index_block, NORMAL_CONFORMANCE_OFFSETS);
+  BLOCK_RECORD(index_block, DECL_MEMBER_NAMES);
 
   BLOCK(SIL_BLOCK);
   BLOCK_RECORD(sil_block, SIL_FUNCTION);
@@ -1218,6 +1219,9 @@ static bool shouldSerializeMember(Decl *D) {
 void Serializer::writeMembers(DeclRange members, bool isClass) {
   using namespace decls_block;
 
+  // Deserialization identifies the member list by where it starts.
+  uint64_t membersOffset = Out.GetCurrentBitNo();
+
   unsigned abbrCode = DeclTypeAbbrCodes[MembersLayout::Code];
   SmallVector<DeclID, 16> memberIDs;
   for (auto member : members) {
@@ -1227,6 +1231,14 @@ void Serializer::writeMembers(DeclRange members, bool isClass) {
     DeclID memberID = addDeclRef(member);
     memberIDs.push_back(memberID);
 
+    if (auto VD = dyn_cast<ValueDecl>(member)) {
+      if (VD->hasName()) {
+        auto baseName = VD->getFullName().getBaseName();
+        DeclMemberNames[{membersOffset, baseName}]
+          .push_back(memberID);
+      }
+    }
+
     if (isClass) {
       if (auto VD = dyn_cast<ValueDecl>(member)) {
         if (VD->canBeAccessedByDynamicLookup()) {
@@ -3491,6 +3503,74 @@ namespace {
   };
 } // end anonymous namespace
 
+namespace {
+  /// Used to serialize the on-disk member name hash table.
+  class DeclMemberNamesTableInfo {
+  public:
+    using key_type = std::pair<uint64_t, Identifier>;
+    using key_type_ref = const key_type &;
+    using data_type = SmallVector<DeclID, 2>;
+    using data_type_ref = const data_type &;
+    using hash_value_type = uint32_t;
+    using offset_type = unsigned;
+
+    hash_value_type ComputeHash(key_type_ref key) {
+      assert(!key.second.empty());
+      // Fold in both halves of the bit offset; large modules can have
+      // member lists past the 4Gbit mark.
+      uint32_t seed = uint32_t(key.first) ^ uint32_t(key.first >> 32);
+      return llvm::HashString(key.second.str(), seed);
+    }
+
+    std::pair<unsigned, unsigned> EmitKeyDataLength(raw_ostream &out,
+                                                    key_type_ref key,
+                                                    data_type_ref data) {
+      uint32_t keyLength = sizeof(uint64_t) + key.second.str().size();
+      uint32_t dataLength = sizeof(uint32_t) * data.size();
+      endian::Writer<little> writer(out);
+      writer.write<uint16_t>(keyLength);
+      writer.write<uint16_t>(dataLength);
+      return { keyLength, dataLength };
+    }
+
+    void EmitKey(raw_ostream &out, key_type_ref key, unsigned len) {
+      endian::Writer<little>(out).write<uint64_t>(key.first);
+      out << key.second.str();
+    }
+
+    void EmitData(raw_ostream &out, key_type_ref key, data_type_ref data,
+                  unsigned len) {
+      static_assert(sizeof(DeclID) <= 4, "DeclID too large");
+      endian::Writer<little> writer(out);
+      for (auto memberID : data)
+        writer.write<uint32_t>(memberID);
+    }
+  };
+} // end anonymous namespace
+
+static void
+writeDeclMemberNamesTable(const index_block::DeclMemberNamesLayout &out,
+                          const Serializer::DeclMemberNamesTable &table) {
+  if (table.empty())
+    return;
+
+  llvm::OnDiskChainedHashTableGenerator<DeclMemberNamesTableInfo> generator;
+  llvm::SmallString<4096> hashTableBlob;
+  uint32_t tableOffset;
+  {
+    llvm::raw_svector_ostream blobStream(hashTableBlob);
+    for (auto &entry : table)
+      generator.insert(entry.first, entry.second);
+
+    // Make sure that no bucket is at offset 0
+    endian::Writer<little>(blobStream).write<uint32_t>(0);
+    tableOffset = generator.Emit(blobStream);
+  }
+
+  SmallVector<uint64_t, 8> scratch;
+  out.emit(scratch, tableOffset, hashTableBlob);
+}
+
 static void writeObjCMethodTable(const index_block::ObjCMethodTableLayout &out,
                                  Serializer::ObjCMethodTable &objcMethods) {
   // Collect all of the Objective-C selectors in the method table.
@@ -3679,6 +3759,9 @@ void Serializer::writeAST(ModuleOrSourceFile DC) {
     index_block::ObjCMethodTableLayout ObjCMethodTable(Out);
     writeObjCMethodTable(ObjCMethodTable, objcMethods);
 
+    index_block::DeclMemberNamesLayout DeclMemberNamesList(Out);
+    writeDeclMemberNamesTable(DeclMemberNamesList, DeclMemberNames);
+
     if (entryPointClassID.hasValue()) {
       index_block::EntryPointLayout EntryPoint(Out);
       EntryPoint.emit(ScratchRecord, entryPointClassID.getValue());
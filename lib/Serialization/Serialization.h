@@ -123,12 +123,22 @@ public:
   // hash table of all defined Objective-C methods.
   using ObjCMethodTable = llvm::DenseMap<ObjCSelector, ObjCMethodTableData>;
 
+  /// The in-memory representation of what will eventually be an on-disk
+  /// hash table from a member list's bit offset and a base name to the
+  /// members in that list with that name.
+  using DeclMemberNamesTable =
+    llvm::MapVector<std::pair<uint64_t, Identifier>, SmallVector<DeclID, 2>>;
+
 private:
   /// A map from identifiers to methods and properties with the given name.
   ///
   /// This is used for id-style lookup.
   DeclTable ClassMembersByName;
 
+  /// The named members of every type and extension, so that clients can
+  /// load members by name.
+  DeclMemberNamesTable DeclMemberNames;
+
   /// The queue of types and decls that need to be serialized.
   ///
   /// This is a queue and not simply a vector because serializing one
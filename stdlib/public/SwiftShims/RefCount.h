@@ -148,6 +148,36 @@ class StrongRefCount {
     return doDecrementShouldDeallocate<true>();
   }
 
+  // Decrement the reference count by n, optionally clearing the pinned
+  // flag, but never let the reference count drop below one.
+  // Return the part of n that could not be applied.
+  //
+  // This is used by biased reference counting, where the count of a biased
+  // object does not include the references held by its owning thread.
+  uint32_t decrementAboveOneN(uint32_t n, bool clearPinnedFlag) {
+    uint32_t oldval = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    while (true) {
+      uint32_t count = oldval >> RC_FLAGS_COUNT;
+      assert(count >= 1 && "biased object lost its bias reference");
+      uint32_t applied = count > n ? n : count - 1;
+      uint32_t newval = oldval - (applied << RC_FLAGS_COUNT);
+      if (clearPinnedFlag) {
+        assert((oldval & RC_PINNED_FLAG) &&
+               "unpinning reference that was not pinned");
+        newval &= ~RC_PINNED_FLAG;
+      }
+      if (__atomic_compare_exchange(&refCount, &oldval, &newval, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        return n - applied;
+      // Try again; oldval has been updated with the value we saw.
+    }
+  }
+
+  // Return whether the pinned flag is set.
+  bool isPinned() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_PINNED_FLAG;
+  }
+
   // Decrement the reference count.
   // Return true if the caller should now deallocate the object.
   bool decrementShouldDeallocate() {
@@ -274,10 +304,11 @@ class WeakRefCount {
   uint32_t refCount;
 
   enum : uint32_t {
-    // There isn't really a flag here.
-    // Making weak RC_ONE == strong RC_ONE saves an
+    // Set on objects whose strong references are biased toward the
+    // thread that allocated them. It never changes after initialization.
+    // Keeping this flag makes weak RC_ONE == strong RC_ONE, which saves an
     // instruction in allocation on arm64.
-    RC_UNUSED_FLAG = 1,
+    RC_BIASED_FLAG = 1,
 
     RC_FLAGS_COUNT = 1,
     RC_FLAGS_MASK = 1,
@@ -307,6 +338,17 @@ class WeakRefCount {
     refCount = RC_ONE;
   }
 
+  /// Initialize for an object whose strong references are biased toward
+  /// the allocating thread.
+  void initBiased() {
+    refCount = RC_ONE | RC_BIASED_FLAG;
+  }
+
+  // Return whether the object uses biased strong reference counting.
+  bool isBiased() const {
+    return __atomic_load_n(&refCount, __ATOMIC_RELAXED) & RC_BIASED_FLAG;
+  }
+
   /// Initialize for a stack promoted object. This prevents that the final
   /// release frees the memory of the object.
   void initForNotDeallocating() {
@@ -0,0 +1,467 @@
+//===--- BiasedRefCounting.cpp - Owner-thread biased refcounts ------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Biased reference counting.
+//
+// Most objects are only ever retained and released by the thread that
+// allocated them, yet every retain and release is an atomic operation on the
+// object header.  Once swift_enableBiasedRefCounting has been called, objects
+// are allocated with a hidden prefix in front of their header that records
+// the allocating ("owner") thread and a plain, non-atomic count of the
+// references held by that thread.  The owner retains and releases by
+// updating this count; other threads use atomic operations on the header.
+//
+// The strong count in the header holds one extra reference, the bias
+// reference, for as long as the object is biased.  Other threads never let
+// the header count drop below one while the object is biased.  A release
+// that would take it lower is recorded as pending in the prefix and the
+// object is queued on its owner, which applies the pending releases to its
+// own count the next time it allocates or releases a biased object, or when
+// it exits.  So, while biased,
+//
+//   strong references = header count - 1 + owner count - pending releases
+//
+// When the owner count drops to zero the owner merges the object: it marks
+// it as no longer biased and drops the bias reference and the pending
+// releases from the header, which may deallocate the object.  From then on
+// the object is reference counted as usual.
+//
+// If the object is still queued when it is merged, the queue entry drops the
+// bias reference instead, so that the entry never refers to freed memory.
+//
+// Threads record their queue in an owner record that is never freed, since
+// objects may outlive their owner.  When a thread exits it drains its queue
+// and marks its record dead; from then on whoever queues an object on a
+// dead owner applies the pending releases itself, under the record's lock.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/HeapObject.h"
+#include "swift/Runtime/InstrumentsSupport.h"
+
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Debug.h"
+#include "swift/Runtime/Metadata.h"
+#include "BiasedRefCounting.h"
+#include "Leaks.h"
+#include "Private.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#include <vector>
+#endif
+
+using namespace swift;
+
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+
+// Defined in HeapObject.cpp.
+extern "C" LLVM_LIBRARY_VISIBILITY
+void _swift_release_dealloc(HeapObject *object);
+
+namespace {
+
+/// The objects biased toward one thread that have releases pending.
+struct BiasedOwner {
+  /// Protects Queued and Dead.
+  std::mutex Lock;
+
+  /// Objects whose pending releases the owner has yet to apply.
+  std::vector<HeapObject *> Queued;
+
+  /// Whether Queued is non-empty, so that the owner can check it without
+  /// taking the lock.
+  std::atomic<bool> HasQueued{false};
+
+  /// Set once the owning thread has exited.
+  bool Dead = false;
+};
+
+/// The prefix placed in front of the header of a biased object.
+struct BiasedPrefix {
+  /// The owning thread.  Never changes.
+  BiasedOwner *Owner;
+
+  /// The number of strong references held by the owning thread.  Only
+  /// accessed by that thread, or under Owner->Lock once it is dead.
+  uint32_t OwnerCount;
+
+  /// The merged and queued flags and the number of pending releases.
+  std::atomic<uint32_t> State;
+
+  /// The number of bytes from the start of the allocation to the object.
+  uint32_t AllocationOffset;
+};
+
+enum : uint32_t {
+  /// The object is no longer biased.
+  MergedFlag = 1,
+  /// The object is in its owner's queue.
+  QueuedFlag = 2,
+  PendingShift = 2,
+};
+
+/// Creates the thread key and remembers the entry points that were in use
+/// before the biased ones were first installed.  Runs once.
+struct BiasedRefCountingSetup {
+  HeapObject *(*DefaultAllocObject)(HeapMetadata const *, size_t, size_t);
+  void (*DefaultRetain)(HeapObject *);
+  void (*DefaultRetainN)(HeapObject *, uint32_t);
+  void (*DefaultRelease)(HeapObject *);
+  void (*DefaultReleaseN)(HeapObject *, uint32_t);
+
+  BiasedRefCountingSetup();
+};
+
+} // end anonymous namespace
+
+/// Maps each thread to its owner record, if it has allocated a biased
+/// object.  Created before the biased entry points are installed.
+static pthread_key_t OwnerKey;
+
+static BiasedPrefix *getPrefix(const HeapObject *object) {
+  auto mutableObject = const_cast<HeapObject *>(object);
+  return reinterpret_cast<BiasedPrefix *>(mutableObject) - 1;
+}
+
+static BiasedOwner *getCurrentOwner() {
+  return static_cast<BiasedOwner *>(pthread_getspecific(OwnerKey));
+}
+
+static BiasedOwner *getOrCreateCurrentOwner() {
+  if (auto owner = getCurrentOwner())
+    return owner;
+  auto owner = new BiasedOwner();
+  if (pthread_setspecific(OwnerKey, owner) != 0)
+    swift::crash("could not register thread for biased reference counting");
+  return owner;
+}
+
+/// Stop biasing an object toward its owner and drop the bias reference,
+/// the pending releases and \p extraReleases from the header.  The caller
+/// must act as the owner, and the owner count must be zero.
+///
+/// Returns true if the object should be deallocated.
+static bool mergeShouldDeallocate(HeapObject *object, BiasedPrefix *prefix,
+                                  uint32_t extraReleases) {
+  assert(prefix->OwnerCount == 0);
+  uint32_t oldState = prefix->State.load(std::memory_order_relaxed);
+  uint32_t newState;
+  do {
+    // A queued object keeps its pending releases and the bias reference
+    // until the queue entry is processed.
+    newState = (oldState & QueuedFlag) ? (oldState | MergedFlag) : MergedFlag;
+  } while (!prefix->State.compare_exchange_weak(oldState, newState,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_relaxed));
+
+  if (oldState & QueuedFlag) {
+    // The bias reference keeps the object alive.
+    if (extraReleases &&
+        object->refCount.decrementShouldDeallocateN(extraReleases))
+      swift::crash("biased object released while still queued");
+    return false;
+  }
+
+  uint32_t pending = oldState >> PendingShift;
+  return object->refCount.decrementShouldDeallocateN(pending + extraReleases
+                                                     + 1);
+}
+
+/// Release \p n references on behalf of the owner of a biased object.
+///
+/// Returns true if the object should be deallocated.
+static bool ownerReleaseShouldDeallocate(HeapObject *object,
+                                         BiasedPrefix *prefix, uint32_t n) {
+  if (n < prefix->OwnerCount) {
+    prefix->OwnerCount -= n;
+    return false;
+  }
+  // Releases beyond the owner count are of references that other threads
+  // handed to the owner; they are counted in the header.
+  uint32_t extraReleases = n - prefix->OwnerCount;
+  prefix->OwnerCount = 0;
+  return mergeShouldDeallocate(object, prefix, extraReleases);
+}
+
+/// Apply the pending releases of a queued object.  The caller must act as
+/// the owner.
+///
+/// Returns true if the object should be deallocated.
+static bool dequeueShouldDeallocate(HeapObject *object) {
+  auto prefix = getPrefix(object);
+  uint32_t oldState = prefix->State.load(std::memory_order_relaxed);
+  while (!prefix->State.compare_exchange_weak(oldState,
+                                              oldState & MergedFlag,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+    // Try again; oldState has been updated with the value we saw.
+  }
+
+  uint32_t pending = oldState >> PendingShift;
+  // If the owner merged the object while it was queued, finish the merge.
+  if (oldState & MergedFlag)
+    return object->refCount.decrementShouldDeallocateN(pending + 1);
+  return ownerReleaseShouldDeallocate(object, prefix, pending);
+}
+
+/// Apply the pending releases of every object queued on the current
+/// thread's owner record.
+static void drainQueue(BiasedOwner *owner) {
+  std::vector<HeapObject *> queued;
+  {
+    std::lock_guard<std::mutex> guard(owner->Lock);
+    queued.swap(owner->Queued);
+    owner->HasQueued.store(false, std::memory_order_relaxed);
+  }
+  for (auto object : queued) {
+    if (dequeueShouldDeallocate(object))
+      _swift_release_dealloc(object);
+  }
+}
+
+/// Hand a biased object with pending releases to its owner.
+static void enqueue(HeapObject *object, BiasedOwner *owner) {
+  bool shouldDeallocate;
+  {
+    std::lock_guard<std::mutex> guard(owner->Lock);
+    if (!owner->Dead) {
+      owner->Queued.push_back(object);
+      owner->HasQueued.store(true, std::memory_order_release);
+      return;
+    }
+    // Nobody else will process the object, so act as its owner.
+    shouldDeallocate = dequeueShouldDeallocate(object);
+  }
+  if (shouldDeallocate)
+    _swift_release_dealloc(object);
+}
+
+/// Release \p n references to a biased object from a thread other than its
+/// owner, clearing the pinned flag if \p unpin is set.
+static void sharedReleaseN(HeapObject *object, BiasedPrefix *prefix,
+                           uint32_t n, bool unpin) {
+  uint32_t remaining = object->refCount.decrementAboveOneN(n, unpin);
+  if (!remaining)
+    return;
+
+  uint32_t oldState = prefix->State.load(std::memory_order_relaxed);
+  uint32_t newState;
+  do {
+    if (oldState & MergedFlag) {
+      // The object was merged after we looked at it, so the rest of the
+      // releases can go to the header.
+      if (object->refCount.decrementShouldDeallocateN(remaining))
+        _swift_release_dealloc(object);
+      return;
+    }
+    newState = (oldState + (remaining << PendingShift)) | QueuedFlag;
+  } while (!prefix->State.compare_exchange_weak(oldState, newState,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+
+  if (!(oldState & QueuedFlag))
+    enqueue(object, prefix->Owner);
+}
+
+/// Runs when a thread that owns biased objects exits.
+static void retireOwner(void *value) {
+  auto owner = static_cast<BiasedOwner *>(value);
+  while (true) {
+    {
+      std::lock_guard<std::mutex> guard(owner->Lock);
+      if (owner->Queued.empty()) {
+        owner->Dead = true;
+        return;
+      }
+    }
+    drainQueue(owner);
+  }
+}
+
+static HeapObject *
+_swift_allocObject_biased(HeapMetadata const *metadata, size_t requiredSize,
+                          size_t requiredAlignmentMask) {
+  assert(isAlignmentMask(requiredAlignmentMask));
+  BiasedOwner *owner = getOrCreateCurrentOwner();
+  if (owner->HasQueued.load(std::memory_order_relaxed))
+    drainQueue(owner);
+
+  size_t alignMask = std::max(requiredAlignmentMask,
+                              alignof(BiasedPrefix) - 1);
+  size_t offset = (sizeof(BiasedPrefix) + alignMask) & ~alignMask;
+  auto allocation = static_cast<char *>(
+                      swift_slowAlloc(requiredSize + offset, alignMask));
+  auto object = reinterpret_cast<HeapObject *>(allocation + offset);
+
+  auto prefix = getPrefix(object);
+  prefix->Owner = owner;
+  prefix->OwnerCount = 1;
+  new (&prefix->State) std::atomic<uint32_t>(0);
+  prefix->AllocationOffset = offset;
+
+  object->metadata = metadata;
+  // The header starts out holding just the bias reference.
+  object->refCount.init();
+  object->weakRefCount.initBiased();
+
+  // If leak tracking is enabled, start tracking this object.
+  SWIFT_LEAKS_START_TRACKING_OBJECT(object);
+
+  return object;
+}
+
+static void _swift_retain_n_biased(HeapObject *object, uint32_t n) {
+  if (!object)
+    return;
+  if (object->weakRefCount.isBiased()) {
+    auto prefix = getPrefix(object);
+    if (prefix->Owner == getCurrentOwner() &&
+        !(prefix->State.load(std::memory_order_relaxed) & MergedFlag)) {
+      prefix->OwnerCount += n;
+      return;
+    }
+  }
+  object->refCount.increment(n);
+}
+
+static void _swift_retain_biased(HeapObject *object) {
+  _swift_retain_n_biased(object, 1);
+}
+
+static void _swift_release_n_biased(HeapObject *object, uint32_t n) {
+  if (!object)
+    return;
+  if (object->weakRefCount.isBiased()) {
+    auto prefix = getPrefix(object);
+    // The merged flag never clears, so if we see it the object is merged.
+    if (!(prefix->State.load(std::memory_order_relaxed) & MergedFlag)) {
+      BiasedOwner *owner = prefix->Owner;
+      if (owner == getCurrentOwner()) {
+        if (ownerReleaseShouldDeallocate(object, prefix, n))
+          _swift_release_dealloc(object);
+        // Apply the releases other threads handed us, so that deinits do
+        // not wait for our next allocation.
+        if (owner->HasQueued.load(std::memory_order_relaxed))
+          drainQueue(owner);
+      } else {
+        sharedReleaseN(object, prefix, n, /*unpin*/ false);
+      }
+      return;
+    }
+  }
+  if (object->refCount.decrementShouldDeallocateN(n))
+    _swift_release_dealloc(object);
+}
+
+static void _swift_release_biased(HeapObject *object) {
+  _swift_release_n_biased(object, 1);
+}
+
+BiasedRefCountingSetup::BiasedRefCountingSetup()
+  : DefaultAllocObject(_swift_allocObject), DefaultRetain(_swift_retain),
+    DefaultRetainN(_swift_retain_n), DefaultRelease(_swift_release),
+    DefaultReleaseN(_swift_release_n) {
+  if (pthread_key_create(&OwnerKey, retireOwner) != 0)
+    swift::crash("could not create biased reference counting thread key");
+}
+
+static Lazy<BiasedRefCountingSetup> Setup;
+
+/// Replace an entry point.  Other threads may be calling through it at the
+/// same time, so the store must be atomic.
+template <typename Fn>
+static void installEntryPoint(Fn *entryPoint, Fn replacement) {
+  __atomic_store_n(entryPoint, replacement, __ATOMIC_RELEASE);
+}
+
+size_t swift::_swift_biasedAllocSize(const HeapObject *object) {
+  size_t offset = getPrefix(object)->AllocationOffset;
+  return swift_slowAllocSize(reinterpret_cast<const char *>(object) - offset)
+           - offset;
+}
+
+void swift::_swift_biasedSlowDealloc(HeapObject *object, size_t allocatedSize,
+                                     size_t allocatedAlignMask) {
+  size_t offset = getPrefix(object)->AllocationOffset;
+  swift_slowDealloc(reinterpret_cast<char *>(object) - offset,
+                    allocatedSize + offset,
+                    std::max(allocatedAlignMask, alignof(BiasedPrefix) - 1));
+}
+
+size_t swift::_swift_biasedRetainCount(const HeapObject *object) {
+  auto prefix = getPrefix(object);
+  uint32_t state = prefix->State.load(std::memory_order_acquire);
+  size_t count = object->refCount.getCount();
+  bool biased = !(state & MergedFlag);
+  if (biased && prefix->Owner != getCurrentOwner())
+    return count;
+
+  if (biased)
+    count += prefix->OwnerCount;
+  // The header still holds the bias reference until the object is merged
+  // and dequeued.
+  if (biased || (state & QueuedFlag))
+    count -= 1;
+  return count - (state >> PendingShift);
+}
+
+bool swift::_swift_biasedIsUniquelyReferenced(const HeapObject *object,
+                                              bool orPinned) {
+  if (orPinned && object->refCount.isPinned())
+    return true;
+  auto prefix = getPrefix(object);
+  if (!(prefix->State.load(std::memory_order_relaxed) & MergedFlag) &&
+      prefix->Owner != getCurrentOwner())
+    return false;
+  return _swift_biasedRetainCount(object) == 1;
+}
+
+void swift::_swift_biasedUnpin(HeapObject *object) {
+  auto prefix = getPrefix(object);
+  if (prefix->State.load(std::memory_order_relaxed) & MergedFlag) {
+    if (object->refCount.decrementAndUnpinShouldDeallocate())
+      _swift_release_dealloc(object);
+    return;
+  }
+  // The pin is counted in the header, even when the owner pinned the object.
+  sharedReleaseN(object, prefix, 1, /*unpin*/ true);
+}
+
+#endif
+
+bool swift::swift_enableBiasedRefCounting() {
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  Setup.get();
+  installEntryPoint(&_swift_allocObject, _swift_allocObject_biased);
+  installEntryPoint(&_swift_retain, _swift_retain_biased);
+  installEntryPoint(&_swift_retain_n, _swift_retain_n_biased);
+  installEntryPoint(&_swift_release, _swift_release_biased);
+  installEntryPoint(&_swift_release_n, _swift_release_n_biased);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void swift::swift_disableBiasedRefCounting() {
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  auto &setup = Setup.get();
+  installEntryPoint(&_swift_allocObject, setup.DefaultAllocObject);
+  installEntryPoint(&_swift_retain, setup.DefaultRetain);
+  installEntryPoint(&_swift_retain_n, setup.DefaultRetainN);
+  installEntryPoint(&_swift_release, setup.DefaultRelease);
+  installEntryPoint(&_swift_release_n, setup.DefaultReleaseN);
+#endif
+}
@@ -0,0 +1,56 @@
+//===--- BiasedRefCounting.h - Owner-thread biased refcounts ----*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Entry points used by the rest of the runtime to handle objects whose strong
+// reference counts are biased toward the thread that allocated them.  Such
+// objects have the biased flag set in their weak reference count and carry a
+// hidden prefix in front of their header.  See BiasedRefCounting.cpp.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_RUNTIME_BIASEDREFCOUNTING_H
+#define SWIFT_RUNTIME_BIASEDREFCOUNTING_H
+
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+
+#include <cstddef>
+
+namespace swift {
+struct HeapObject;
+
+/// Free the memory of a biased object, including its prefix.
+void _swift_biasedSlowDealloc(HeapObject *object, size_t allocatedSize,
+                              size_t allocatedAlignMask);
+
+/// Return the number of usable bytes in the allocation of a biased object,
+/// counted from the start of the object.
+size_t _swift_biasedAllocSize(const HeapObject *object);
+
+/// Return the strong retain count of a biased object.  Threads other than
+/// the owner can not see the owner's references and get the shared count.
+size_t _swift_biasedRetainCount(const HeapObject *object);
+
+/// Return true if a biased object is known to be uniquely referenced (or,
+/// if orPinned is set, to be pinned).  Threads other than the owner can
+/// not see the owner's references and conservatively get false unless the
+/// object is pinned.
+bool _swift_biasedIsUniquelyReferenced(const HeapObject *object,
+                                       bool orPinned);
+
+/// Unpin a biased object, deallocating it if that was its last reference.
+void _swift_biasedUnpin(HeapObject *object);
+
+} // end namespace swift
+
+#endif
+
+#endif
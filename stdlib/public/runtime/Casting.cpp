@@ -29,6 +29,7 @@
 #include "ErrorObject.h"
 #include "ExistentialMetadataImpl.h"
 #include "Private.h"
+#include "Statistics.h"
 #include "../SwiftShims/RuntimeShims.h"
 #include "stddef.h"
 
@@ -2328,16 +2329,33 @@ namespace {
       return Data;
     }
   };
+
+  /// A conformance record in the per-protocol index, tagged with the index
+  /// of the section that contains it.
+  struct IndexedConformanceRecord {
+    const ProtocolConformanceRecord *Record;
+    unsigned SectionIndex;
+  };
 }
 
 // Conformance Cache.
 
 struct ConformanceState {
   ConcurrentMap<size_t, ConformanceCacheEntry> Cache;
+
+  /// The conformance records of every registered section, keyed by the
+  /// address of the protocol descriptor they conform to.
+  ConcurrentMap<size_t, IndexedConformanceRecord> RecordsByProtocol;
+
+  /// The number of sections whose records have been completely added to
+  /// RecordsByProtocol. Failed lookups are cached under this generation.
+  std::atomic<unsigned> NumIndexedSections;
+
   std::vector<ConformanceSection> SectionsToScan;
+  /// Serializes the registration of new sections. Lookups never take it.
   pthread_mutex_t SectionsToScanLock;
   
-  ConformanceState() {
+  ConformanceState() : NumIndexedSections(0) {
     SectionsToScan.reserve(16);
     pthread_mutex_init(&SectionsToScanLock, nullptr);
   }
@@ -2345,10 +2363,6 @@ struct ConformanceState {
 
 static Lazy<ConformanceState> Conformances;
 
-// This variable is used to signal when a cache was generated and
-// it is correct to avoid a new scan.
-static unsigned ConformanceCacheGeneration = 0;
-
 void
 swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin,
                                           const ProtocolConformanceRecord *end){
@@ -2356,8 +2370,19 @@ swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin
 
   pthread_mutex_lock(&C.SectionsToScanLock);
 
+  unsigned sectionIdx = C.SectionsToScan.size();
   C.SectionsToScan.push_back(ConformanceSection{begin, end});
 
+  // Index the section by protocol once, so that lookups only visit the
+  // records for the protocol they are interested in.
+  for (auto record = begin; record != end; ++record) {
+    C.RecordsByProtocol.findOrAllocateNode((size_t)record->getProtocol())
+      .push_front(IndexedConformanceRecord{record, sectionIdx});
+  }
+
+  // Publish the section to lookups.
+  C.NumIndexedSections.store(sectionIdx + 1, std::memory_order_release);
+
   pthread_mutex_unlock(&C.SectionsToScanLock);
 }
 
@@ -2453,6 +2478,28 @@ static size_t hashTypeProtocolPair(const void *type,
   return (size_t)type + ((size_t)protocol >> 2);
 }
 
+/// Add \p NewEntry for the pair \p type and \p proto to the conformance
+/// cache, unless an entry that answers the lookup at least as well is already
+/// there. Concurrent lookups that scan the same records would otherwise keep
+/// growing the bucket with copies of the same entry.
+static void cacheConformance(ConformanceState &C, const void *type,
+                             const ProtocolDescriptor *proto,
+                             ConformanceCacheEntry NewEntry) {
+  // Hash and lookup the type-protocol pair in the cache.
+  size_t hash = hashTypeProtocolPair(type, proto);
+  ConcurrentList<ConformanceCacheEntry> &Bucket =
+    C.Cache.findOrAllocateNode(hash);
+
+  Bucket.push_front_unique(NewEntry, [&](ConformanceCacheEntry &Entry) {
+    if (!Entry.matches(type, proto) ||
+        Entry.isSuccessful() != NewEntry.isSuccessful())
+      return false;
+    if (Entry.isSuccessful())
+      return Entry.getWitnessTable() == NewEntry.getWitnessTable();
+    return Entry.getFailureGeneration() >= NewEntry.getFailureGeneration();
+  });
+}
+
 /// Search the witness table in the ConformanceCache. \returns a pair of the
 /// WitnessTable pointer and a boolean value True if a definitive value is
 /// found. \returns false if the type or its superclasses were not found in
@@ -2488,7 +2535,8 @@ recur_inside_cache_lock:
       foundEntry = &Entry;
 
     // If we got a cached negative response, check the generation number.
-    if (Entry.getFailureGeneration() == C.SectionsToScan.size()) {
+    if (Entry.getFailureGeneration() ==
+          C.NumIndexedSections.load(std::memory_order_acquire)) {
       // We found an entry with a negative value.
       return std::make_pair(nullptr, true);
     }
@@ -2566,6 +2614,7 @@ const WitnessTable *
 swift::swift_conformsToProtocol(const Metadata *type,
                                 const ProtocolDescriptor *protocol) {
   auto &C = Conformances.get();
+  countRuntimeEvent(RuntimeStatistic::ConformanceLookup);
   
   // Install callbacks for tracking when a new dylib is loaded so we can
   // scan it.
@@ -2579,8 +2628,6 @@ swift::swift_conformsToProtocol(const Metadata *type,
 recur:
   // See if we have a cached conformance. The ConcurrentMap data structure
   // allows us to insert and search the map concurrently without locking.
-  // We do lock the slow path because the SectionsToScan data structure is not
-  // concurrent.
   auto FoundConformance = searchInConformanceCache(type, protocol, foundEntry);
   // The negative answer does not always mean that there is no conformance,
   // unless it is an exact match on the type. If it is not an exact match,
@@ -2591,100 +2638,78 @@ recur:
       return FoundConformance.first;
   }
 
-  unsigned failedGeneration = ConformanceCacheGeneration;
-
-  // If we didn't have an up-to-date cache entry, scan the conformance records.
-  pthread_mutex_lock(&C.SectionsToScanLock);
-
-  // If we have no new information to pull in (and nobody else pulled in
-  // new information while we waited on the lock), we're done.
-  if (C.SectionsToScan.size() == numSections) {
-    if (failedGeneration != ConformanceCacheGeneration) {
-      // Someone else pulled in new conformances while we were waiting.
-      // Start over with our newly-populated cache.
-      pthread_mutex_unlock(&C.SectionsToScanLock);
-      type = origType;
-      goto recur;
-    }
-
+  // Sections registered after this point are picked up by a later lookup.
+  unsigned endSectionIdx = C.NumIndexedSections.load(std::memory_order_acquire);
 
-    // Hash and lookup the type-protocol pair in the cache.
-    size_t hash = hashTypeProtocolPair(type, protocol);
-    ConcurrentList<ConformanceCacheEntry> &Bucket =
-      C.Cache.findOrAllocateNode(hash);
-    Bucket.push_front(ConformanceCacheEntry::createFailure(
-        type, protocol, C.SectionsToScan.size()));
-    pthread_mutex_unlock(&C.SectionsToScanLock);
+  // If we have no new information to pull in since our last scan, we're done.
+  if (endSectionIdx == numSections) {
+    cacheConformance(C, type, protocol,
+                     ConformanceCacheEntry::createFailure(type, protocol,
+                                                          endSectionIdx));
     return nullptr;
   }
 
+  // Count the lookup as a miss the first time it has to scan records.
+  if (numSections == 0)
+    countRuntimeEvent(RuntimeStatistic::ConformanceCacheMiss);
+
   // Update the last known number of sections to scan.
-  numSections = C.SectionsToScan.size();
+  numSections = endSectionIdx;
 
   // Scan only sections that were not scanned yet.
-  unsigned sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
+  unsigned startSectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
 
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    // Eagerly pull records for nondependent witnesses into our cache.
-    for (const auto &record : section) {
-      // If the record applies to a specific type, cache it.
-      if (auto metadata = record.getCanonicalTypeMetadata()) {
-        auto P = record.getProtocol();
+  // Only the records for this protocol need to be considered. The index lists
+  // them newest first; visit them in registration order, as a scan of the
+  // sections would, so that the last registered conformance ends up at the
+  // front of the cache and wins.
+  std::vector<const ProtocolConformanceRecord *> Records;
+  if (auto *Indexed = C.RecordsByProtocol.find((size_t)protocol)) {
+    for (const auto &indexed : Indexed->Payload) {
+      if (indexed.SectionIndex >= startSectionIdx &&
+          indexed.SectionIndex < endSectionIdx)
+        Records.push_back(indexed.Record);
+    }
+  }
 
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
+  for (auto I = Records.rbegin(), E = Records.rend(); I != E; ++I) {
+    const auto &record = **I;
+    auto P = record.getProtocol();
+    assert(P == protocol && "record indexed under the wrong protocol");
 
-        if (!isRelatedType(type, metadata))
-          continue;
+    // Eagerly pull records for nondependent witnesses into our cache.
+    // If the record applies to a specific type, cache it.
+    if (auto metadata = record.getCanonicalTypeMetadata()) {
+      if (!isRelatedType(type, metadata))
+        continue;
+
+      auto witness = record.getWitnessTable(metadata);
+      if (witness)
+        cacheConformance(C, metadata, P,
+            ConformanceCacheEntry::createSuccess(metadata, P, witness));
+      else
+        cacheConformance(C, metadata, P,
+            ConformanceCacheEntry::createFailure(metadata, P, endSectionIdx));
 
-        // Hash and lookup the type-protocol pair in the cache.
-        size_t hash = hashTypeProtocolPair(metadata, P);
-        ConcurrentList<ConformanceCacheEntry> &Bucket =
-          C.Cache.findOrAllocateNode(hash);
-
-        auto witness = record.getWitnessTable(metadata);
-        if (witness)
-          Bucket.push_front(
-              ConformanceCacheEntry::createSuccess(metadata, P, witness));
-        else
-          Bucket.push_front(ConformanceCacheEntry::createFailure(
-              metadata, P, C.SectionsToScan.size()));
-
-      // If the record provides a nondependent witness table for all instances
-      // of a generic type, cache it for the generic pattern.
-      // TODO: "Nondependent witness table" probably deserves its own flag.
-      // An accessor function might still be necessary even if the witness table
-      // can be shared.
-      } else if (record.getTypeKind()
-                   == ProtocolConformanceTypeKind::UniqueGenericPattern
-                 && record.getConformanceKind()
-                   == ProtocolConformanceReferenceKind::WitnessTable) {
-
-        auto R = record.getGenericPattern();
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
+    // If the record provides a nondependent witness table for all instances
+    // of a generic type, cache it for the generic pattern.
+    // TODO: "Nondependent witness table" probably deserves its own flag.
+    // An accessor function might still be necessary even if the witness table
+    // can be shared.
+    } else if (record.getTypeKind()
+                 == ProtocolConformanceTypeKind::UniqueGenericPattern
+               && record.getConformanceKind()
+                 == ProtocolConformanceReferenceKind::WitnessTable) {
 
-        if (!isRelatedType(type, R))
-          continue;
+      auto R = record.getGenericPattern();
+      if (!isRelatedType(type, R))
+        continue;
 
-        // Hash and lookup the type-protocol pair in the cache.
-        size_t hash = hashTypeProtocolPair(R, P);
-        ConcurrentList<ConformanceCacheEntry> &Bucket =
-          C.Cache.findOrAllocateNode(hash);
-          Bucket.push_front(ConformanceCacheEntry::createSuccess(
-              R, P, record.getStaticWitnessTable()));
-      }
+      cacheConformance(C, R, P, ConformanceCacheEntry::createSuccess(
+          R, P, record.getStaticWitnessTable()));
     }
   }
-  ++ConformanceCacheGeneration;
 
-  pthread_mutex_unlock(&C.SectionsToScanLock);
   // Start over with our newly-populated cache.
   type = origType;
   goto recur;
@@ -20,15 +20,298 @@
 #include "swift/Runtime/Debug.h"
 #include <stdlib.h>
 
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GNU_LIBRARY__)
+#include <malloc.h>
+#endif
+
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+#include "swift/Basic/Lazy.h"
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
 using namespace swift;
 
+/// The alignment mask that malloc guarantees for every allocation.
+#if defined(__APPLE__)
+static const size_t MallocAlignMask = 15;
+#else
+static const size_t MallocAlignMask = 2 * sizeof(void*) - 1;
+#endif
+
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+
+namespace {
+
+/// The size classes are the multiples of the granule up to MaxSmallSize.
+/// Every block is aligned to the granule.
+const size_t SizeClassGranule = 16;
+const size_t NumSizeClasses = 32;
+const size_t MaxSmallSize = SizeClassGranule * NumSizeClasses;
+
+/// Each span of the arena is carved into blocks of a single size class.
+const size_t SpanSize = 64 * 1024;
+
+/// The arena is a single address range reserved up front, so that ownership
+/// of a pointer can be decided with a range check. Memory is only committed
+/// as spans are touched. Once it is exhausted we fall back to malloc.
+#if __LP64__
+const size_t ArenaSize = size_t(16) << 30;
+#else
+const size_t ArenaSize = size_t(256) << 20;
+#endif
+
+/// A thread cache holds at most this many free blocks per size class
+/// before returning half of them to the central free list.
+const unsigned MaxCachedBlocks = 128;
+
+/// The number of blocks moved from the central free list to a thread
+/// cache at once.
+const unsigned RefillBatchSize = 32;
+
+struct FreeBlock {
+  FreeBlock *Next;
+};
+
+/// The free blocks of one size class that are not owned by any thread.
+struct CentralFreeList {
+  std::mutex Lock;
+  FreeBlock *Head = nullptr;
+  /// The unused tail of the span most recently assigned to this class.
+  char *SpanNext = nullptr;
+  char *SpanEnd = nullptr;
+};
+
+/// The free blocks of each size class owned by a single thread.
+struct ThreadCache {
+  FreeBlock *Heads[NumSizeClasses];
+  unsigned Counts[NumSizeClasses];
+};
+
+class SizeClassHeap {
+  char *ArenaBegin = nullptr;
+  char *ArenaEnd = nullptr;
+
+  /// The size class of every span, indexed by span number.
+  uint8_t *SpanSizeClasses = nullptr;
+
+  /// The first span not yet assigned to a size class.
+  std::atomic<char *> NextSpan;
+
+  CentralFreeList Central[NumSizeClasses];
+
+  pthread_key_t CacheKey;
+
+  static void destroyThreadCache(void *cache);
+
+  ThreadCache *getThreadCache() {
+    auto cache = static_cast<ThreadCache *>(pthread_getspecific(CacheKey));
+    if (LLVM_LIKELY(cache != nullptr))
+      return cache;
+    cache = static_cast<ThreadCache *>(calloc(1, sizeof(ThreadCache)));
+    if (!cache)
+      crash("Could not allocate memory.");
+    pthread_setspecific(CacheKey, cache);
+    return cache;
+  }
+
+  size_t getSpanIndex(const void *ptr) const {
+    return size_t((const char *)ptr - ArenaBegin) / SpanSize;
+  }
+
+  char *allocateSpan(unsigned sizeClass);
+  void refill(ThreadCache *cache, unsigned sizeClass);
+  void flush(ThreadCache *cache, unsigned sizeClass, unsigned count);
+
+public:
+  SizeClassHeap();
+
+  static unsigned getSizeClass(size_t size) {
+    return size ? unsigned((size - 1) / SizeClassGranule) : 0;
+  }
+
+  static size_t getSizeOfClass(unsigned sizeClass) {
+    return (sizeClass + 1) * SizeClassGranule;
+  }
+
+  bool owns(const void *ptr) const {
+    return ptr >= ArenaBegin && ptr < ArenaEnd;
+  }
+
+  unsigned getSizeClassOf(const void *ptr) const {
+    return SpanSizeClasses[getSpanIndex(ptr)];
+  }
+
+  /// Allocate a block of the given size class, or return null if the arena
+  /// is exhausted.
+  void *alloc(unsigned sizeClass) {
+    ThreadCache *cache = getThreadCache();
+    if (LLVM_UNLIKELY(!cache->Heads[sizeClass])) {
+      refill(cache, sizeClass);
+      if (!cache->Heads[sizeClass])
+        return nullptr;
+    }
+    FreeBlock *block = cache->Heads[sizeClass];
+    cache->Heads[sizeClass] = block->Next;
+    --cache->Counts[sizeClass];
+    return block;
+  }
+
+  void dealloc(void *ptr) {
+    unsigned sizeClass = getSizeClassOf(ptr);
+    ThreadCache *cache = getThreadCache();
+    auto block = static_cast<FreeBlock *>(ptr);
+    block->Next = cache->Heads[sizeClass];
+    cache->Heads[sizeClass] = block;
+    if (LLVM_UNLIKELY(++cache->Counts[sizeClass] > MaxCachedBlocks))
+      flush(cache, sizeClass, MaxCachedBlocks / 2);
+  }
+};
+
+} // end anonymous namespace
+
+static Lazy<SizeClassHeap> SmallObjectHeap;
+
+SizeClassHeap::SizeClassHeap() : NextSpan(nullptr) {
+  if (pthread_key_create(&CacheKey, destroyThreadCache) != 0)
+    crash("Could not create the heap's thread cache key.");
+
+  int flags = MAP_ANON | MAP_PRIVATE;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  void *arena = mmap(nullptr, ArenaSize, PROT_READ | PROT_WRITE, flags,
+                     -1, 0);
+  // Without an arena every allocation simply goes to malloc.
+  if (arena == MAP_FAILED)
+    return;
+
+  ArenaBegin = static_cast<char *>(arena);
+  ArenaEnd = ArenaBegin + ArenaSize;
+
+  // The span size class table lives at the start of the arena. Spans begin
+  // at the first span-aligned address after it.
+  SpanSizeClasses = reinterpret_cast<uint8_t *>(ArenaBegin);
+  uintptr_t firstSpan = uintptr_t(ArenaBegin) + ArenaSize / SpanSize;
+  firstSpan = (firstSpan + SpanSize - 1) & ~uintptr_t(SpanSize - 1);
+  NextSpan.store(reinterpret_cast<char *>(firstSpan),
+                 std::memory_order_relaxed);
+}
+
+void SizeClassHeap::destroyThreadCache(void *cache) {
+  auto threadCache = static_cast<ThreadCache *>(cache);
+  auto &heap = SmallObjectHeap.unsafeGetAlreadyInitialized();
+  for (unsigned sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass)
+    heap.flush(threadCache, sizeClass, threadCache->Counts[sizeClass]);
+  free(threadCache);
+}
+
+char *SizeClassHeap::allocateSpan(unsigned sizeClass) {
+  char *span = NextSpan.load(std::memory_order_relaxed);
+  do {
+    if (!span || size_t(ArenaEnd - span) < SpanSize)
+      return nullptr;
+  } while (!NextSpan.compare_exchange_weak(span, span + SpanSize,
+                                           std::memory_order_relaxed));
+  SpanSizeClasses[getSpanIndex(span)] = sizeClass;
+  return span;
+}
+
+void SizeClassHeap::refill(ThreadCache *cache, unsigned sizeClass) {
+  auto &central = Central[sizeClass];
+  size_t blockSize = getSizeOfClass(sizeClass);
+  std::lock_guard<std::mutex> guard(central.Lock);
+
+  for (unsigned i = 0; i < RefillBatchSize; ++i) {
+    FreeBlock *block = central.Head;
+    if (block) {
+      central.Head = block->Next;
+    } else {
+      if (size_t(central.SpanEnd - central.SpanNext) < blockSize) {
+        char *span = allocateSpan(sizeClass);
+        if (!span)
+          return;
+        central.SpanNext = span;
+        central.SpanEnd = span + SpanSize;
+      }
+      block = reinterpret_cast<FreeBlock *>(central.SpanNext);
+      central.SpanNext += blockSize;
+    }
+    block->Next = cache->Heads[sizeClass];
+    cache->Heads[sizeClass] = block;
+    ++cache->Counts[sizeClass];
+  }
+}
+
+void SizeClassHeap::flush(ThreadCache *cache, unsigned sizeClass,
+                          unsigned count) {
+  if (!count)
+    return;
+
+  // Detach the first count blocks from the thread cache.
+  FreeBlock *first = cache->Heads[sizeClass];
+  FreeBlock *last = first;
+  for (unsigned i = 1; i < count; ++i)
+    last = last->Next;
+  cache->Heads[sizeClass] = last->Next;
+  cache->Counts[sizeClass] -= count;
+
+  auto &central = Central[sizeClass];
+  std::lock_guard<std::mutex> guard(central.Lock);
+  last->Next = central.Head;
+  central.Head = first;
+}
+
+#endif // SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+
 void *swift::swift_slowAlloc(size_t size, size_t alignMask) {
-  // FIXME: use posix_memalign if alignMask is larger than the system guarantee.
-  void *p = malloc(size);
+  void *p;
+
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+  if (size <= MaxSmallSize && alignMask < SizeClassGranule) {
+    p = SmallObjectHeap.get().alloc(SizeClassHeap::getSizeClass(size));
+    if (LLVM_LIKELY(p != nullptr))
+      return p;
+  }
+#endif
+
+  if (alignMask <= MallocAlignMask) {
+    p = malloc(size);
+  } else if (posix_memalign(&p, alignMask + 1, size) != 0) {
+    p = nullptr;
+  }
   if (!p) swift::crash("Could not allocate memory.");
   return p;
 }
 
 void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask) {
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+  auto &heap = SmallObjectHeap.get();
+  if (heap.owns(ptr)) {
+    heap.dealloc(ptr);
+    return;
+  }
+#endif
+
   free(ptr);
 }
+
+size_t swift::swift_slowAllocSize(const void *ptr) {
+#if SWIFT_RUNTIME_ENABLE_SIZE_CLASS_ALLOCATOR
+  auto &heap = SmallObjectHeap.get();
+  if (heap.owns(ptr))
+    return SizeClassHeap::getSizeOfClass(heap.getSizeClassOf(ptr));
+#endif
+
+#if defined(__APPLE__)
+  return malloc_size(ptr);
+#elif defined(__GNU_LIBRARY__)
+  return malloc_usable_size(const_cast<void *>(ptr));
+#else
+#error No malloc_size analog known for this platform/libc.
+#endif
+}
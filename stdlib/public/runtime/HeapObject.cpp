@@ -21,8 +21,10 @@
 #include "swift/Runtime/Metadata.h"
 #include "swift/ABI/System.h"
 #include "llvm/Support/MathExtras.h"
+#include "BiasedRefCounting.h"
 #include "MetadataCache.h"
 #include "Private.h"
+#include "Statistics.h"
 #include "swift/Runtime/Debug.h"
 #include <algorithm>
 #include <cassert>
@@ -55,6 +57,7 @@ swift::swift_allocObject(HeapMetadata const *metadata,
                          size_t requiredSize,
                          size_t requiredAlignmentMask) {
   SWIFT_ALLOCATEOBJECT();
+  countAllocation(metadata);
   return _swift_allocObject(metadata, requiredSize, requiredAlignmentMask);
 }
 static HeapObject *
@@ -318,6 +321,7 @@ void _swift_release_dealloc(HeapObject *object)
 
 void swift::swift_retain(HeapObject *object) {
   SWIFT_RETAIN();
+  countRuntimeEvent(RuntimeStatistic::Retain);
   _swift_retain(object);
 }
 static void _swift_retain_(HeapObject *object) {
@@ -327,6 +331,7 @@ auto swift::_swift_retain = _swift_retain_;
 
 void swift::swift_retain_n(HeapObject *object, uint32_t n) {
   SWIFT_RETAIN();
+  countRuntimeEvent(RuntimeStatistic::Retain, n);
   _swift_retain_n(object, n);
 }
 static void _swift_retain_n_(HeapObject *object, uint32_t n) {
@@ -338,6 +343,7 @@ auto swift::_swift_retain_n = _swift_retain_n_;
 
 void swift::swift_release(HeapObject *object) {
   SWIFT_RELEASE();
+  countRuntimeEvent(RuntimeStatistic::Release);
   return _swift_release(object);
 }
 static void _swift_release_(HeapObject *object) {
@@ -349,6 +355,7 @@ auto swift::_swift_release = _swift_release_;
 
 void swift::swift_release_n(HeapObject *object, uint32_t n) {
   SWIFT_RELEASE();
+  countRuntimeEvent(RuntimeStatistic::Release, n);
   return _swift_release_n(object, n);
 }
 static void _swift_release_n_(HeapObject *object, uint32_t n) {
@@ -359,9 +366,34 @@ static void _swift_release_n_(HeapObject *object, uint32_t n) {
 auto swift::_swift_release_n = _swift_release_n_;
 
 size_t swift::swift_retainCount(HeapObject *object) {
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  if (object->weakRefCount.isBiased())
+    return _swift_biasedRetainCount(object);
+#endif
   return object->refCount.getCount();
 }
 
+size_t swift::swift_allocObjectSize(const HeapObject *object) {
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  // Biased objects are allocated with a prefix in front of the header.
+  if (object->weakRefCount.isBiased())
+    return _swift_biasedAllocSize(object);
+#endif
+  return swift_slowAllocSize(object);
+}
+
+/// Free the memory of an object whose strong and weak reference counts have
+/// both dropped to zero.
+static void deallocObjectMemory(HeapObject *object, size_t allocatedSize,
+                                size_t allocatedAlignMask) {
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  // Biased objects are allocated with a prefix in front of the header.
+  if (object->weakRefCount.isBiased())
+    return _swift_biasedSlowDealloc(object, allocatedSize, allocatedAlignMask);
+#endif
+  swift_slowDealloc(object, allocatedSize, allocatedAlignMask);
+}
+
 size_t swift::swift_weakRetainCount(HeapObject *object) {
   return object->weakRefCount.getCount();
 }
@@ -381,8 +413,8 @@ void swift::swift_weakRelease(HeapObject *object) {
     assert(metadata->isClassObject());
     auto classMetadata = static_cast<const ClassMetadata*>(metadata);
     assert(classMetadata->isTypeMetadata());
-    swift_slowDealloc(object, classMetadata->getInstanceSize(),
-                      classMetadata->getInstanceAlignMask());
+    deallocObjectMemory(object, classMetadata->getInstanceSize(),
+                        classMetadata->getInstanceAlignMask());
   }
 }
 
@@ -401,8 +433,8 @@ void swift::swift_weakRelease_n(HeapObject *object, int n) {
     assert(metadata->isClassObject());
     auto classMetadata = static_cast<const ClassMetadata*>(metadata);
     assert(classMetadata->isTypeMetadata());
-    swift_slowDealloc(object, classMetadata->getInstanceSize(),
-                      classMetadata->getInstanceAlignMask());
+    deallocObjectMemory(object, classMetadata->getInstanceSize(),
+                        classMetadata->getInstanceAlignMask());
   }
 }
 
@@ -421,6 +453,10 @@ HeapObject *swift::swift_tryPin(HeapObject *object) {
 }
 
 void swift::swift_unpin(HeapObject *object) {
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  if (object && object->weakRefCount.isBiased())
+    return _swift_biasedUnpin(object);
+#endif
   if (object && object->refCount.decrementAndUnpinShouldDeallocate()) {
     _swift_release_dealloc(object);
   }
@@ -533,6 +569,7 @@ static inline void memset_pattern8(void *b, const void *pattern8, size_t len) {
 void swift::swift_deallocObject(HeapObject *object, size_t allocatedSize,
                                 size_t allocatedAlignMask) {
   SWIFT_DEALLOCATEOBJECT();
+  countRuntimeEvent(RuntimeStatistic::DeallocObject);
   assert(isAlignmentMask(allocatedAlignMask));
   assert(object->refCount.isDeallocating());
 #ifdef SWIFT_RUNTIME_CLOBBER_FREED_OBJECTS
@@ -610,7 +647,7 @@ void swift::swift_deallocObject(HeapObject *object, size_t allocatedSize,
   // atomic decrement (and has the ability to reconstruct
   // allocatedSize and allocatedAlignMask).
   if (object->weakRefCount.getCount() == 1) {
-    swift_slowDealloc(object, allocatedSize, allocatedAlignMask);
+    deallocObjectMemory(object, allocatedSize, allocatedAlignMask);
   } else {
     swift_weakRelease(object);
   }
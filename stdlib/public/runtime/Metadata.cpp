@@ -71,23 +71,36 @@ void *MetadataAllocator::alloc(size_t size) {
     return mem;
   }
   
-  char *end = next + size;
-  
-  // Allocate a new page if we need one.
-  if (LLVM_UNLIKELY(((uintptr_t)next & ~pagesizeMask)
-                      != (((uintptr_t)end & ~pagesizeMask)))){
-    next = (char*)
+  char *curr = next.load(std::memory_order_relaxed);
+  while (true) {
+    char *end = curr + size;
+
+    // Fast path: bump the pointer within the current page.
+    if (LLVM_LIKELY(((uintptr_t)curr & ~pagesizeMask)
+                      == (((uintptr_t)end & ~pagesizeMask)))) {
+      if (next.compare_exchange_weak(curr, end, std::memory_order_relaxed,
+                                     std::memory_order_relaxed))
+        return curr;
+      continue;
+    }
+
+    // Allocate a new page if we need one.
+    char *page = (char*)
       mmap(nullptr, pagesizeMask+1, PROT_READ|PROT_WRITE,
            MAP_ANON|MAP_PRIVATE, VM_TAG_FOR_SWIFT_METADATA, 0);
 
-    if (next == MAP_FAILED)
+    if (page == MAP_FAILED)
       crash("unable to allocate memory for metadata cache");
-    end = next + size;
+
+    if (next.compare_exchange_strong(curr, page + size,
+                                     std::memory_order_relaxed,
+                                     std::memory_order_relaxed))
+      return page;
+
+    // Another thread installed a fresh page first. Give ours back and
+    // retry against the new bump pointer.
+    munmap(page, pagesizeMask+1);
   }
-  
-  char *addr = next;
-  next = end;
-  return addr;
 }
 
 namespace {
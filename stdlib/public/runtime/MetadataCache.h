@@ -16,6 +16,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
+#include "Statistics.h"
 #include <mutex>
 #include <condition_variable>
 
@@ -138,8 +139,16 @@ public:
   }
 };
 
+/// The number of construction locks in each metadata cache.  Must be a
+/// power of two.
+static constexpr size_t NumMetadataCacheConstructionLocks = 8;
+
 /// The implementation of a metadata cache.  Note that all-zero must
 /// be a valid state for the cache.
+///
+/// Lookups never take a lock.  Construction of a new entry is serialized
+/// only against other constructions whose keys hash to the same
+/// construction lock, so unrelated instantiations proceed in parallel.
 template <class Entry> class MetadataCache {
 
   /// This pair ties an EntryRef Key and an Entry Value.
@@ -155,42 +164,55 @@ template <class Entry> class MetadataCache {
   /// This map hash codes of entry refs to a list of entry pairs.
   MDMapTy *Map;
 
-  /// Synchronization of metadata creation.
-  std::mutex *Lock;
+  /// Synchronization of metadata creation, sharded by key hash.
+  std::mutex *Locks;
   
   /// The head of a linked list connecting all the metadata cache entries.
   /// TODO: Remove this when LLDB is able to understand the final data
   /// structure for the metadata cache.
-  const Entry *Head;
+  std::atomic<const Entry *> Head;
 
   /// Allocator for entries of this cache.
   MetadataAllocator Allocator;
+
+  /// Select the construction lock that guards keys with the given hash.
+  std::mutex &getConstructionLock(size_t hash) {
+    static_assert((NumMetadataCacheConstructionLocks &
+                   (NumMetadataCacheConstructionLocks - 1)) == 0,
+                  "number of construction locks must be a power of two");
+    return Locks[(hash ^ (hash >> 16)) &
+                 (NumMetadataCacheConstructionLocks - 1)];
+  }
   
 public:
-  MetadataCache() : Map(new MDMapTy()), Lock(new std::mutex()) {}
-  ~MetadataCache() { delete Map; delete Lock; }
+  MetadataCache()
+    : Map(new MDMapTy()),
+      Locks(new std::mutex[NumMetadataCacheConstructionLocks]) {}
+  ~MetadataCache() { delete Map; delete [] Locks; }
 
   /// Caches are not copyable.
   MetadataCache(const MetadataCache &other) = delete;
   MetadataCache &operator=(const MetadataCache &other) = delete;
 
   /// Get the allocator for metadata in this cache.
-  /// The allocator can only be safely used while the cache is locked during
-  /// an addMetadataEntry call.
+  /// The allocator is safe to use concurrently from entry builders running
+  /// under different construction locks.
   MetadataAllocator &getAllocator() { return Allocator; }
 
   /// Call entryBuilder() and add the generated metadata to the cache.
-  /// \p key is the key used by the cache and \p Bucket is the cache
-  /// entry to place the new metadata entry.
+  /// \p key is the key used by the cache, \p hash is its hash code and
+  /// \p Bucket is the cache entry to place the new metadata entry.
   /// This method is marked as 'noinline' because it is infrequently executed
   /// and marking it as such generates better code that is easier to analyze
   /// and profile.
   __attribute__ ((noinline))
-  const Entry *addMetadataEntry(EntryRef<Entry> key,
+  const Entry *addMetadataEntry(EntryRef<Entry> key, size_t hash,
                                 ConcurrentList<EntryPair> &Bucket,
                                 llvm::function_ref<Entry *()> entryBuilder) {
-    // Hold a lock to prevent the modification of the cache by multiple threads.
-    std::unique_lock<std::mutex> ConstructionGuard(*Lock);
+    // Hold the construction lock for this key to prevent another thread
+    // from building the same entry. Every key in Bucket shares its hash, and
+    // therefore its lock, so this also serializes all insertions into Bucket.
+    std::unique_lock<std::mutex> ConstructionGuard(getConstructionLock(hash));
 
     // Some other thread may have setup the value we are about to construct
     // while we were asleep so do a search before constructing a new value.
@@ -202,14 +224,19 @@ public:
     // For some cache types this call may re-entrantly perform additional
     // cache lookups.
     // Notice that the entry is completly constructed before it is inserted
-    // into the map, and that only one entry can be constructed at once
-    // because of the lock above.
+    // into the map, and that only one entry per construction lock can be
+    // constructed at once.
+    countRuntimeEvent(RuntimeStatistic::MetadataCacheMiss);
     Entry *entry = entryBuilder();
     assert(entry);
 
     // Update the linked list.
-    entry->Next = Head;
-    Head = entry;
+    const Entry *OldHead = Head.load(std::memory_order_relaxed);
+    do {
+      entry->Next = OldHead;
+    } while (!Head.compare_exchange_weak(OldHead, entry,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
 
     key = EntryRef<Entry>::forEntry(entry, entry->getNumArguments());
     Bucket.push_front(EntryPair(key, entry));
@@ -251,7 +278,7 @@ public:
     }
 
     // We did not find a key so we will need to create one and store it.
-    return addMetadataEntry(key, Bucket, entryBuilder);
+    return addMetadataEntry(key, hash, Bucket, entryBuilder);
   }
 };
 
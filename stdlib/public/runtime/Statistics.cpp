@@ -0,0 +1,321 @@
+//===--- Statistics.cpp - Swift Runtime Statistics ------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Per-thread counters of runtime events, aggregated on demand.
+//
+// Each thread counts into its own block, which only that thread writes, so
+// counting needs neither locks nor atomic read-modify-write operations.
+// The blocks of live threads are kept in a list that is walked when the
+// statistics are read; when a thread exits, its counts are folded into
+// the totals of retired threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/Lazy.h"
+#include "swift/Runtime/Debug.h"
+#include "swift/Runtime/Metadata.h"
+#include "Statistics.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace swift;
+
+std::atomic<RuntimeStatisticsState>
+swift::_swift_runtimeStatisticsState(RuntimeStatisticsState::Uninitialized);
+
+static OnceToken_t EnvironmentToken;
+
+/// Turn on the statistics if SWIFT_RUNTIME_STATISTICS is set, and dump them
+/// when the process exits.
+static void readEnvironment(void *) {
+  const char *value = getenv("SWIFT_RUNTIME_STATISTICS");
+  bool enabled = value && *value && strcmp(value, "0") != 0;
+  _swift_runtimeStatisticsState.store(enabled
+                                        ? RuntimeStatisticsState::Enabled
+                                        : RuntimeStatisticsState::Disabled,
+                                      std::memory_order_relaxed);
+  if (enabled)
+    atexit(swift_dumpRuntimeStatistics);
+}
+
+/// Read the environment the first time the statistics are used, so that
+/// loading the runtime doesn't need a static initializer.
+static void initializeFromEnvironment() {
+  SWIFT_ONCE_F(EnvironmentToken, readEnvironment, nullptr);
+}
+
+/// Whether an event that passed the inline check should be counted.
+static bool shouldCount() {
+  if (LLVM_LIKELY(_swift_runtimeStatisticsState.load(
+                    std::memory_order_relaxed) ==
+                  RuntimeStatisticsState::Enabled))
+    return true;
+  initializeFromEnvironment();
+  return _swift_runtimeStatisticsState.load(std::memory_order_relaxed) ==
+           RuntimeStatisticsState::Enabled;
+}
+
+static const char * const StatisticNames[] = {
+#define RUNTIME_STATISTIC(Name, Description) Description,
+#include "swift/Runtime/Statistics.def"
+};
+
+static constexpr size_t NumStatistics =
+  sizeof(StatisticNames) / sizeof(StatisticNames[0]);
+
+/// Add to a counter that only the current thread writes.
+static void bump(std::atomic<uint64_t> &counter, uint64_t n = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+namespace {
+
+/// The counters of a single thread.
+struct ThreadStatistics {
+  std::atomic<uint64_t> Counts[NumStatistics];
+
+  /// The size of the per-thread table of allocation counts. Must be a
+  /// power of two.
+  static constexpr unsigned AllocationTableSize = 512;
+
+  /// How many slots to probe before giving up on finding a free one.
+  static constexpr unsigned MaxProbes = 16;
+
+  /// An allocation count for a metadata. The owner thread publishes the
+  /// key once, after which only the count changes.
+  struct AllocationEntry {
+    std::atomic<const HeapMetadata *> Metadata;
+    std::atomic<uint64_t> Count;
+  };
+
+  /// Allocation counts by metadata, in an open-addressed table.
+  AllocationEntry Allocations[AllocationTableSize];
+
+  /// Allocations whose metadata didn't fit in the table.
+  std::atomic<uint64_t> OtherAllocations;
+
+  ThreadStatistics *Prev = nullptr;
+  ThreadStatistics *Next = nullptr;
+
+  ThreadStatistics() {
+    for (auto &count : Counts)
+      count.store(0, std::memory_order_relaxed);
+    for (auto &entry : Allocations) {
+      entry.Metadata.store(nullptr, std::memory_order_relaxed);
+      entry.Count.store(0, std::memory_order_relaxed);
+    }
+    OtherAllocations.store(0, std::memory_order_relaxed);
+  }
+
+  void countAllocation(const HeapMetadata *metadata) {
+    size_t index = uintptr_t(metadata) >> 4;
+    for (unsigned probe = 0; probe != MaxProbes; ++probe) {
+      auto &entry = Allocations[(index + probe) & (AllocationTableSize - 1)];
+      auto key = entry.Metadata.load(std::memory_order_relaxed);
+      if (key == metadata) {
+        bump(entry.Count);
+        return;
+      }
+      if (!key) {
+        entry.Count.store(1, std::memory_order_relaxed);
+        entry.Metadata.store(metadata, std::memory_order_release);
+        return;
+      }
+    }
+    bump(OtherAllocations);
+  }
+
+  /// Add this thread's allocation counts to \p totals.
+  void addAllocations(
+         std::unordered_map<const HeapMetadata *, uint64_t> &totals) const {
+    for (auto &entry : Allocations) {
+      auto key = entry.Metadata.load(std::memory_order_acquire);
+      if (key)
+        totals[key] += entry.Count.load(std::memory_order_relaxed);
+    }
+    if (auto other = OtherAllocations.load(std::memory_order_relaxed))
+      totals[nullptr] += other;
+  }
+};
+
+/// The registry of per-thread counters.
+class StatisticsRegistry {
+  pthread_key_t Key;
+
+  /// Protects the list of live threads and the retired totals.
+  std::mutex Lock;
+
+  /// The counters of threads that haven't exited.
+  ThreadStatistics *Threads = nullptr;
+
+  /// The counts of threads that have exited.
+  uint64_t RetiredCounts[NumStatistics] = {};
+  std::unordered_map<const HeapMetadata *, uint64_t> RetiredAllocations;
+
+  static void retireThread(void *stats);
+
+public:
+  StatisticsRegistry() {
+    if (pthread_key_create(&Key, retireThread) != 0)
+      crash("Could not create the runtime statistics thread key.");
+  }
+
+  ThreadStatistics *getThreadStatistics() {
+    auto stats = static_cast<ThreadStatistics *>(pthread_getspecific(Key));
+    if (LLVM_LIKELY(stats != nullptr))
+      return stats;
+
+    stats = new ThreadStatistics();
+    {
+      std::lock_guard<std::mutex> guard(Lock);
+      stats->Next = Threads;
+      if (Threads)
+        Threads->Prev = stats;
+      Threads = stats;
+    }
+    pthread_setspecific(Key, stats);
+    return stats;
+  }
+
+  uint64_t getCount(size_t index) {
+    std::lock_guard<std::mutex> guard(Lock);
+    uint64_t total = RetiredCounts[index];
+    for (auto stats = Threads; stats; stats = stats->Next)
+      total += stats->Counts[index].load(std::memory_order_relaxed);
+    return total;
+  }
+
+  std::unordered_map<const HeapMetadata *, uint64_t> getAllocations() {
+    std::lock_guard<std::mutex> guard(Lock);
+    auto totals = RetiredAllocations;
+    for (auto stats = Threads; stats; stats = stats->Next)
+      stats->addAllocations(totals);
+    return totals;
+  }
+};
+
+} // end anonymous namespace
+
+static Lazy<StatisticsRegistry> Registry;
+
+void StatisticsRegistry::retireThread(void *ptr) {
+  auto stats = static_cast<ThreadStatistics *>(ptr);
+  auto &registry = Registry.get();
+  {
+    std::lock_guard<std::mutex> guard(registry.Lock);
+    for (size_t i = 0; i != NumStatistics; ++i)
+      registry.RetiredCounts[i] +=
+        stats->Counts[i].load(std::memory_order_relaxed);
+    stats->addAllocations(registry.RetiredAllocations);
+
+    if (stats->Prev)
+      stats->Prev->Next = stats->Next;
+    else
+      registry.Threads = stats->Next;
+    if (stats->Next)
+      stats->Next->Prev = stats->Prev;
+  }
+  delete stats;
+}
+
+void swift::_swift_countRuntimeEvent(RuntimeStatistic statistic,
+                                     uint64_t n) {
+  if (!shouldCount())
+    return;
+  auto stats = Registry->getThreadStatistics();
+  bump(stats->Counts[static_cast<unsigned>(statistic)], n);
+}
+
+void swift::_swift_countAllocation(const HeapMetadata *metadata) {
+  if (!shouldCount())
+    return;
+  auto stats = Registry->getThreadStatistics();
+  bump(stats->Counts[static_cast<unsigned>(RuntimeStatistic::AllocObject)]);
+  stats->countAllocation(metadata);
+}
+
+void swift::swift_setRuntimeStatisticsEnabled(bool enabled) {
+  // Read the environment first so that it can't override this setting later.
+  initializeFromEnvironment();
+  _swift_runtimeStatisticsState.store(enabled
+                                        ? RuntimeStatisticsState::Enabled
+                                        : RuntimeStatisticsState::Disabled,
+                                      std::memory_order_relaxed);
+}
+
+bool swift::swift_areRuntimeStatisticsEnabled() {
+  initializeFromEnvironment();
+  return _swift_runtimeStatisticsState.load(std::memory_order_relaxed) ==
+           RuntimeStatisticsState::Enabled;
+}
+
+size_t swift::swift_getNumRuntimeStatistics() {
+  return NumStatistics;
+}
+
+const char *swift::swift_getRuntimeStatisticName(size_t index) {
+  if (index >= NumStatistics)
+    return nullptr;
+  return StatisticNames[index];
+}
+
+uint64_t swift::swift_getRuntimeStatistic(size_t index) {
+  if (index >= NumStatistics)
+    return 0;
+  return Registry->getCount(index);
+}
+
+void swift::swift_enumerateAllocationStatistics(
+       AllocationStatisticCallback callback, void *context) {
+  for (auto &entry : Registry->getAllocations())
+    callback(entry.first, entry.second, context);
+}
+
+void swift::swift_dumpRuntimeStatistics() {
+  fprintf(stderr, "--- Swift runtime statistics ---\n");
+  for (size_t i = 0; i != NumStatistics; ++i) {
+    fprintf(stderr, "%12llu %s\n",
+            (unsigned long long) swift_getRuntimeStatistic(i),
+            StatisticNames[i]);
+  }
+
+  // Report the types with the most allocations.
+  const size_t NumAllocatedTypes = 20;
+  auto allocations = Registry->getAllocations();
+  std::vector<std::pair<const HeapMetadata *, uint64_t>>
+    sorted(allocations.begin(), allocations.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<const HeapMetadata *, uint64_t> &lhs,
+               const std::pair<const HeapMetadata *, uint64_t> &rhs) {
+    return lhs.second > rhs.second;
+  });
+  if (sorted.size() > NumAllocatedTypes)
+    sorted.resize(NumAllocatedTypes);
+
+  if (!sorted.empty())
+    fprintf(stderr, "--- Most allocated types ---\n");
+  for (auto &entry : sorted) {
+    std::string name = entry.first ? nameForMetadata(entry.first)
+                                   : "<other types>";
+    fprintf(stderr, "%12llu %s\n",
+            (unsigned long long) entry.second, name.c_str());
+  }
+}
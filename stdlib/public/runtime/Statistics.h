@@ -0,0 +1,61 @@
+//===--- Statistics.h - Runtime statistics counting -------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Hooks used by the rest of the runtime to count events for the runtime
+// statistics. See swift/Runtime/Statistics.h for the public interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_RUNTIME_STATISTICS_IMPL_H
+#define SWIFT_RUNTIME_STATISTICS_IMPL_H
+
+#include "swift/Runtime/Statistics.h"
+#include "llvm/Support/Compiler.h"
+#include <atomic>
+
+namespace swift {
+
+/// Whether runtime events are being counted.
+enum class RuntimeStatisticsState : unsigned char {
+  Disabled,
+  Enabled,
+  /// SWIFT_RUNTIME_STATISTICS hasn't been read yet. The first event that is
+  /// counted reads it.
+  Uninitialized
+};
+
+extern std::atomic<RuntimeStatisticsState> _swift_runtimeStatisticsState;
+
+void _swift_countRuntimeEvent(RuntimeStatistic statistic, uint64_t n);
+void _swift_countAllocation(const HeapMetadata *metadata);
+
+/// Count \p n occurrences of the given event, if statistics are enabled.
+static inline void countRuntimeEvent(RuntimeStatistic statistic,
+                                     uint64_t n = 1) {
+  if (LLVM_UNLIKELY(_swift_runtimeStatisticsState.load(
+                      std::memory_order_relaxed) !=
+                    RuntimeStatisticsState::Disabled))
+    _swift_countRuntimeEvent(statistic, n);
+}
+
+/// Count an object allocation with the given metadata, if statistics are
+/// enabled.
+static inline void countAllocation(const HeapMetadata *metadata) {
+  if (LLVM_UNLIKELY(_swift_runtimeStatisticsState.load(
+                      std::memory_order_relaxed) !=
+                    RuntimeStatisticsState::Disabled))
+    _swift_countAllocation(metadata);
+}
+
+} // end namespace swift
+
+#endif /* SWIFT_RUNTIME_STATISTICS_IMPL_H */
@@ -31,6 +31,7 @@
 #include "swift/Runtime/ObjCBridge.h"
 #include "swift/Strings.h"
 #include "../SwiftShims/RuntimeShims.h"
+#include "BiasedRefCounting.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
 #include <dlfcn.h>
@@ -1341,6 +1342,10 @@ bool swift::swift_isUniquelyReferenced_nonNull_native(
   assert(object != nullptr);
   assert(!object->refCount.isDeallocating());
   SWIFT_ISUNIQUELYREFERENCED();
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  if (object->weakRefCount.isBiased())
+    return _swift_biasedIsUniquelyReferenced(object, /*orPinned*/ false);
+#endif
   return object->refCount.isUniquelyReferenced();
 }
 
@@ -1447,6 +1452,10 @@ bool swift::swift_isUniquelyReferencedOrPinned_nonNull_native(
   SWIFT_ISUNIQUELYREFERENCEDORPINNED();
   assert(object != nullptr);
   assert(!object->refCount.isDeallocating());
+#if SWIFT_RUNTIME_ENABLE_BIASED_REFCOUNTING
+  if (object->weakRefCount.isBiased())
+    return _swift_biasedIsUniquelyReferenced(object, /*orPinned*/ true);
+#endif
   return object->refCount.isUniquelyReferencedOrPinned();
 }
 
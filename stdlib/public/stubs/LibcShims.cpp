@@ -47,17 +47,14 @@ __swift_ssize_t _swift_stdlib_write(int fd, const void *buf,
 
 int _swift_stdlib_close(int fd) { return close(fd); }
 
-#if defined(__APPLE__)
-#include <malloc/malloc.h>
-size_t _swift_stdlib_malloc_size(const void *ptr) { return malloc_size(ptr); }
-#elif defined(__GNU_LIBRARY__)
-#include <malloc.h>
+// This is only used on heap objects, which may come from the runtime's own
+// allocator rather than from malloc and may not start at the beginning of
+// their allocation, so ask the runtime.
+namespace swift { struct HeapObject; }
+extern "C" size_t swift_allocObjectSize(const swift::HeapObject *object);
 size_t _swift_stdlib_malloc_size(const void *ptr) {
-  return malloc_usable_size(const_cast<void *>(ptr));
+  return swift_allocObjectSize(static_cast<const swift::HeapObject *>(ptr));
 }
-#else
-#error No malloc_size analog known for this platform/libc.
-#endif
 
 __swift_uint32_t _swift_stdlib_arc4random(void) { return arc4random(); }
 
@@ -0,0 +1,20 @@
+// RUN: %target-parse-verify-swift
+
+// Expressions whose operators and literals form many independent
+// subexpressions, each of which used to be re-solved for every overload
+// tried for the operators around it.
+
+func f(x: Int, y: Int, z: Int) -> Int {
+  return x * 2 + y * 3 + z * 4 + (x - y) * (y - z) + (z - x) * 5 + 6
+}
+
+func g(a: Double, b: Double) -> Double {
+  return (a + 1) * (b + 2) + (a - 3) * (b - 4) + (a * 5) / (b * 6) + 7
+}
+
+let _ = [1 + 2, 3 * 4, 5 - 6, 7 / 8, 9 + 10, 11 * 12, 13 - 14, 15 + 16]
+let _: Double = 1 + 2 * 3 + (4 - 5) * 6.0 + 7 / 8 + (9 + 10) * 11
+let _ = -(1 + 2) * -(3 + 4) + -(5 - 6) * -(7 - 8) + -(9 * 10)
+
+let s = "a"
+let _ = s + "b" + s + "c" + (s + "d") + (s + "e") + s + "f"
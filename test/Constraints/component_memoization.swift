@@ -0,0 +1,29 @@
+// RUN: %target-parse-verify-swift
+// RUN: %target-swift-frontend -parse -debug-constraints %s 2>&1 | FileCheck %s
+// RUN: %target-swift-frontend -parse -debug-time-expression-type-checking %s 2>&1 | FileCheck -check-prefix=SCALE %s
+
+// Each choice for 'p' only binds the result of 'p' to Int, so the component
+// formed by 'q' and the calls to 'r' is the same for every choice after the
+// first one that is tried, and its solutions can be reused.
+func p(x: Int) -> Int { return 0 }
+func p(x: Int8) -> Int { return 0 }
+func p(x: Int16) -> Int { return 0 }
+func p(x: Int32) -> Int { return 0 }
+
+func r(x: Int) -> Int { return x }
+func r(x: String) -> String { return x }
+func r(x: Double) -> Double { return x }
+func r(x: Float) -> Float { return x }
+func r(x: Bool) -> Bool { return x }
+
+func q<T>(a: T, _ b: T) -> T { return a }
+
+let v = 0
+
+// CHECK: (reusing solutions for component #
+let _: Int = q(p(1), r(r(r(v))))
+
+// Without reuse, the calls to 'r' are solved again for every choice of 'p',
+// so the number of states explored grows with the number of overloads of 'p'.
+// SCALE: component_memoization.swift:[[@LINE+1]]:{{[0-9]+}} {{[0-9]{1,3}}} states
+let _: Int = q(p(1), r(r(r(r(r(r(v)))))))
@@ -0,0 +1,14 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: touch %t/file-01.swift %t/file-02.swift %t/file-03.swift %t/file-04.swift
+
+// RUN: %swiftc_driver -enable-batch-mode -j2 -c -module-name main %t/file-01.swift %t/file-02.swift %t/file-03.swift %t/file-04.swift -driver-skip-execution -v 2>&1 | FileCheck %s
+// CHECK: -frontend -c {{.*}}-primary-file {{[^ ]*}}file-01.swift {{.*}} -batch-primary-file {{[^ ]*}}file-03.swift {{[^ ]*}}file-03-{{[^ ]*}}.o "" "" "" ""{{$}}
+// CHECK: -frontend -c {{.*}}-primary-file {{[^ ]*}}file-02.swift {{.*}} -batch-primary-file {{[^ ]*}}file-04.swift {{[^ ]*}}file-04-{{[^ ]*}}.o "" "" "" ""{{$}}
+
+// RUN: %swiftc_driver -enable-batch-mode -j1 -c -module-name main %t/file-01.swift %t/file-02.swift %t/file-03.swift %t/file-04.swift -driver-skip-execution -v 2>&1 | FileCheck -check-prefix=ONE-BATCH %s
+// ONE-BATCH: -primary-file {{[^ ]*}}file-01.swift {{.*}} -batch-primary-file {{[^ ]*}}file-02.swift {{.*}} -batch-primary-file {{[^ ]*}}file-03.swift {{.*}} -batch-primary-file {{[^ ]*}}file-04.swift
+// ONE-BATCH-NOT: -frontend
+
+// RUN: %swiftc_driver -j2 -c -module-name main %t/file-01.swift %t/file-02.swift -driver-skip-execution -v 2>&1 | FileCheck -check-prefix=NO-BATCH %s
+// RUN: %swiftc_driver -enable-batch-mode -j2 -c -module-name main %t/file-01.swift %t/file-02.swift %t/file-03.swift -serialize-diagnostics -driver-skip-execution -v 2>&1 | FileCheck -check-prefix=NO-BATCH %s
+// NO-BATCH-NOT: -batch-primary-file
@@ -72,6 +72,7 @@
 // COMPLEX-DAG: -I /path/to/headers -I path/to/more/headers
 // COMPLEX-DAG: -module-cache-path /tmp/modules
 // COMPLEX-DAG: -emit-reference-dependencies-path {{(.*/)?driver-compile[^ /]+}}.swiftdeps
+// COMPLEX-DAG: -emit-binary-reference-dependencies
 // COMPLEX: -o {{.+}}.o
 
 
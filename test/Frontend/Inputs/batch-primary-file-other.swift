@@ -0,0 +1,3 @@
+func fromOther() -> Int {
+  return fromMain() + 1
+}
@@ -0,0 +1,29 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: %target-swift-frontend -c -module-name batch -primary-file %s %S/Inputs/batch-primary-file-other.swift -batch-primary-file %S/Inputs/batch-primary-file-other.swift %t/other.o "" "" "" %t/other.swiftdeps -emit-reference-dependencies-path %t/main.swiftdeps -o %t/main.o
+// RUN: ls %t/main.o %t/other.o
+// RUN: FileCheck -check-prefix=MAIN %s < %t/main.swiftdeps
+// RUN: FileCheck -check-prefix=OTHER %s < %t/other.swiftdeps
+
+// RUN: not %target-swift-frontend -c %s -batch-primary-file %s %t/main.o "" "" "" "" 2>&1 | FileCheck -check-prefix=NO-PRIMARY %s
+// NO-PRIMARY: error: -batch-primary-file requires -primary-file
+
+// RUN: not %target-swift-frontend -c -primary-file %s -batch-primary-file %t/missing.swift %t/missing.o "" "" "" "" 2>&1 | FileCheck -check-prefix=NOT-INPUT %s
+// NOT-INPUT: error: batch primary file '{{.*}}missing.swift' is not an input file
+
+// MAIN-LABEL: {{^provides-top-level:$}}
+// MAIN-NEXT: "fromMain"
+// MAIN-LABEL: {{^depends-top-level:$}}
+// MAIN: "fromOther"
+
+// OTHER-LABEL: {{^provides-top-level:$}}
+// OTHER-NEXT: "fromOther"
+// OTHER-LABEL: {{^depends-top-level:$}}
+// OTHER: "fromMain"
+
+func fromMain() -> Int {
+  return 0
+}
+
+func useOther() -> Int {
+  return fromOther()
+}
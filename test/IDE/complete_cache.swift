@@ -31,6 +31,10 @@
 // Check the individual cache item.
 // RUN: %target-swift-ide-test -dump-completion-cache %t.ccp/macros-* | FileCheck %s -check-prefix=CLANG_QUAL_MACROS_1
 
+// Only read the results with a given name prefix from the cache.
+// RUN: %target-swift-ide-test -dump-completion-cache -completion-cache-name-prefix=gl_ %t.ccp/macros-* | FileCheck %s -check-prefix=CLANG_QUAL_MACROS_GL
+// RUN: %target-swift-ide-test(mock-sdk: %clang-importer-sdk) -code-completion -source-filename %s -code-completion-token=CLANG_QUAL_MACROS_1 -completion-cache-path=%t.ccp -completion-cache-name-prefix=GL_ | FileCheck %s -check-prefix=CLANG_QUAL_MACROS_GL_COMPL
+
 
 // Qualified with dot.
 // RUN: %target-swift-ide-test(mock-sdk: %clang-importer-sdk) -code-completion -source-filename %s -code-completion-token=CLANG_QUAL_MACROS_2 -completion-cache-path=%t.ccp > %t.macros2.ccp1.compl.txt
@@ -87,6 +91,20 @@ func testCompleteModuleQualifiedMacros1() {
 // CLANG_QUAL_MACROS_1-DAG: Decl[GlobalVar]/OtherModule[macros]: UTF8_STRING[#String#]{{; name=.+$}}
 // CLANG_QUAL_MACROS_1-DAG: Decl[GlobalVar]/OtherModule[macros]: VERSION_STRING[#String#]{{; name=.+$}}
 // CLANG_QUAL_MACROS_1: End completions
+
+// CLANG_QUAL_MACROS_GL: Begin completions, 3 items
+// CLANG_QUAL_MACROS_GL-DAG: Decl[GlobalVar]/OtherModule[macros]: GL_FALSE[#Int32#]{{; name=.+$}}
+// CLANG_QUAL_MACROS_GL-DAG: Decl[GlobalVar]/OtherModule[macros]: GL_RGBA[#Int32#]{{; name=.+$}}
+// CLANG_QUAL_MACROS_GL-DAG: Decl[GlobalVar]/OtherModule[macros]: GL_RGB[#Int32#]{{; name=.+$}}
+// CLANG_QUAL_MACROS_GL: End completions
+
+// CLANG_QUAL_MACROS_GL_COMPL: Begin completions
+// CLANG_QUAL_MACROS_GL_COMPL-NOT: A_PI
+// CLANG_QUAL_MACROS_GL_COMPL: GL_FALSE[#Int32#]
+// CLANG_QUAL_MACROS_GL_COMPL: GL_RGB[#Int32#]
+// CLANG_QUAL_MACROS_GL_COMPL: GL_RGBA[#Int32#]
+// CLANG_QUAL_MACROS_GL_COMPL-NOT: VERSION_STRING
+// CLANG_QUAL_MACROS_GL_COMPL: End completions
 }
 
 func testCompleteModuleQualifiedMacros2() {
@@ -0,0 +1,25 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %target-swift-ide-test -print-ast-typechecked -enable-swift-name-lookup-tables -function-definitions=false -source-filename %s -I %S/Inputs/swift_name_module -module-cache-path %t/clang-module-cache > %t/first.txt 2> %t/first.err
+// RUN: FileCheck %s < %t/first.txt
+// RUN: FileCheck -check-prefix=NO-ERRORS -allow-empty %s < %t/first.err
+
+// The second run looks the names up in the table of the cached module.
+// RUN: %target-swift-ide-test -print-ast-typechecked -enable-swift-name-lookup-tables -function-definitions=false -source-filename %s -I %S/Inputs/swift_name_module -module-cache-path %t/clang-module-cache > %t/cached.txt 2> %t/cached.err
+// RUN: FileCheck %s < %t/cached.txt
+// RUN: FileCheck -check-prefix=NO-ERRORS -allow-empty %s < %t/cached.err
+
+// Clang's name lookup can't find these by their Swift names.
+import SwiftName
+
+// CHECK: func useRenamedTypes(
+func useRenamedTypes(s: SomeStruct, i: MyInt) -> SNColorChoice {
+  return .Rouge
+}
+
+// CHECK: func useRenamedValues(
+func useRenamedValues() -> SomeStruct {
+  _ = Bar
+  return makeSomeStruct(x: 1, y: 2)
+}
+
+// NO-ERRORS-NOT: error:
@@ -0,0 +1,3 @@
+public func useFromOther(x: Int) -> Int {
+  return genericId(x) + 1
+}
@@ -7,12 +7,27 @@
 // RUN: %target-swift-frontend -c %S/Inputs/multithread_module/main.swift -o %t/main.o %s -o %t/mt_module.o -num-threads 2 -O -g -module-name test
 // RUN: %target-build-swift %t/main.o %t/mt_module.o -o %t/a.out
 // RUN: %target-run %t/a.out | FileCheck %s
+
+// RUN: %target-swift-frontend -c %S/Inputs/multithread_module/main.swift -o %t/main-balanced.o %s -o %t/mt_module-balanced.o -num-threads 2 -O -g -module-name test -balance-codegen-units
+// RUN: %target-build-swift %t/main-balanced.o %t/mt_module-balanced.o -o %t/a-balanced.out
+// RUN: %target-run %t/a-balanced.out | FileCheck %s
+
+// With -balance-codegen-units there is an output file for each thread, not for each input file.
+// RUN: %target-swift-frontend -emit-ir %S/Inputs/multithread_module/main.swift %s -o %t/unit0.ll -o %t/unit1.ll -o %t/unit2.ll -num-threads 3 -O -module-name test -balance-codegen-units
+// RUN: FileCheck --check-prefix=CHECK-UNIT %s <%t/unit2.ll
+// RUN: %target-swift-frontend -c %S/Inputs/multithread_module/main.swift %s -o %t/unit0.o -o %t/unit1.o -o %t/unit2.o -num-threads 3 -O -g -module-name test -balance-codegen-units
+// RUN: %target-build-swift %t/unit0.o %t/unit1.o %t/unit2.o -o %t/a-three-units.out
+// RUN: %target-run %t/a-three-units.out | FileCheck %s
+// RUN: %target-swift-frontend -c %S/Inputs/multithread_module/main.swift %s -o %t/single-unit.o -num-threads 1 -O -g -module-name test -balance-codegen-units
+// RUN: %target-build-swift %t/single-unit.o -o %t/a-single-unit.out
+// RUN: %target-run %t/a-single-unit.out | FileCheck %s
 // REQUIRES: executable_test
 
 
 // Test compilation of a module in multi-threaded compilation.
 // The main purpose of the test is to check that the generated LLVM modules are not corrupt
-// and that linking succeeds.
+// and that linking succeeds, also if the functions are distributed over the
+// LLVM modules by size, with more or fewer LLVM modules than source files.
 
 // CHECK: 28
 // CHECK: 125
@@ -63,3 +78,7 @@ func callproto(p: MyProto) {
 
 // CHECK-MODULELL: DICompileUnit(language: DW_LANG_Swift, file: [[F:![0-9]+]]
 // CHECK-MODULELL: [[F]] = !DIFile(filename: "{{.*}}IRGen/multithread_module.swift", directory: "{{.*}}")
+
+// The third LLVM module has no source file, but still gets functions.
+
+// CHECK-UNIT: define {{.*}}@
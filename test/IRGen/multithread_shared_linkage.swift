@@ -0,0 +1,32 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %target-swift-frontend %s %S/Inputs/multithread_shared_linkage/other.swift -emit-ir -o %t/main.ll -o %t/other.ll -num-threads 2 -O -module-name test
+// RUN: cat %t/main.ll %t/other.ll | FileCheck %s
+// RUN: FileCheck -check-prefix=MAIN %s < %t/main.ll
+// RUN: FileCheck -check-prefix=OTHER %s < %t/other.ll
+
+// The linkage of shared definitions is updated in the codegen threads. A
+// shared function that is referenced from another output file must become
+// weak, otherwise LLVM would drop it from the file that defines it.
+
+// Both files use the Int specialization, so whichever file defines it, the
+// other one references it.
+// CHECK-DAG: define weak_odr hidden {{.*}}@_TTSg5Si{{[_a-zA-Z0-9]*}}genericId
+// CHECK-DAG: declare {{.*}}@_TTSg5Si{{[_a-zA-Z0-9]*}}genericId
+
+// The Double specialization is only used here and stays linkonce.
+// MAIN: define linkonce_odr hidden {{.*}}@_TTSg5Sd{{[_a-zA-Z0-9]*}}localGeneric
+// OTHER-NOT: localGeneric
+
+@inline(never)
+func genericId<T>(x: T) -> T {
+  return x
+}
+
+@inline(never)
+func localGeneric<T>(x: T) -> T {
+  return x
+}
+
+public func useFromMain(x: Int, _ d: Double) -> Double {
+  return Double(genericId(x)) + localGeneric(d)
+}
@@ -0,0 +1,27 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-jit-run -immediate-cache-path %t/cache -Xllvm -debug-only=swift-immediate %s 2>&1 | FileCheck -check-prefix=CHECK-MISS %s
+// RUN: ls %t/cache | FileCheck -check-prefix=CHECK-ENTRY %s
+// RUN: %target-jit-run -immediate-cache-path %t/cache -Xllvm -debug-only=swift-immediate %s 2>&1 | FileCheck -check-prefix=CHECK-HIT %s
+// RUN: %target-jit-run -immediate-cache-path %t/cache -Xllvm -debug-only=swift-immediate %s -- a b 2>&1 | FileCheck -check-prefix=CHECK-ARGS %s
+// REQUIRES: executable_test
+// REQUIRES: swift_interpreter
+// REQUIRES: asserts
+
+// CHECK-MISS-NOT: Loading cached object code
+// CHECK-MISS: Module to be executed
+// CHECK-MISS: hello 1
+
+// CHECK-ENTRY: .manifest
+// CHECK-ENTRY: .o
+
+// CHECK-HIT-NOT: Module to be executed
+// CHECK-HIT: Loading cached object code
+// CHECK-HIT: hello 1
+
+// Arguments passed to the script don't affect its object code.
+// CHECK-ARGS-NOT: Module to be executed
+// CHECK-ARGS: Loading cached object code
+// CHECK-ARGS: hello 3
+
+print("hello \(Process.arguments.count)")
@@ -0,0 +1,31 @@
+// RUN: %target-jit-run -enable-jit-profiling %s | FileCheck %s
+// REQUIRES: executable_test
+// REQUIRES: swift_interpreter
+// REQUIRES: OS=linux-gnu
+
+import Glibc
+
+func profiledFunction() -> Int {
+  return 42
+}
+
+print(profiledFunction())
+// CHECK: 42
+
+// The map is written when the code is emitted, before anything runs.
+let path = "/tmp/perf-\(getpid()).map"
+let file = fopen(path, "r")
+var buffer = [CChar](count: 4096, repeatedValue: 0)
+var found = false
+while file != nil && fgets(&buffer, Int32(buffer.count), file) != nil {
+  if strstr(buffer, ".profiledFunction () -> Swift.Int") != nil {
+    found = true
+  }
+}
+if file != nil {
+  fclose(file)
+}
+unlink(path)
+
+print(found)
+// CHECK: true
@@ -0,0 +1,25 @@
+// RUN: %target-swift-frontend -parse -debug-time-expression-type-checking %s 2>&1 | FileCheck %s
+// RUN: %target-swift-frontend -parse -warn-long-expression-type-checking=0 %s 2>&1 | FileCheck -check-prefix=WARN %s
+// RUN: %target-swift-frontend -parse -warn-long-expression-type-checking=100000 %s 2>&1 | FileCheck -check-prefix=NO-WARN -allow-empty %s
+
+// CHECK-DAG: {{[0-9]+}}.{{[0-9]}}ms {{.*}}debug_time_expression_type_checking.swift:11:{{[0-9]+}} {{[0-9]+}} states {{[0-9]+}} disjunctions (expression)
+// CHECK-DAG: {{[0-9]+}}.{{[0-9]}}ms {{.*}}debug_time_expression_type_checking.swift:13:6 {{[0-9]+}} states {{[0-9]+}} disjunctions func foo(x: Int) -> Int
+// CHECK-DAG: {{[0-9]+}}.{{[0-9]}}ms {{.*}}debug_time_expression_type_checking.swift:14:{{[0-9]+}} {{[0-9]+}} states {{[0-9]+}} disjunctions (expression)
+// CHECK-DAG: {{[0-9]+}}.{{[0-9]}}ms {{.*}}debug_time_expression_type_checking.swift:17:{{[0-9]+}} {{[0-9]+}} states {{[0-9]+}} disjunctions (closure)
+
+// WARN-DAG: debug_time_expression_type_checking.swift:11:{{[0-9]+}}: warning: expression took {{[0-9]+}}ms to type-check (limit: 0ms)
+// WARN-DAG: debug_time_expression_type_checking.swift:14:{{[0-9]+}}: warning: expression took {{[0-9]+}}ms to type-check (limit: 0ms)
+// WARN-DAG: debug_time_expression_type_checking.swift:17:{{[0-9]+}}: warning: expression took {{[0-9]+}}ms to type-check (limit: 0ms)
+
+// NO-WARN-NOT: expression took
+
+let a = 1 + 2 * 3 - 4
+
+func foo(x: Int) -> Int {
+  return x * 2 + 1
+}
+
+let b = [1, 2, 3].map { x -> Int in
+  let y = x + 1
+  return y * 2
+}
@@ -0,0 +1,28 @@
+public struct ManyMembers {
+  public init() {}
+
+  public var first: Int { return 1 }
+  public var second: Int { return 2 }
+  public func compute() -> Int { return first + second }
+  public func compute(scale scale: Int) -> Int { return compute() * scale }
+  public static func make() -> ManyMembers { return ManyMembers() }
+  public subscript(i: Int) -> Int { return i }
+}
+
+extension ManyMembers {
+  public func extended() -> Int { return second }
+}
+
+public class Base {
+  public init() {}
+  public func overridden() -> Int { return 0 }
+  public func unused() {}
+}
+
+public struct OnlyFuncs {
+  public init() {}
+  public func used() {}
+  public func unused1() {}
+  public func unused2() {}
+  public func unused3() {}
+}
@@ -0,0 +1,5 @@
+import def_named_members
+
+func useOnlyFuncs() {
+  OnlyFuncs().used()
+}
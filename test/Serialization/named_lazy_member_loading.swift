@@ -0,0 +1,36 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_named_members.swift
+// RUN: llvm-bcanalyzer %t/def_named_members.swiftmodule | FileCheck -check-prefix=CHECK-MODULE %s
+// RUN: %target-swift-frontend -parse -I %t %s
+// RUN: %target-swift-frontend -emit-silgen -I %t %s -enable-named-lazy-member-loading -o /dev/null
+// RUN: %target-swift-frontend -parse -I %t %s -enable-named-lazy-member-loading -print-stats 2>&1 | FileCheck -check-prefix=CHECK-STATS %s
+// RUN: %target-swift-frontend -parse -parse-as-library -I %t %S/Inputs/use_only_funcs.swift -enable-named-lazy-member-loading -print-stats 2>&1 | FileCheck -check-prefix=CHECK-ONLY-FUNCS %s
+
+// REQUIRES: asserts
+
+// CHECK-MODULE-NOT: UnknownCode
+// CHECK-MODULE: DECL_MEMBER_NAMES
+
+// CHECK-STATS: Statistics Collected
+// CHECK-STATS-DAG: members deserialized by name lookup
+// CHECK-STATS-DAG: member lookups that didn't load all members
+
+// Only 'init' and 'used' of the five members of OnlyFuncs are looked up, so
+// the other three stay on disk, and no lookup has to load all members.
+// CHECK-ONLY-FUNCS: Statistics Collected
+// CHECK-ONLY-FUNCS-NOT: member lookups that loaded all members
+// CHECK-ONLY-FUNCS-DAG: {{^ *}}2 Serialization - # of members deserialized by name lookup
+// CHECK-ONLY-FUNCS-DAG: {{^ *}}3 Serialization - # of members of types searched by name that were never deserialized
+// CHECK-ONLY-FUNCS-NOT: member lookups that loaded all members
+
+import def_named_members
+
+let m = ManyMembers.make()
+let a = m.compute(scale: m.first)
+let b = m.extended()
+let c = m[a]
+
+class Derived : Base {
+  override func overridden() -> Int { return b + c }
+}
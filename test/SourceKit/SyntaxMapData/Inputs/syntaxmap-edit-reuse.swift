@@ -0,0 +1,12 @@
+func before() {
+  let x = 1 +
+}
+
+func edited() {
+  var value = 0
+  value += 1
+}
+
+func after() {
+  let y = 2 *
+}
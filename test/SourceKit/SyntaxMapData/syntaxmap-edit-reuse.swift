@@ -0,0 +1,26 @@
+// RUN: %sourcekitd-test -req=syntax-map -pos=7:1 -length=13 -replace="" %S/Inputs/syntaxmap-edit-reuse.swift | FileCheck %s
+
+// The edit removes a line from the body of 'edited'. The bodies of 'before'
+// and 'after' are not changed by it, so they are not parsed again. Their
+// diagnostics must still be reported, the one in 'after' on its new line.
+
+// CHECK: key.diagnostics: [
+// CHECK-NEXT: {
+// CHECK-NEXT: key.line: 3,
+// CHECK-NEXT: key.column: 1,
+// CHECK: key.description: "expected expression after operator"
+// CHECK: key.line: 12,
+// CHECK-NEXT: key.column: 1,
+// CHECK: key.description: "expected expression after operator"
+// CHECK-NOT: key.description
+
+// CHECK: key.syntaxmap
+// CHECK: key.diagnostics: [
+// CHECK-NEXT: {
+// CHECK-NEXT: key.line: 3,
+// CHECK-NEXT: key.column: 1,
+// CHECK: key.description: "expected expression after operator"
+// CHECK: key.line: 11,
+// CHECK-NEXT: key.column: 1,
+// CHECK: key.description: "expected expression after operator"
+// CHECK-NOT: key.description
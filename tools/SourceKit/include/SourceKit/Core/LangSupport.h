@@ -198,6 +198,8 @@ public:
 
   virtual bool needsSemanticInfo() { return true; }
 
+  virtual bool needsDocumentStructure() { return true; }
+
   virtual void handleRequestError(const char *Description) = 0;
 
   virtual bool handleSyntaxMap(unsigned Offset, unsigned Length,
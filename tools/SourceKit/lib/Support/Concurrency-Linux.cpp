@@ -0,0 +1,390 @@
+//===--- Concurrency-Linux.cpp --------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// A pthread-based implementation of WorkQueue, for platforms without
+// libdispatch.
+//
+// Every queue keeps its own FIFO of work items. An item becomes runnable once
+// its queue allows it to start: on a serial queue when nothing else from the
+// queue is running, on a concurrent queue when no barrier is running, and for
+// a barrier when nothing else from the queue is running. Runnable items are
+// handed to a shared pool of worker threads, highest priority first. The pool
+// grows when all workers are busy, up to a limit, so that work items blocking
+// on each other don't stall it, and idle workers exit after a while.
+//
+// Synchronous items are run on the calling thread once they are allowed to
+// start, like dispatch_sync does.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceKit/Support/Concurrency.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Threading.h"
+
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+using namespace SourceKit;
+
+namespace {
+
+struct QueueImpl;
+
+/// Lets a synchronous dispatch wait until its item is allowed to start.
+struct SyncWaiter {
+  std::condition_variable CanStart;
+  bool Started = false;
+};
+
+struct WorkItem {
+  WorkQueue::DispatchFn Fn;
+  void *Context;
+  bool IsStackDeep;
+  bool IsBarrier;
+  /// The queue the item was dispatched to, or null for items dispatched
+  /// straight to the pool with \c dispatchConcurrent.
+  QueueImpl *Queue;
+  /// Non-null for synchronous items, which are never handed to the pool.
+  SyncWaiter *Waiter;
+};
+
+struct QueueImpl {
+  std::atomic<unsigned> RefCount{1};
+  const std::string Label;
+  const WorkQueue::Dequeuing DeqKind;
+
+  // Everything below is guarded by the scheduler lock.
+  WorkQueue::Priority Prio;
+  unsigned SuspendCount = 0;
+  /// Items that haven't started yet, in dispatch order.
+  std::deque<WorkItem> Pending;
+  /// The number of started items that haven't finished yet.
+  unsigned NumRunning = 0;
+  bool BarrierRunning = false;
+
+  QueueImpl(WorkQueue::Dequeuing DeqKind, WorkQueue::Priority Prio,
+            llvm::StringRef Label)
+    : Label(Label), DeqKind(DeqKind), Prio(Prio) {}
+
+  void retain() { ++RefCount; }
+  void release() {
+    if (--RefCount == 0)
+      delete this;
+  }
+};
+
+static const unsigned NumPriorities = 4;
+
+static unsigned getPriorityIndex(WorkQueue::Priority Prio) {
+  switch (Prio) {
+  case WorkQueue::Priority::High: return 0;
+  case WorkQueue::Priority::Default: return 1;
+  case WorkQueue::Priority::Low: return 2;
+  case WorkQueue::Priority::Background: return 3;
+  }
+  llvm_unreachable("Invalid priority");
+}
+
+class Scheduler {
+  std::mutex Mtx;
+  std::condition_variable HasWork;
+  /// Runnable items, one FIFO per priority.
+  std::deque<WorkItem> Runnable[NumPriorities];
+  unsigned NumRunnable = 0;
+  unsigned NumWorkers = 0;
+  unsigned NumIdleWorkers = 0;
+
+  /// How long a worker waits for new work before exiting.
+  static constexpr std::chrono::seconds IdleTimeout{30};
+  /// The pool never grows beyond this many threads, like libdispatch's
+  /// thread limit.
+  static const unsigned MaxWorkers = 64;
+  /// Worker threads get a small stack, like libdispatch's. Work items which
+  /// need more have to be dispatched with isStackDeep.
+  static const size_t WorkerStackSize = 512 << 10; // 512 KB.
+
+  static void *workerMain(void *Arg);
+  void runWorker();
+  void spawnWorker();
+  void makeRunnable(const WorkItem &Item, WorkQueue::Priority Prio);
+  void startReadyItems(QueueImpl *Q);
+  void finished(QueueImpl *Q, bool IsBarrier);
+
+public:
+  void enqueue(QueueImpl *Q, WorkItem Item);
+  void enqueueConcurrent(WorkQueue::Priority Prio, WorkItem Item);
+  void runSync(QueueImpl *Q, WorkItem Item);
+  void suspend(QueueImpl *Q);
+  void resume(QueueImpl *Q);
+  void setPriority(QueueImpl *Q, WorkQueue::Priority Prio);
+};
+
+} // end anonymous namespace
+
+constexpr std::chrono::seconds Scheduler::IdleTimeout;
+
+static Scheduler &getScheduler() {
+  // Leaked on purpose, so that worker threads never see it destroyed.
+  static Scheduler *TheScheduler = new Scheduler();
+  return *TheScheduler;
+}
+
+namespace {
+struct ExecuteOnLargeStackInfo {
+  WorkQueue::DispatchFn Fn;
+  void *Context;
+};
+}
+
+static void executeOnLargeStack(void *Data) {
+  auto ExecuteInfo = (ExecuteOnLargeStackInfo*)Data;
+  ExecuteInfo->Fn(ExecuteInfo->Context);
+}
+
+static void execute(const WorkItem &Item) {
+  if (!Item.IsStackDeep) {
+    Item.Fn(Item.Context);
+    return;
+  }
+  static const size_t ThreadStackSize = 8 << 20; // 8 MB.
+  ExecuteOnLargeStackInfo ExecuteInfo{ Item.Fn, Item.Context };
+  llvm::llvm_execute_on_thread(executeOnLargeStack, &ExecuteInfo,
+                               ThreadStackSize);
+}
+
+void *Scheduler::workerMain(void *Arg) {
+  static_cast<Scheduler *>(Arg)->runWorker();
+  return nullptr;
+}
+
+void Scheduler::spawnWorker() {
+  pthread_attr_t Attr;
+  pthread_attr_init(&Attr);
+  pthread_attr_setdetachstate(&Attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setstacksize(&Attr, WorkerStackSize);
+  pthread_t Thread;
+  int Err = pthread_create(&Thread, &Attr, workerMain, this);
+  pthread_attr_destroy(&Attr);
+  if (Err != 0)
+    llvm::report_fatal_error("failed to create a WorkQueue worker thread");
+  ++NumWorkers;
+}
+
+void Scheduler::runWorker() {
+  std::unique_lock<std::mutex> Lock(Mtx);
+  while (true) {
+    if (NumRunnable == 0) {
+      ++NumIdleWorkers;
+      bool GotWork = HasWork.wait_for(Lock, IdleTimeout,
+                                      [&]{ return NumRunnable != 0; });
+      --NumIdleWorkers;
+      if (!GotWork) {
+        --NumWorkers;
+        return;
+      }
+    }
+
+    WorkItem Item;
+    for (auto &Items : Runnable) {
+      if (!Items.empty()) {
+        Item = Items.front();
+        Items.pop_front();
+        break;
+      }
+    }
+    --NumRunnable;
+
+    Lock.unlock();
+    execute(Item);
+    Lock.lock();
+
+    if (Item.Queue) {
+      finished(Item.Queue, Item.IsBarrier);
+      Item.Queue->release();
+    }
+  }
+}
+
+void Scheduler::makeRunnable(const WorkItem &Item, WorkQueue::Priority Prio) {
+  Runnable[getPriorityIndex(Prio)].push_back(Item);
+  ++NumRunnable;
+  if (NumIdleWorkers != 0)
+    HasWork.notify_one();
+  // Only start a new thread if the idle ones can't take all the runnable
+  // items. Blocked workers don't count as idle, so the pool keeps making
+  // progress when work items wait on each other.
+  if (NumIdleWorkers < NumRunnable && NumWorkers < MaxWorkers)
+    spawnWorker();
+}
+
+/// Starts as many pending items of \p Q as its dequeuing kind allows.
+void Scheduler::startReadyItems(QueueImpl *Q) {
+  while (!Q->Pending.empty() && Q->SuspendCount == 0 && !Q->BarrierRunning) {
+    WorkItem &Next = Q->Pending.front();
+    bool Exclusive = Next.IsBarrier ||
+                     Q->DeqKind == WorkQueue::Dequeuing::Serial;
+    if (Exclusive && Q->NumRunning != 0)
+      return;
+
+    ++Q->NumRunning;
+    if (Next.IsBarrier)
+      Q->BarrierRunning = true;
+    if (Next.Waiter) {
+      Next.Waiter->Started = true;
+      Next.Waiter->CanStart.notify_one();
+    } else {
+      makeRunnable(Next, Q->Prio);
+    }
+    Q->Pending.pop_front();
+  }
+}
+
+void Scheduler::finished(QueueImpl *Q, bool IsBarrier) {
+  assert(Q->NumRunning != 0);
+  --Q->NumRunning;
+  if (IsBarrier)
+    Q->BarrierRunning = false;
+  startReadyItems(Q);
+}
+
+void Scheduler::enqueue(QueueImpl *Q, WorkItem Item) {
+  // Running items keep their queue alive.
+  Q->retain();
+  Item.Queue = Q;
+  std::lock_guard<std::mutex> Lock(Mtx);
+  Q->Pending.push_back(Item);
+  startReadyItems(Q);
+}
+
+void Scheduler::enqueueConcurrent(WorkQueue::Priority Prio, WorkItem Item) {
+  Item.Queue = nullptr;
+  std::lock_guard<std::mutex> Lock(Mtx);
+  makeRunnable(Item, Prio);
+}
+
+void Scheduler::runSync(QueueImpl *Q, WorkItem Item) {
+  SyncWaiter Waiter;
+  Item.Queue = Q;
+  Item.Waiter = &Waiter;
+  {
+    std::unique_lock<std::mutex> Lock(Mtx);
+    Q->Pending.push_back(Item);
+    startReadyItems(Q);
+    Waiter.CanStart.wait(Lock, [&]{ return Waiter.Started; });
+  }
+
+  execute(Item);
+
+  std::lock_guard<std::mutex> Lock(Mtx);
+  finished(Q, Item.IsBarrier);
+}
+
+void Scheduler::suspend(QueueImpl *Q) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  ++Q->SuspendCount;
+}
+
+void Scheduler::resume(QueueImpl *Q) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  assert(Q->SuspendCount != 0 && "resuming a queue that isn't suspended");
+  if (--Q->SuspendCount == 0)
+    startReadyItems(Q);
+}
+
+void Scheduler::setPriority(QueueImpl *Q, WorkQueue::Priority Prio) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  Q->Prio = Prio;
+}
+
+static QueueImpl *getMainQueue() {
+  // There is no main run loop to hook into, so "main" work runs on a serial
+  // queue of its own.
+  static QueueImpl *MainQueue =
+      new QueueImpl(WorkQueue::Dequeuing::Serial, WorkQueue::Priority::High,
+                    "sourcekit.main");
+  return MainQueue;
+}
+
+static WorkItem toWorkItem(WorkQueue::DispatchFn Fn, void *Context,
+                           bool IsStackDeep, bool IsBarrier = false) {
+  return WorkItem{ Fn, Context, IsStackDeep, IsBarrier, nullptr, nullptr };
+}
+
+void *WorkQueue::Impl::create(Dequeuing DeqKind, Priority Prio,
+                              llvm::StringRef Label) {
+  return new QueueImpl(DeqKind, Prio, Label);
+}
+
+void WorkQueue::Impl::dispatch(Ty Obj, const DispatchData &Fn) {
+  getScheduler().enqueue(static_cast<QueueImpl *>(Obj),
+                         toWorkItem(Fn.getFunction(), Fn.getContext(),
+                                    Fn.isStackDeep()));
+}
+
+void WorkQueue::Impl::dispatchSync(Ty Obj, const DispatchData &Fn) {
+  getScheduler().runSync(static_cast<QueueImpl *>(Obj),
+                         toWorkItem(Fn.getFunction(), Fn.getContext(),
+                                    Fn.isStackDeep()));
+}
+
+void WorkQueue::Impl::dispatchBarrier(Ty Obj, const DispatchData &Fn) {
+  getScheduler().enqueue(static_cast<QueueImpl *>(Obj),
+                         toWorkItem(Fn.getFunction(), Fn.getContext(),
+                                    Fn.isStackDeep(), /*IsBarrier=*/true));
+}
+
+void WorkQueue::Impl::dispatchBarrierSync(Ty Obj, const DispatchData &Fn) {
+  getScheduler().runSync(static_cast<QueueImpl *>(Obj),
+                         toWorkItem(Fn.getFunction(), Fn.getContext(),
+                                    Fn.isStackDeep(), /*IsBarrier=*/true));
+}
+
+void WorkQueue::Impl::dispatchOnMain(const DispatchData &Fn) {
+  getScheduler().enqueue(getMainQueue(),
+                         toWorkItem(Fn.getFunction(), Fn.getContext(),
+                                    Fn.isStackDeep()));
+}
+
+void WorkQueue::Impl::dispatchConcurrent(Priority Prio, const DispatchData &Fn) {
+  getScheduler().enqueueConcurrent(Prio,
+                                   toWorkItem(Fn.getFunction(), Fn.getContext(),
+                                              Fn.isStackDeep()));
+}
+
+void WorkQueue::Impl::suspend(Ty Obj) {
+  getScheduler().suspend(static_cast<QueueImpl *>(Obj));
+}
+
+void WorkQueue::Impl::resume(Ty Obj) {
+  getScheduler().resume(static_cast<QueueImpl *>(Obj));
+}
+
+void WorkQueue::Impl::setPriority(Ty Obj, Priority Prio) {
+  getScheduler().setPriority(static_cast<QueueImpl *>(Obj), Prio);
+}
+
+llvm::StringRef WorkQueue::Impl::getLabel(const Ty Obj) {
+  return static_cast<const QueueImpl *>(Obj)->Label;
+}
+
+void WorkQueue::Impl::retain(Ty Obj) {
+  static_cast<QueueImpl *>(Obj)->retain();
+}
+
+void WorkQueue::Impl::release(Ty Obj) {
+  static_cast<QueueImpl *>(Obj)->release();
+}
@@ -32,6 +32,8 @@
 #include "swift/IDE/CommentConversion.h"
 #include "swift/IDE/SyntaxModel.h"
 #include "swift/IDE/SourceEntityWalker.h"
+#include "swift/Parse/DelayedParsingCallbacks.h"
+#include "swift/Parse/PersistentParserState.h"
 #include "swift/Subsystems.h"
 
 #include "llvm/Support/MemoryBuffer.h"
@@ -490,6 +492,114 @@ private:
       ArrayRef<DiagnosticEntryInfo> ParserDiags);
 };
 
+/// The byte range of a function body in a parse of an editor document.
+struct FunctionBodyRange {
+  unsigned Start;
+  unsigned End;
+
+  /// Whether parsing the body only produced diagnostics inside of it, so that
+  /// the body and its diagnostics can be carried over to the next parse.
+  bool Reusable;
+};
+
+/// Parses the function bodies the parser has delayed, except for the ones
+/// whose byte range is in \c ReusableRanges. Those are left unparsed. The
+/// range of every body is recorded in \c Bodies, in source order.
+class ParseDelayedBodies : public ASTWalker {
+  PersistentParserState &ParserState;
+  SourceManager &SM;
+  unsigned BufferID;
+  const EditorDiagConsumer &DiagConsumer;
+  ArrayRef<std::pair<unsigned, unsigned>> ReusableRanges;
+  std::vector<FunctionBodyRange> &Bodies;
+
+public:
+  ParseDelayedBodies(PersistentParserState &ParserState, SourceManager &SM,
+                     unsigned BufferID, const EditorDiagConsumer &DiagConsumer,
+                     ArrayRef<std::pair<unsigned, unsigned>> ReusableRanges,
+                     std::vector<FunctionBodyRange> &Bodies)
+    : ParserState(ParserState), SM(SM), BufferID(BufferID),
+      DiagConsumer(DiagConsumer), ReusableRanges(ReusableRanges),
+      Bodies(Bodies) {}
+
+  bool walkToDeclPre(Decl *D) override {
+    auto AFD = dyn_cast<AbstractFunctionDecl>(D);
+    if (!AFD)
+      return true;
+    if (AFD->getBodyKind() != AbstractFunctionDecl::BodyKind::Unparsed)
+      return false;
+
+    SourceRange BodyRange = AFD->getBodySourceRange();
+    unsigned Start = SM.getLocOffsetInBuffer(BodyRange.Start, BufferID);
+    unsigned End = SM.getLocOffsetInBuffer(
+        Lexer::getLocForEndOfToken(SM, BodyRange.End), BufferID);
+    if (std::binary_search(ReusableRanges.begin(), ReusableRanges.end(),
+                           std::make_pair(Start, End))) {
+      Bodies.push_back({Start, End, /*Reusable=*/true});
+      return false;
+    }
+
+    size_t NumDiags = DiagConsumer.getDiagnosticsForBuffer(BufferID).size();
+
+    Parser TheParser(BufferID, *AFD->getDeclContext()->getParentSourceFile(),
+                     nullptr, &ParserState);
+    auto FD = dyn_cast<FuncDecl>(AFD);
+    if (FD && FD->isAccessor())
+      TheParser.parseAccessorBodyDelayed(AFD);
+    else if (ParserState.hasFunctionBodyState(AFD))
+      TheParser.parseAbstractFunctionBodyDelayed(AFD);
+
+    auto BodyDiags =
+      DiagConsumer.getDiagnosticsForBuffer(BufferID).slice(NumDiags);
+    bool AllDiagsInBody = std::all_of(BodyDiags.begin(), BodyDiags.end(),
+                                      [&](const DiagnosticEntryInfo &Diag) {
+      return Diag.Offset >= Start && Diag.Offset < End;
+    });
+    Bodies.push_back({Start, End, AllDiagsInBody});
+    return false;
+  }
+};
+
+/// Returns true if \p Diag, its ranges, fix-its and notes are all inside of
+/// [\p Start, \p End).
+static bool isDiagnosticInRange(const DiagnosticEntryInfoBase &Diag,
+                                unsigned Start, unsigned End) {
+  auto InRange = [&](unsigned Offset, unsigned Length) {
+    return Offset >= Start && Offset + Length <= End;
+  };
+  if (!InRange(Diag.Offset, 0) || Diag.Offset == End)
+    return false;
+  for (auto &R : Diag.Ranges) {
+    if (!InRange(R.first, R.second))
+      return false;
+  }
+  for (auto &F : Diag.Fixits) {
+    if (!InRange(F.Offset, F.Length))
+      return false;
+  }
+  return true;
+}
+
+/// Moves \p Diag and everything it points at by \p Delta bytes.
+static void moveDiagnostic(DiagnosticEntryInfoBase &Diag, int Delta) {
+  Diag.Offset += Delta;
+  for (auto &R : Diag.Ranges)
+    R.first += Delta;
+  for (auto &F : Diag.Fixits)
+    F.Offset += Delta;
+}
+
+/// The function bodies of the previous parse of an editor document which an
+/// edit did not change, and their diagnostics, at their offsets after the
+/// edit.
+struct ReusableFunctionBodies {
+  /// The byte ranges of the bodies, in source order.
+  std::vector<std::pair<unsigned, unsigned>> Ranges;
+
+  /// The diagnostics inside of the bodies, with stale line and column.
+  std::vector<DiagnosticEntryInfo> Diagnostics;
+};
+
 class SwiftDocumentSyntaxInfo {
   SourceManager SM;
   EditorDiagConsumer DiagConsumer;
@@ -498,6 +608,20 @@ class SwiftDocumentSyntaxInfo {
   std::vector<std::string> Args;
   std::string PrimaryFile;
 
+  /// The function bodies in this parse, in source order.
+  std::vector<FunctionBodyRange> Bodies;
+
+  /// Function bodies which were not parsed, because they are the same as in
+  /// the previous parse of the document, as byte ranges.
+  std::vector<std::pair<unsigned, unsigned>> UnparsedRanges;
+
+  /// The diagnostics of the previous parse in \c UnparsedRanges.
+  std::vector<DiagnosticEntryInfo> ReusedDiagnostics;
+
+  /// Guards \c Bodies, \c UnparsedRanges, \c ReusedDiagnostics and the
+  /// diagnostics of parsing the bodies in \c UnparsedRanges on demand.
+  mutable llvm::sys::Mutex UnparsedMtx;
+
 public:
   SwiftDocumentSyntaxInfo(const CompilerInvocation &CompInv,
                           ImmutableTextSnapshotRef Snapshot,
@@ -527,8 +651,17 @@ public:
     Info.Args.Args = Args;
   }
 
-  void parse() {
+  /// Parses the document.
+  ///
+  /// The function bodies in \p Reuse are left unparsed, if the document still
+  /// has bodies with exactly these ranges. Their diagnostics are taken from
+  /// \p Reuse instead.
+  void parse(ReusableFunctionBodies Reuse = ReusableFunctionBodies()) {
     auto &P = Parser->getParser();
+    // Only parse the declarations at first, so that the function bodies can
+    // be matched against the reusable ones.
+    AlwaysDelayedCallbacks DelayedCallbacks;
+    P.setDelayedParsingCallbacks(&DelayedCallbacks);
 
     trace::TracedOperation TracedOp;
     if (trace::enabled()) {
@@ -536,7 +669,13 @@ public:
       initArgsAndPrimaryFile(Info);
       auto Text = SM.getLLVMSourceMgr().getMemoryBuffer(BufferID)->getBuffer();
       Info.Files.push_back(std::make_pair(PrimaryFile, Text));
-      TracedOp.start(trace::OperationKind::SimpleParse, Info);
+      trace::StringPairs OpArgs;
+      for (auto &Range : Reuse.Ranges) {
+        OpArgs.push_back(std::make_pair("ReusedBody",
+                                        std::to_string(Range.first) + "-" +
+                                        std::to_string(Range.second)));
+      }
+      TracedOp.start(trace::OperationKind::SimpleParse, Info, OpArgs);
     }
     
     bool Done = false;
@@ -544,6 +683,121 @@ public:
       P.parseTopLevel();
       Done = P.Tok.is(tok::eof);
     }
+
+    P.setDelayedParsingCallbacks(nullptr);
+
+    llvm::sys::ScopedLock L(UnparsedMtx);
+    ParseDelayedBodies Walker(*P.State, SM, BufferID, DiagConsumer,
+                              Reuse.Ranges, Bodies);
+    getSourceFile().walk(Walker);
+
+    for (auto &Body : Bodies) {
+      if (std::binary_search(Reuse.Ranges.begin(), Reuse.Ranges.end(),
+                             std::make_pair(Body.Start, Body.End)))
+        UnparsedRanges.push_back({Body.Start, Body.End});
+    }
+    if (UnparsedRanges.empty())
+      return;
+
+    for (auto &Diag : Reuse.Diagnostics) {
+      if (!isInUnparsedRange(Diag.Offset))
+        continue;
+      ReusedDiagnostics.push_back(std::move(Diag));
+      auto &Reused = ReusedDiagnostics.back();
+      updateLineAndColumn(Reused);
+      for (auto &Note : Reused.Notes)
+        updateLineAndColumn(Note);
+    }
+  }
+
+  /// Parses the function bodies which were left out by \c parse, for clients
+  /// which need the full AST.
+  void parseUnparsedBodies() {
+    llvm::sys::ScopedLock L(UnparsedMtx);
+    if (UnparsedRanges.empty())
+      return;
+
+    std::vector<FunctionBodyRange> Parsed;
+    ParseDelayedBodies Walker(*Parser->getParser().State, SM, BufferID,
+                              DiagConsumer, /*ReusableRanges=*/{}, Parsed);
+    getSourceFile().walk(Walker);
+    for (auto &Body : Parsed) {
+      auto It = std::lower_bound(Bodies.begin(), Bodies.end(), Body.Start,
+                                 [](const FunctionBodyRange &LHS,
+                                    unsigned Start) {
+        return LHS.Start < Start;
+      });
+      assert(It != Bodies.end() && It->Start == Body.Start);
+      *It = Body;
+    }
+    UnparsedRanges.clear();
+    // The bodies now have their own diagnostics.
+    ReusedDiagnostics.clear();
+  }
+
+  /// Returns the function bodies of this parse that are unchanged in
+  /// \p NewText, the text of the document after an edit, together with their
+  /// diagnostics.
+  ReusableFunctionBodies getReusableBodies(StringRef NewText) const {
+    StringRef OldText =
+      SM.getLLVMSourceMgr().getMemoryBuffer(BufferID)->getBuffer();
+
+    // The edit is somewhere between the common prefix and suffix of the old
+    // and new text.
+    size_t MaxCommon = std::min(OldText.size(), NewText.size());
+    size_t Prefix = 0;
+    while (Prefix < MaxCommon && OldText[Prefix] == NewText[Prefix])
+      ++Prefix;
+    size_t Suffix = 0;
+    while (Suffix < MaxCommon - Prefix &&
+           OldText[OldText.size() - Suffix - 1] ==
+             NewText[NewText.size() - Suffix - 1])
+      ++Suffix;
+    size_t SuffixStart = OldText.size() - Suffix;
+    int Delta = int(NewText.size()) - int(OldText.size());
+
+    std::vector<DiagnosticEntryInfo> Diags = getDiagnostics();
+    auto ByOffset = [](const DiagnosticEntryInfo &LHS, unsigned Offset) {
+      return LHS.Offset < Offset;
+    };
+
+    ReusableFunctionBodies Reuse;
+    llvm::sys::ScopedLock L(UnparsedMtx);
+    for (auto &Body : Bodies) {
+      if (!Body.Reusable)
+        continue;
+      int Shift;
+      if (Body.End <= Prefix)
+        Shift = 0;
+      else if (Body.Start >= SuffixStart)
+        Shift = Delta;
+      else
+        continue;
+
+      auto Begin = std::lower_bound(Diags.begin(), Diags.end(), Body.Start,
+                                    ByOffset);
+      auto End = std::lower_bound(Begin, Diags.end(), Body.End, ByOffset);
+      bool AllInBody = std::all_of(Begin, End,
+                                   [&](const DiagnosticEntryInfo &Diag) {
+        if (!isDiagnosticInRange(Diag, Body.Start, Body.End))
+          return false;
+        return std::all_of(Diag.Notes.begin(), Diag.Notes.end(),
+                           [&](const DiagnosticEntryInfoBase &Note) {
+          return isDiagnosticInRange(Note, Body.Start, Body.End);
+        });
+      });
+      if (!AllInBody)
+        continue;
+
+      Reuse.Ranges.push_back({Body.Start + Shift, Body.End + Shift});
+      for (auto It = Begin; It != End; ++It) {
+        Reuse.Diagnostics.push_back(*It);
+        moveDiagnostic(Reuse.Diagnostics.back(), Shift);
+        for (auto &Note : Reuse.Diagnostics.back().Notes)
+          moveDiagnostic(Note, Shift);
+      }
+    }
+    return Reuse;
   }
 
   SourceFile &getSourceFile() {
@@ -562,8 +816,52 @@ public:
     return SM;
   }
 
-  ArrayRef<DiagnosticEntryInfo> getDiagnostics() {
-    return DiagConsumer.getDiagnosticsForBuffer(BufferID);
+  std::vector<DiagnosticEntryInfo> getDiagnostics() const {
+    llvm::sys::ScopedLock L(UnparsedMtx);
+    std::vector<DiagnosticEntryInfo> Diags;
+    for (auto &Diag : DiagConsumer.getDiagnosticsForBuffer(BufferID)) {
+      // The lexer also reports errors in the function bodies it skips. The
+      // previous parse has them as well, among the reused diagnostics.
+      if (!isInUnparsedRange(Diag.Offset))
+        Diags.push_back(Diag);
+    }
+    Diags.insert(Diags.end(), ReusedDiagnostics.begin(),
+                 ReusedDiagnostics.end());
+    std::stable_sort(Diags.begin(), Diags.end(),
+                     [](const DiagnosticEntryInfo &LHS,
+                        const DiagnosticEntryInfo &RHS) {
+      return LHS.Offset < RHS.Offset;
+    });
+
+    // A lexer error in a delayed function body is reported when the body is
+    // skipped and again when it is parsed.
+    Diags.erase(std::unique(Diags.begin(), Diags.end(),
+                            [](const DiagnosticEntryInfo &LHS,
+                               const DiagnosticEntryInfo &RHS) {
+                  return LHS.Offset == RHS.Offset &&
+                         LHS.Description == RHS.Description;
+                }),
+                Diags.end());
+    return Diags;
+  }
+
+private:
+  bool isInUnparsedRange(unsigned Offset) const {
+    auto It = std::upper_bound(UnparsedRanges.begin(), UnparsedRanges.end(),
+                               Offset,
+                               [](unsigned Offset,
+                                  const std::pair<unsigned, unsigned> &Range) {
+      return Offset < Range.first;
+    });
+    if (It == UnparsedRanges.begin())
+      return false;
+    --It;
+    return Offset >= It->first && Offset < It->second;
+  }
+
+  void updateLineAndColumn(DiagnosticEntryInfoBase &Diag) {
+    SourceLoc Loc = SM.getLocForOffset(BufferID, Diag.Offset);
+    std::tie(Diag.Line, Diag.Column) = SM.getLineAndColumn(Loc, BufferID);
   }
 };
 
@@ -2443,7 +2741,8 @@ void SwiftEditorDocument::updateSemaInfo() {
 }
 
 void SwiftEditorDocument::parse(ImmutableTextSnapshotRef Snapshot,
-                                SwiftLangSupport &Lang) {
+                                SwiftLangSupport &Lang,
+                                bool ReuseUnaffectedBodies) {
   llvm::sys::ScopedLock L(Impl.AccessMtx);
 
   assert(Impl.SemanticInfo && "Impl.SemanticInfo must be set");
@@ -2463,11 +2762,18 @@ void SwiftEditorDocument::parse(ImmutableTextSnapshotRef Snapshot,
       initCompilerInvocation(CompInv, Args, StringRef(), Error);
   }
 
+  // Function bodies which the edit did not touch, before or after it, don't
+  // need to be parsed again.
+  ReusableFunctionBodies Reuse;
+  if (ReuseUnaffectedBodies && Impl.SyntaxInfo)
+    Reuse = Impl.SyntaxInfo->getReusableBodies(
+        Snapshot->getBuffer()->getText());
+
   // Access to Impl.SyntaxInfo is guarded by Impl.AccessMtx
   Impl.SyntaxInfo.reset(
     new SwiftDocumentSyntaxInfo(CompInv, Snapshot, Args, Impl.FilePath));
 
-  Impl.SyntaxInfo->parse();
+  Impl.SyntaxInfo->parse(std::move(Reuse));
 }
 
 void SwiftEditorDocument::readSyntaxInfo(EditorConsumer &Consumer) {
@@ -2561,6 +2867,7 @@ SwiftEditorDocument::CodeFormatOptions &SwiftEditorDocument::getFormatOptions()
 void SwiftEditorDocument::formatText(unsigned Line, unsigned Length,
                                      EditorConsumer &Consumer) {
   auto SyntaxInfo = Impl.getSyntaxInfo();
+  SyntaxInfo->parseUnparsedBodies();
   SourceFile &SF = SyntaxInfo->getSourceFile();
   SourceManager &SM = SyntaxInfo->getSourceManager();
   unsigned BufID = SyntaxInfo->getBufferID();
@@ -2597,6 +2904,7 @@ void SwiftEditorDocument::formatText(unsigned Line, unsigned Length,
 void SwiftEditorDocument::expandPlaceholder(unsigned Offset, unsigned Length,
                                             EditorConsumer &Consumer) {
   auto SyntaxInfo = Impl.getSyntaxInfo();
+  SyntaxInfo->parseUnparsedBodies();
   SourceManager &SM = SyntaxInfo->getSourceManager();
   unsigned BufID = SyntaxInfo->getBufferID();
 
@@ -2871,7 +3179,11 @@ void SwiftLangSupport::editorReplaceText(StringRef Name, llvm::MemoryBuffer *Buf
     Snapshot = EditorDoc->replaceText(Offset, Length, Buf,
                                       Consumer.needsSemanticInfo());
     assert(Snapshot);
-    EditorDoc->parse(Snapshot, *this);
+    // The document structure includes what is inside of function bodies, so
+    // only reuse them if it is not needed.
+    EditorDoc->parse(Snapshot, *this,
+                     /*ReuseUnaffectedBodies=*/
+                     !Consumer.needsDocumentStructure());
     EditorDoc->readSyntaxInfo(Consumer);
   } else {
     Snapshot = EditorDoc->getLatestSnapshot();
@@ -82,7 +82,11 @@ public:
 
   ImmutableTextSnapshotRef getLatestSnapshot() const;
 
-  void parse(ImmutableTextSnapshotRef Snapshot, SwiftLangSupport &Lang);
+  /// Parses \p Snapshot. If \p ReuseUnaffectedBodies is true, function
+  /// bodies before the last edit are not parsed again; the resulting AST then
+  /// only has what is needed for the syntax map of the edit.
+  void parse(ImmutableTextSnapshotRef Snapshot, SwiftLangSupport &Lang,
+             bool ReuseUnaffectedBodies = false);
   void readSyntaxInfo(EditorConsumer& consumer);
   void readSemanticInfo(ImmutableTextSnapshotRef Snapshot,
                         EditorConsumer& Consumer);
@@ -1438,6 +1438,7 @@ class SKEditorConsumer : public EditorConsumer {
   sourcekitd_response_t Error = nullptr;
 
   bool EnableSyntaxMap;
+  bool EnableStructure;
   bool EnableDiagnostics;
   bool SyntacticOnly;
 
@@ -1446,6 +1447,7 @@ public:
                    bool EnableStructure, bool EnableDiagnostics,
                    bool SyntacticOnly)
   : EnableSyntaxMap(EnableSyntaxMap),
+    EnableStructure(EnableStructure),
     EnableDiagnostics(EnableDiagnostics),
     SyntacticOnly(SyntacticOnly) {
 
@@ -1468,6 +1470,8 @@ public:
     return !SyntacticOnly && !isSemanticEditorDisabled();
   }
 
+  bool needsDocumentStructure() override { return EnableStructure; }
+
   void handleRequestError(const char *Description) override;
 
   bool handleSyntaxMap(unsigned Offset, unsigned Length, UIdent Kind) override;
@@ -27,6 +27,7 @@
 #include "swift/AST/TypeRefinementContext.h"
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/FileSystem.h"
+#include "swift/Basic/ReferenceDependencyFile.h"
 #include "swift/Basic/SourceManager.h"
 #include "swift/Frontend/DiagnosticVerifier.h"
 #include "swift/Frontend/Frontend.h"
@@ -52,7 +53,6 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
-#include "llvm/Support/YAMLParser.h"
 
 #include <memory>
 #include <unordered_set>
@@ -194,16 +194,22 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     return true;
   }
 
-  auto escape = [](Identifier name) -> std::string {
-    return llvm::yaml::escape(name.str());
-  };
+  std::unique_ptr<ReferenceDependencyWriter> writer;
+  if (opts.EmitBinaryReferenceDependencies)
+    writer.reset(new BinaryReferenceDependencyWriter(out));
+  else
+    writer.reset(new YAMLReferenceDependencyWriter(out));
 
-  out << "### Swift dependencies file v0 ###\n";
+  auto mangledName = [](const NominalTypeDecl *type) -> SmallString<32> {
+    SmallString<32> result;
+    mangleTypeAsContext(llvm::raw_svector_ostream(result), type);
+    return result;
+  };
 
   llvm::MapVector<const NominalTypeDecl *, bool> extendedNominals;
   llvm::SmallVector<const ExtensionDecl *, 8> extensionsWithJustMembers;
 
-  out << "provides-top-level:\n";
+  writer->beginSection(ReferenceDependencySection::ProvidesTopLevel);
   for (const Decl *D : SF->Decls) {
     switch (D->getKind()) {
     case DeclKind::Module:
@@ -242,7 +248,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     case DeclKind::InfixOperator:
     case DeclKind::PrefixOperator:
     case DeclKind::PostfixOperator:
-      out << "- \"" << escape(cast<OperatorDecl>(D)->getName()) << "\"\n";
+      writer->addName(cast<OperatorDecl>(D)->getName().str());
       break;
 
     case DeclKind::Enum:
@@ -256,7 +262,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           NTD->getFormalAccess() == Accessibility::Private) {
         break;
       }
-      out << "- \"" << escape(NTD->getName()) << "\"\n";
+      writer->addName(NTD->getName().str());
       extendedNominals[NTD] |= true;
       findNominals(extendedNominals, NTD->getMembers());
       break;
@@ -272,7 +278,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() == Accessibility::Private) {
         break;
       }
-      out << "- \"" << escape(VD->getName()) << "\"\n";
+      writer->addName(VD->getName().str());
       break;
     }
 
@@ -294,27 +300,20 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     }
   }
 
-  out << "provides-nominal:\n";
+  writer->beginSection(ReferenceDependencySection::ProvidesNominal);
   for (auto entry : extendedNominals) {
     if (!entry.second)
       continue;
-    out << "- \"";
-    mangleTypeAsContext(out, entry.first);
-    out << "\"\n";
+    writer->addName(mangledName(entry.first));
   }
 
-  out << "provides-member:\n";
-  for (auto entry : extendedNominals) {
-    out << "- [\"";
-    mangleTypeAsContext(out, entry.first);
-    out << "\", \"\"]\n";
-  }
+  writer->beginSection(ReferenceDependencySection::ProvidesMember);
+  for (auto entry : extendedNominals)
+    writer->addMember(mangledName(entry.first), "");
 
   // This is also part of "provides-member".
   for (auto *ED : extensionsWithJustMembers) {
-    SmallString<32> mangledName;
-    mangleTypeAsContext(llvm::raw_svector_ostream(mangledName),
-                        ED->getExtendedType()->getAnyNominal());
+    auto baseName = mangledName(ED->getExtendedType()->getAnyNominal());
 
     for (auto *member : ED->getMembers()) {
       auto *VD = dyn_cast<ValueDecl>(member);
@@ -322,8 +321,7 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
           VD->getFormalAccess() == Accessibility::Private) {
         continue;
       }
-      out << "- [\"" << mangledName.str() << "\", \""
-          << escape(VD->getName()) << "\"]\n";
+      writer->addMember(baseName, VD->getName().str());
     }
   }
 
@@ -331,36 +329,32 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
     // FIXME: This requires a traversal of the whole file to compute.
     // We should (a) see if there's a cheaper way to keep it up to date,
     // and/or (b) see if we can fast-path cases where there's no ObjC involved.
-    out << "provides-dynamic-lookup:\n";
+    writer->beginSection(ReferenceDependencySection::ProvidesDynamicLookup);
     class ValueDeclPrinter : public VisibleDeclConsumer {
     private:
-      raw_ostream &out;
-      std::string (*escape)(Identifier);
+      ReferenceDependencyWriter &writer;
     public:
-      ValueDeclPrinter(raw_ostream &out, decltype(escape) escape)
-        : out(out), escape(escape) {}
+      explicit ValueDeclPrinter(ReferenceDependencyWriter &writer)
+        : writer(writer) {}
 
       void foundDecl(ValueDecl *VD, DeclVisibilityKind Reason) override {
-        out << "- \"" << escape(VD->getName()) << "\"\n";
+        writer.addName(VD->getName().str());
       }
     };
-    ValueDeclPrinter printer(out, escape);
+    ValueDeclPrinter printer(*writer);
     SF->lookupClassMembers({}, printer);
   }
 
   ReferencedNameTracker *tracker = SF->getReferencedNameTracker();
 
   // FIXME: Sort these?
-  out << "depends-top-level:\n";
+  writer->beginSection(ReferenceDependencySection::DependsTopLevel);
   for (auto &entry : tracker->getTopLevelNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    writer->addName(entry.first.str(), entry.second);
   }
 
-  out << "depends-member:\n";
+  writer->beginSection(ReferenceDependencySection::DependsMember);
   auto &memberLookupTable = tracker->getUsedMembers();
   using TableEntryTy = std::pair<ReferencedNameTracker::MemberPair, bool>;
   std::vector<TableEntryTy> sortedMembers{
@@ -390,18 +384,14 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         entry.first.first->getFormalAccess() == Accessibility::Private)
       continue;
 
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "[\"";
-    mangleTypeAsContext(out, entry.first.first);
-    out << "\", \"";
+    StringRef memberName;
     if (!entry.first.second.empty())
-      out << escape(entry.first.second);
-    out << "\"]\n";
+      memberName = entry.first.second.str();
+    writer->addMember(mangledName(entry.first.first), memberName,
+                      entry.second);
   }
 
-  out << "depends-nominal:\n";
+  writer->beginSection(ReferenceDependencySection::DependsNominal);
   for (auto i = sortedMembers.begin(), e = sortedMembers.end(); i != e; ++i) {
     bool isCascading = i->second;
     while (i+1 != e && i[0].first.first == i[1].first.first) {
@@ -413,33 +403,25 @@ static bool emitReferenceDependencies(DiagnosticEngine &diags,
         i->first.first->getFormalAccess() == Accessibility::Private)
       continue;
 
-    out << "- ";
-    if (!isCascading)
-      out << "!private ";
-    out << "\"";
-    mangleTypeAsContext(out, i->first.first);
-    out << "\"\n";
+    writer->addName(mangledName(i->first.first), isCascading);
   }
 
   // FIXME: Sort these?
-  out << "depends-dynamic-lookup:\n";
+  writer->beginSection(ReferenceDependencySection::DependsDynamicLookup);
   for (auto &entry : tracker->getDynamicLookupNames()) {
     assert(!entry.first.empty());
-    out << "- ";
-    if (!entry.second)
-      out << "!private ";
-    out << "\"" << escape(entry.first) << "\"\n";
+    writer->addName(entry.first.str(), entry.second);
   }
 
-  out << "depends-external:\n";
-  for (auto &entry : depTracker.getDependencies()) {
-    out << "- \"" << llvm::yaml::escape(entry) << "\"\n";
-  }
+  writer->beginSection(ReferenceDependencySection::DependsExternal);
+  for (auto &entry : depTracker.getDependencies())
+    writer->addName(entry);
 
   llvm::SmallString<32> interfaceHash;
   SF->getInterfaceHash(interfaceHash);
-  out << "interface-hash: \"" << interfaceHash << "\"\n";
+  writer->setInterfaceHash(interfaceHash);
 
+  writer->finish();
   return false;
 }
 
@@ -609,139 +591,24 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
-/// Performs the compile requested by the user.
+/// Performs the steps of the compile that run after semantic analysis,
+/// producing the outputs named in \p opts for \p PrimarySourceFile, or for
+/// the whole module if there is no primary file.
+///
+/// In immediate mode, a non-empty \p ImmediateCacheKey names the cache entry
+/// the script's object code is stored under.
 /// \returns true on error
-static bool performCompile(CompilerInstance &Instance,
-                           CompilerInvocation &Invocation,
-                           ArrayRef<const char *> Args,
-                           int &ReturnValue) {
-  FrontendOptions opts = Invocation.getFrontendOptions();
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        const FrontendOptions &opts,
+                                        IRGenOptions &IRGenOpts,
+                                        SourceFile *PrimarySourceFile,
+                                        bool moduleIsPublic,
+                                        StringRef ImmediateCacheKey,
+                                        int &ReturnValue) {
   FrontendOptions::ActionType Action = opts.RequestedAction;
-
-  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
-
-  bool inputIsLLVMIr = Invocation.getInputKind() == InputFileKind::IFK_LLVM_IR;
-  if (inputIsLLVMIr) {
-    auto &LLVMContext = llvm::getGlobalContext();
-
-    // Load in bitcode file.
-    assert(Invocation.getInputFilenames().size() == 1 &&
-           "We expect a single input for bitcode input!");
-    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> FileBufOrErr =
-      llvm::MemoryBuffer::getFileOrSTDIN(Invocation.getInputFilenames()[0]);
-    if (!FileBufOrErr) {
-      Instance.getASTContext().Diags.diagnose(SourceLoc(),
-                                              diag::error_open_input_file,
-                                              Invocation.getInputFilenames()[0],
-                                              FileBufOrErr.getError().message());
-      return true;
-    }
-    llvm::MemoryBuffer *MainFile = FileBufOrErr.get().get();
-
-    llvm::SMDiagnostic Err;
-    std::unique_ptr<llvm::Module> Module = llvm::parseIR(
-                                             MainFile->getMemBufferRef(),
-                                             Err, LLVMContext);
-    if (!Module) {
-      // TODO: Translate from the diagnostic info to the SourceManager location
-      // if available.
-      Instance.getASTContext().Diags.diagnose(SourceLoc(),
-                                              diag::error_parse_input_file,
-                                              Invocation.getInputFilenames()[0],
-                                              Err.getMessage());
-      return true;
-    }
-
-    // TODO: remove once the frontend understands what action it should perform
-    IRGenOpts.OutputKind = getOutputKind(Action);
-
-    return performLLVM(IRGenOpts, Instance.getASTContext(), Module.get());
-  }
-
-  ReferencedNameTracker nameTracker;
-  bool shouldTrackReferences = !opts.ReferenceDependenciesFilePath.empty();
-  if (shouldTrackReferences)
-    Instance.setReferencedNameTracker(&nameTracker);
-
-  if (Action == FrontendOptions::DumpParse ||
-      Action == FrontendOptions::DumpInterfaceHash)
-    Instance.performParseOnly();
-  else
-    Instance.performSema();
-
-  FrontendOptions::DebugCrashMode CrashMode = opts.CrashMode;
-  if (CrashMode == FrontendOptions::DebugCrashMode::AssertAfterParse)
-    debugFailWithAssertion();
-  else if (CrashMode == FrontendOptions::DebugCrashMode::CrashAfterParse)
-    debugFailWithCrash();
-
   ASTContext &Context = Instance.getASTContext();
 
-  if (Action == FrontendOptions::REPL) {
-    runREPL(Instance, ProcessCmdLine(Args.begin(), Args.end()),
-            Invocation.getParseStdlib());
-    return false;
-  }
-
-  SourceFile *PrimarySourceFile = Instance.getPrimarySourceFile();
-
-  // We've been told to dump the AST (either after parsing or type-checking,
-  // which is already differentiated in CompilerInstance::performSema()),
-  // so dump or print the main source file and return.
-  if (Action == FrontendOptions::DumpParse ||
-      Action == FrontendOptions::DumpAST ||
-      Action == FrontendOptions::PrintAST ||
-      Action == FrontendOptions::DumpTypeRefinementContexts ||
-      Action == FrontendOptions::DumpInterfaceHash) {
-    SourceFile *SF = PrimarySourceFile;
-    if (!SF) {
-      SourceFileKind Kind = Invocation.getSourceFileKind();
-      SF = &Instance.getMainModule()->getMainSourceFile(Kind);
-    }
-    if (Action == FrontendOptions::PrintAST)
-      SF->print(llvm::outs(), PrintOptions::printEverything());
-    else if (Action == FrontendOptions::DumpTypeRefinementContexts)
-      SF->getTypeRefinementContext()->dump(llvm::errs(), Context.SourceMgr);
-    else if (Action == FrontendOptions::DumpInterfaceHash)
-      SF->dumpInterfaceHash(llvm::errs());
-    else
-      SF->dump();
-    return false;
-  }
-
-  // If we were asked to print Clang stats, do so.
-  if (opts.PrintClangStats && Context.getClangModuleLoader())
-    Context.getClangModuleLoader()->printStatistics();
-
-  if (!opts.DependenciesFilePath.empty())
-    (void)emitMakeDependencies(Context.Diags, *Instance.getDependencyTracker(),
-                               opts);
-
-  if (shouldTrackReferences)
-    emitReferenceDependencies(Context.Diags, Instance.getPrimarySourceFile(),
-                              *Instance.getDependencyTracker(), opts);
-
-  if (Context.hadError())
-    return true;
-
-  // FIXME: This is still a lousy approximation of whether the module file will
-  // be externally consumed.
-  bool moduleIsPublic =
-      !Instance.getMainModule()->hasEntryPoint() &&
-      opts.ImplicitObjCHeaderPath.empty() &&
-      !Context.LangOpts.EnableAppExtensionRestrictions;
-
-  // We've just been told to perform a parse, so we can return now.
-  if (Action == FrontendOptions::Parse) {
-    if (!opts.ObjCHeaderOutputPath.empty())
-      return printAsObjC(opts.ObjCHeaderOutputPath, Instance.getMainModule(),
-                         opts.ImplicitObjCHeaderPath, moduleIsPublic);
-    return false;
-  }
-
-  assert(Action >= FrontendOptions::EmitSILGen &&
-         "All actions not requiring SILGen must have been handled!");
-
   std::unique_ptr<SILModule> SM = Instance.takeSILModule();
   if (!SM) {
     if (opts.PrimaryInput.hasValue() && opts.PrimaryInput.getValue().isFilename()) {
@@ -904,7 +771,8 @@ static bool performCompile(CompilerInstance &Instance,
                                                    opts.ImmediateArgv.end());
     Instance.setSILModule(std::move(SM));
     ReturnValue =
-      RunImmediately(Instance, CmdLine, IRGenOpts, Invocation.getSILOptions());
+      RunImmediately(Instance, CmdLine, IRGenOpts, Invocation.getSILOptions(),
+                     ImmediateCacheKey);
     return false;
   }
 
@@ -922,6 +790,195 @@ static bool performCompile(CompilerInstance &Instance,
   return false;
 }
 
+/// Performs the compile requested by the user.
+/// \returns true on error
+static bool performCompile(CompilerInstance &Instance,
+                           CompilerInvocation &Invocation,
+                           ArrayRef<const char *> Args,
+                           int &ReturnValue) {
+  FrontendOptions opts = Invocation.getFrontendOptions();
+  FrontendOptions::ActionType Action = opts.RequestedAction;
+
+  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
+
+  bool inputIsLLVMIr = Invocation.getInputKind() == InputFileKind::IFK_LLVM_IR;
+  if (inputIsLLVMIr) {
+    auto &LLVMContext = llvm::getGlobalContext();
+
+    // Load in bitcode file.
+    assert(Invocation.getInputFilenames().size() == 1 &&
+           "We expect a single input for bitcode input!");
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> FileBufOrErr =
+      llvm::MemoryBuffer::getFileOrSTDIN(Invocation.getInputFilenames()[0]);
+    if (!FileBufOrErr) {
+      Instance.getASTContext().Diags.diagnose(SourceLoc(),
+                                              diag::error_open_input_file,
+                                              Invocation.getInputFilenames()[0],
+                                              FileBufOrErr.getError().message());
+      return true;
+    }
+    llvm::MemoryBuffer *MainFile = FileBufOrErr.get().get();
+
+    llvm::SMDiagnostic Err;
+    std::unique_ptr<llvm::Module> Module = llvm::parseIR(
+                                             MainFile->getMemBufferRef(),
+                                             Err, LLVMContext);
+    if (!Module) {
+      // TODO: Translate from the diagnostic info to the SourceManager location
+      // if available.
+      Instance.getASTContext().Diags.diagnose(SourceLoc(),
+                                              diag::error_parse_input_file,
+                                              Invocation.getInputFilenames()[0],
+                                              Err.getMessage());
+      return true;
+    }
+
+    // TODO: remove once the frontend understands what action it should perform
+    IRGenOpts.OutputKind = getOutputKind(Action);
+
+    return performLLVM(IRGenOpts, Instance.getASTContext(), Module.get());
+  }
+
+  ReferencedNameTracker nameTracker;
+  bool shouldTrackReferences = !opts.ReferenceDependenciesFilePath.empty();
+  for (const BatchPrimaryInput &input : opts.BatchPrimaryInputs)
+    shouldTrackReferences |= !input.ReferenceDependenciesFilePath.empty();
+  if (shouldTrackReferences)
+    Instance.setReferencedNameTracker(&nameTracker);
+
+  // Each batch primary file records the names it references separately.
+  std::vector<std::unique_ptr<ReferencedNameTracker>> batchNameTrackers;
+  if (shouldTrackReferences && !opts.BatchPrimaryInputs.empty()) {
+    SmallVector<ReferencedNameTracker *, 4> trackers;
+    for (unsigned i = 0, e = opts.BatchPrimaryInputs.size(); i != e; ++i) {
+      batchNameTrackers.emplace_back(new ReferencedNameTracker());
+      trackers.push_back(batchNameTrackers.back().get());
+    }
+    Instance.setBatchReferencedNameTrackers(trackers);
+  }
+
+  // A script whose object code is cached doesn't need to be compiled at all.
+  std::string ImmediateCacheKey;
+  if (Action == FrontendOptions::Immediate &&
+      !opts.ImmediateCachePath.empty()) {
+    ImmediateCacheKey = getImmediateCacheKey(Invocation, Args);
+    const ProcessCmdLine &CmdLine = ProcessCmdLine(opts.ImmediateArgv.begin(),
+                                                   opts.ImmediateArgv.end());
+    if (!ImmediateCacheKey.empty() &&
+        RunImmediatelyFromCache(Instance, ImmediateCacheKey, CmdLine,
+                                IRGenOpts, ReturnValue))
+      return false;
+  }
+
+  if (Action == FrontendOptions::DumpParse ||
+      Action == FrontendOptions::DumpInterfaceHash)
+    Instance.performParseOnly();
+  else
+    Instance.performSema();
+
+  FrontendOptions::DebugCrashMode CrashMode = opts.CrashMode;
+  if (CrashMode == FrontendOptions::DebugCrashMode::AssertAfterParse)
+    debugFailWithAssertion();
+  else if (CrashMode == FrontendOptions::DebugCrashMode::CrashAfterParse)
+    debugFailWithCrash();
+
+  ASTContext &Context = Instance.getASTContext();
+
+  if (Action == FrontendOptions::REPL) {
+    runREPL(Instance, ProcessCmdLine(Args.begin(), Args.end()),
+            Invocation.getParseStdlib());
+    return false;
+  }
+
+  SourceFile *PrimarySourceFile = Instance.getPrimarySourceFile();
+
+  // We've been told to dump the AST (either after parsing or type-checking,
+  // which is already differentiated in CompilerInstance::performSema()),
+  // so dump or print the main source file and return.
+  if (Action == FrontendOptions::DumpParse ||
+      Action == FrontendOptions::DumpAST ||
+      Action == FrontendOptions::PrintAST ||
+      Action == FrontendOptions::DumpTypeRefinementContexts ||
+      Action == FrontendOptions::DumpInterfaceHash) {
+    SourceFile *SF = PrimarySourceFile;
+    if (!SF) {
+      SourceFileKind Kind = Invocation.getSourceFileKind();
+      SF = &Instance.getMainModule()->getMainSourceFile(Kind);
+    }
+    if (Action == FrontendOptions::PrintAST)
+      SF->print(llvm::outs(), PrintOptions::printEverything());
+    else if (Action == FrontendOptions::DumpTypeRefinementContexts)
+      SF->getTypeRefinementContext()->dump(llvm::errs(), Context.SourceMgr);
+    else if (Action == FrontendOptions::DumpInterfaceHash)
+      SF->dumpInterfaceHash(llvm::errs());
+    else
+      SF->dump();
+    return false;
+  }
+
+  // If we were asked to print Clang stats, do so.
+  if (opts.PrintClangStats && Context.getClangModuleLoader())
+    Context.getClangModuleLoader()->printStatistics();
+
+  // In batch mode, each further primary file is compiled with a copy of the
+  // options that names its own outputs.
+  SmallVector<std::pair<FrontendOptions, SourceFile *>, 1> Primaries;
+  Primaries.push_back({ opts, PrimarySourceFile });
+  for (unsigned i = 0, e = opts.BatchPrimaryInputs.size(); i != e; ++i) {
+    Primaries.push_back({
+      opts.getOptionsForBatchPrimary(opts.BatchPrimaryInputs[i]),
+      Instance.getBatchPrimarySourceFiles()[i]
+    });
+  }
+
+  for (auto &Primary : Primaries) {
+    const FrontendOptions &PrimaryOpts = Primary.first;
+    if (!PrimaryOpts.DependenciesFilePath.empty())
+      (void)emitMakeDependencies(Context.Diags,
+                                 *Instance.getDependencyTracker(),
+                                 PrimaryOpts);
+
+    if (!PrimaryOpts.ReferenceDependenciesFilePath.empty())
+      emitReferenceDependencies(Context.Diags, Primary.second,
+                                *Instance.getDependencyTracker(), PrimaryOpts);
+  }
+
+  if (Context.hadError())
+    return true;
+
+  // FIXME: This is still a lousy approximation of whether the module file will
+  // be externally consumed.
+  bool moduleIsPublic =
+      !Instance.getMainModule()->hasEntryPoint() &&
+      opts.ImplicitObjCHeaderPath.empty() &&
+      !Context.LangOpts.EnableAppExtensionRestrictions;
+
+  // We've just been told to perform a parse, so we can return now.
+  if (Action == FrontendOptions::Parse) {
+    if (!opts.ObjCHeaderOutputPath.empty())
+      return printAsObjC(opts.ObjCHeaderOutputPath, Instance.getMainModule(),
+                         opts.ImplicitObjCHeaderPath, moduleIsPublic);
+    return false;
+  }
+
+  assert(Action >= FrontendOptions::EmitSILGen &&
+         "All actions not requiring SILGen must have been handled!");
+
+  // Per-file settings such as the private discriminator are added to the
+  // IRGen options, so each primary file starts from the original ones.
+  const IRGenOptions OriginalIRGenOpts = IRGenOpts;
+  for (unsigned i = 0, e = Primaries.size(); i != e; ++i) {
+    IRGenOptions BatchIRGenOpts = OriginalIRGenOpts;
+    if (performCompileStepsPostSema(Instance, Invocation, Primaries[i].first,
+                                    i == 0 ? IRGenOpts : BatchIRGenOpts,
+                                    Primaries[i].second, moduleIsPublic,
+                                    ImmediateCacheKey, ReturnValue))
+      return true;
+  }
+
+  return false;
+}
+
 /// Returns true if an error occurred.
 static bool dumpAPI(Module *Mod, StringRef OutDir) {
   using namespace llvm::sys;
@@ -1095,9 +1152,19 @@ int frontend_main(ArrayRef<const char *>Args,
   }
 
   DependencyTracker depTracker;
-  if (!Invocation.getFrontendOptions().DependenciesFilePath.empty() ||
-      !Invocation.getFrontendOptions().ReferenceDependenciesFilePath.empty()) {
-    Instance.setDependencyTracker(&depTracker);
+  {
+    const FrontendOptions &opts = Invocation.getFrontendOptions();
+    // The immediate mode cache records the files a script imported.
+    bool needsDependencyTracker =
+      !opts.DependenciesFilePath.empty() ||
+      !opts.ReferenceDependenciesFilePath.empty() ||
+      (opts.RequestedAction == FrontendOptions::Immediate &&
+       !opts.ImmediateCachePath.empty());
+    for (const BatchPrimaryInput &input : opts.BatchPrimaryInputs)
+      needsDependencyTracker |= !input.DependenciesFilePath.empty() ||
+                                !input.ReferenceDependenciesFilePath.empty();
+    if (needsDependencyTracker)
+      Instance.setDependencyTracker(&depTracker);
   }
 
   if (Instance.setup(Invocation)) {
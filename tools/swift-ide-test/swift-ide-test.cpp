@@ -225,6 +225,11 @@ static llvm::cl::opt<std::string>
                         llvm::cl::desc("Code completion cache path"),
                         llvm::cl::ZeroOrMore);
 
+static llvm::cl::opt<std::string>
+    CompletionCacheNamePrefix("completion-cache-name-prefix",
+                              llvm::cl::desc("Only read cached code completion "
+                                             "results with this name prefix"));
+
 static llvm::cl::list<std::string>
 ImportPaths("I", llvm::cl::desc("add a directory to the import search path"));
 
@@ -542,6 +547,8 @@ static int doCodeCompletion(const CompilerInvocation &InitInvok,
   }
   ide::CodeCompletionCache CompletionCache(OnDiskCache.get());
   ide::CodeCompletionContext CompletionContext(CompletionCache);
+  CompletionContext.CachedResultsNamePrefix =
+      options::CompletionCacheNamePrefix;
 
   // Create a CodeCompletionConsumer.
   std::unique_ptr<ide::CodeCompletionConsumer> Consumer(
@@ -953,12 +960,8 @@ static int doDumpAPI(const CompilerInvocation &InitInvok,
 
 static int doDumpImporterLookupTables(const CompilerInvocation &InitInvok,
                                       StringRef SourceFilename) {
-  if (options::ImportObjCHeader.empty()) {
-    llvm::errs() << "implicit header required\n";
-    llvm::cl::PrintHelpMessage();
-    return 1;
-  }
-
+  // Without an implicit header, only the tables of imported Clang modules
+  // are dumped.
   CompilerInvocation Invocation(InitInvok);
   Invocation.addInputFilename(SourceFilename);
 
@@ -2488,7 +2491,8 @@ int main(int argc, char *argv[]) {
     ide::PrintingCodeCompletionConsumer Consumer(
         llvm::outs(), options::CodeCompletionKeywords);
     for (StringRef filename : options::InputFilenames) {
-      auto resultsOpt = ide::OnDiskCodeCompletionCache::getFromFile(filename);
+      auto resultsOpt = ide::OnDiskCodeCompletionCache::getFromFile(
+          filename, options::CompletionCacheNamePrefix);
       if (!resultsOpt) {
         // FIXME: error?
         continue;
@@ -0,0 +1,91 @@
+#include "swift/Basic/Cache.h"
+#include "gtest/gtest.h"
+
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+
+using namespace swift;
+
+namespace {
+
+/// A value that counts how many instances are alive and reports its own
+/// cost.
+struct CountedValue : llvm::RefCountedBase<CountedValue> {
+  static int Alive;
+  size_t Cost;
+
+  explicit CountedValue(size_t Cost) : Cost(Cost) { ++Alive; }
+  ~CountedValue() { --Alive; }
+};
+
+int CountedValue::Alive = 0;
+
+typedef llvm::IntrusiveRefCntPtr<CountedValue> CountedValueRef;
+
+} // end anonymous namespace
+
+namespace swift {
+namespace sys {
+template <>
+struct CacheValueCostInfo<CountedValue> {
+  static size_t getCost(const CountedValue &V) { return V.Cost; }
+};
+} // end namespace sys
+} // end namespace swift
+
+TEST(Cache, HitsAndMisses) {
+  sys::Cache<int, int> C("swift.test.cache");
+  EXPECT_FALSE(C.get(1).hasValue());
+  C.set(1, 10);
+  EXPECT_EQ(10, C.get(1).getValue());
+  EXPECT_EQ(1u, C.getHitCount());
+  EXPECT_EQ(1u, C.getMissCount());
+}
+
+TEST(Cache, ReplaceAndRemove) {
+  {
+    sys::Cache<int, CountedValueRef> C("swift.test.cache");
+    C.set(1, new CountedValue(1));
+    C.set(1, new CountedValue(1));
+    EXPECT_EQ(1, CountedValue::Alive);
+
+    CountedValueRef Held = C.get(1).getValue();
+    EXPECT_TRUE(C.remove(1));
+    EXPECT_FALSE(C.get(1).hasValue());
+    EXPECT_EQ(1, CountedValue::Alive);
+    Held = nullptr;
+    EXPECT_EQ(0, CountedValue::Alive);
+
+    C.set(2, new CountedValue(1));
+  }
+  EXPECT_EQ(0, CountedValue::Alive);
+}
+
+// libcache treats the cost limit as a hint and evicts on its own schedule.
+#if !defined(__APPLE__)
+TEST(Cache, EvictsLeastRecentlyUsed) {
+  sys::Cache<int, CountedValueRef> C("swift.test.cache");
+  C.setCostLimit(100);
+  C.set(1, new CountedValue(40));
+  C.set(2, new CountedValue(40));
+  // Make 1 more recently used than 2.
+  EXPECT_TRUE(C.get(1).hasValue());
+  C.set(3, new CountedValue(40));
+
+  EXPECT_TRUE(C.get(1).hasValue());
+  EXPECT_FALSE(C.get(2).hasValue());
+  EXPECT_TRUE(C.get(3).hasValue());
+  EXPECT_EQ(2, CountedValue::Alive);
+
+  // Lowering the limit evicts right away.
+  C.setCostLimit(40);
+  EXPECT_FALSE(C.get(1).hasValue());
+  EXPECT_TRUE(C.get(3).hasValue());
+  EXPECT_EQ(1, CountedValue::Alive);
+
+  // A value that doesn't fit at all isn't kept.
+  C.set(4, new CountedValue(1000));
+  EXPECT_FALSE(C.get(4).hasValue());
+  EXPECT_TRUE(C.get(3).hasValue());
+  EXPECT_EQ(1, CountedValue::Alive);
+}
+#endif
@@ -0,0 +1,58 @@
+//===--- TaskQueueTest.cpp - Tests for TaskQueue scheduling ---------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/TaskQueue.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace swift;
+using namespace swift::sys;
+
+#if LLVM_ON_UNIX
+
+static const char *const ShellPath = "/bin/sh";
+static const char *const SucceedArgs[] = { "-c", "exit 0" };
+
+/// Adds a task per cost, using the task's index as its context, executes
+/// them, and returns the contexts in the order the tasks began.
+static std::vector<uintptr_t> getBeganOrder(TaskQueue &TQ,
+                                            ArrayRef<uint64_t> Costs) {
+  for (uintptr_t i = 0, e = Costs.size(); i != e; ++i)
+    TQ.addTask(ShellPath, SucceedArgs, llvm::None, (void *)i, Costs[i]);
+
+  std::vector<uintptr_t> Began;
+  bool Failed = TQ.execute([&](ProcessId Pid, void *Context) {
+    Began.push_back((uintptr_t)Context);
+  });
+  EXPECT_FALSE(Failed);
+  return Began;
+}
+
+TEST(TaskQueueTest, CostliestTasksBeginFirst) {
+  TaskQueue TQ(1);
+  std::vector<uintptr_t> Expected = { 1, 3, 2, 4, 0 };
+  EXPECT_EQ(Expected, getBeganOrder(TQ, { 1, 5, 3, 5, 2 }));
+}
+
+TEST(TaskQueueTest, TasksBeginInOrderWhenAllCanBegin) {
+  TaskQueue TQ(4);
+  std::vector<uintptr_t> Expected = { 0, 1, 2 };
+  EXPECT_EQ(Expected, getBeganOrder(TQ, { 1, 3, 2 }));
+}
+
+TEST(TaskQueueTest, TasksWithoutCostsBeginInOrder) {
+  TaskQueue TQ(2);
+  std::vector<uintptr_t> Expected = { 0, 1, 2, 3, 4 };
+  EXPECT_EQ(Expected, getBeganOrder(TQ, { 0, 0, 0, 0, 0 }));
+}
+
+#endif
@@ -1,5 +1,10 @@
 #include "swift/Driver/DependencyGraph.h"
+#include "swift/Basic/ReferenceDependencyFile.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <chrono>
 
 using namespace swift;
 using LoadResult = DependencyGraphImpl::LoadResult;
@@ -790,3 +795,216 @@ TEST(DependencyGraph, ChainedExternalPreMarked) {
   EXPECT_TRUE(graph.isMarked(0));
   EXPECT_FALSE(graph.isMarked(1));
 }
+
+/// Describes the contents of a synthetic dependencies file, which can be
+/// encoded in either format.
+struct DepsFile {
+  using Section = ReferenceDependencySection;
+
+  struct Entry {
+    Section section;
+    std::string name;
+    std::string member;
+    bool isCascading;
+  };
+  std::vector<Entry> entries;
+  std::string interfaceHash;
+
+  DepsFile &add(Section section, StringRef name, bool isCascading = true) {
+    entries.push_back({section, name.str(), "", isCascading});
+    return *this;
+  }
+  DepsFile &addMember(Section section, StringRef base, StringRef member,
+                      bool isCascading = true) {
+    entries.push_back({section, base.str(), member.str(), isCascading});
+    return *this;
+  }
+
+  std::string encode(bool binary) const {
+    std::string result;
+    llvm::raw_string_ostream out(result);
+    std::unique_ptr<ReferenceDependencyWriter> writer;
+    if (binary)
+      writer.reset(new BinaryReferenceDependencyWriter(out));
+    else
+      writer.reset(new YAMLReferenceDependencyWriter(out));
+
+    Optional<Section> currentSection;
+    for (const Entry &entry : entries) {
+      if (!currentSection || *currentSection != entry.section) {
+        writer->beginSection(entry.section);
+        currentSection = entry.section;
+      }
+      if (isMemberSection(entry.section))
+        writer->addMember(entry.name, entry.member, entry.isCascading);
+      else
+        writer->addName(entry.name, entry.isCascading);
+    }
+    if (!interfaceHash.empty())
+      writer->setInterfaceHash(interfaceHash);
+    writer->finish();
+    return out.str();
+  }
+};
+
+TEST(DependencyGraph, BinaryLoad) {
+  using Section = ReferenceDependencySection;
+  DependencyGraph<uintptr_t> graph;
+
+  DepsFile provider;
+  provider.add(Section::ProvidesTopLevel, "a")
+          .add(Section::ProvidesNominal, "b")
+          .addMember(Section::ProvidesMember, "b", "");
+  DepsFile user;
+  user.add(Section::DependsTopLevel, "a", /*isCascading=*/false)
+      .add(Section::DependsExternal, "/foo");
+  DepsFile memberUser;
+  memberUser.addMember(Section::DependsMember, "b", "");
+
+  std::string binary = provider.encode(/*binary=*/true);
+  EXPECT_TRUE(isBinaryReferenceDependencyFile(binary));
+  EXPECT_FALSE(isBinaryReferenceDependencyFile(provider.encode(false)));
+
+  EXPECT_EQ(graph.loadFromString(0, binary), LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(1, user.encode(true)), LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(2, memberUser.encode(true)),
+            LoadResult::UpToDate);
+
+  EXPECT_EQ(1, std::distance(graph.getExternalDependencies().begin(),
+                             graph.getExternalDependencies().end()));
+  EXPECT_EQ("/foo", *graph.getExternalDependencies().begin());
+
+  SmallVector<uintptr_t, 4> marked;
+  graph.markTransitive(marked, 0);
+  EXPECT_EQ(2u, marked.size());
+  EXPECT_TRUE(graph.isMarked(0));
+  // The dependency of 1 is private, so 1 is visited but not marked.
+  EXPECT_FALSE(graph.isMarked(1));
+  EXPECT_TRUE(graph.isMarked(2));
+}
+
+TEST(DependencyGraph, BinaryInterfaceHash) {
+  DependencyGraph<uintptr_t> graph;
+
+  DepsFile file;
+  file.add(ReferenceDependencySection::ProvidesTopLevel, "a");
+  file.interfaceHash = "abcd";
+  EXPECT_EQ(graph.loadFromString(0, file.encode(true)), LoadResult::UpToDate);
+  EXPECT_EQ(graph.loadFromString(0, file.encode(true)), LoadResult::UpToDate);
+
+  // Switching formats doesn't matter; only the hash does.
+  file.interfaceHash = "efgh";
+  EXPECT_EQ(graph.loadFromString(0, file.encode(false)),
+            LoadResult::AffectsDownstream);
+  file.interfaceHash = "abcd";
+  EXPECT_EQ(graph.loadFromString(0, file.encode(true)),
+            LoadResult::AffectsDownstream);
+}
+
+TEST(DependencyGraph, BinaryMalformed) {
+  DependencyGraph<uintptr_t> graph;
+
+  DepsFile file;
+  file.add(ReferenceDependencySection::DependsTopLevel, "a")
+      .addMember(ReferenceDependencySection::DependsMember, "b", "c");
+  file.interfaceHash = "abcd";
+  std::string binary = file.encode(true);
+
+  // Every truncation of a valid file must be rejected.
+  uintptr_t node = 0;
+  for (size_t size = 4; size < binary.size(); ++size) {
+    EXPECT_EQ(graph.loadFromString(node++, StringRef(binary).substr(0, size)),
+              LoadResult::HadError) << "size " << size;
+  }
+
+  // So must a file from a different version of the format.
+  std::string badVersion = binary;
+  badVersion[4] = 0x7F;
+  EXPECT_EQ(graph.loadFromString(node++, badVersion), LoadResult::HadError);
+
+  EXPECT_EQ(graph.loadFromString(node++, binary), LoadResult::UpToDate);
+}
+
+/// Produces the dependencies file of one file in a synthetic project where
+/// every file declares a type and a few top-level names, and uses names from
+/// some of the files before it.
+static DepsFile makeSyntheticDepsFile(unsigned index) {
+  using Section = ReferenceDependencySection;
+  const unsigned namesPerFile = 8;
+  const unsigned usesPerFile = 24;
+
+  DepsFile file;
+  std::string typeName = "V4main4Type" + std::to_string(index);
+  for (unsigned i = 0; i != namesPerFile; ++i) {
+    file.add(Section::ProvidesTopLevel,
+             "name" + std::to_string(index) + "_" + std::to_string(i));
+  }
+  file.add(Section::ProvidesNominal, typeName);
+  file.addMember(Section::ProvidesMember, typeName, "");
+
+  for (unsigned i = 0; i != usesPerFile; ++i) {
+    unsigned other = (index * 7 + i * 13) % (index + 1);
+    file.add(Section::DependsTopLevel,
+             "name" + std::to_string(other) + "_" +
+               std::to_string(i % namesPerFile),
+             /*isCascading=*/i % 3 != 0);
+    file.addMember(Section::DependsMember,
+                   "V4main4Type" + std::to_string(other),
+                   "member" + std::to_string(i));
+  }
+  file.add(Section::DependsExternal, "/sdk/Swift.swiftmodule");
+  file.interfaceHash = std::to_string(index * 2654435761u);
+  return file;
+}
+
+/// Loads every file of the synthetic project into a fresh graph, as the
+/// driver does at startup, and returns the time that took in microseconds.
+static int64_t measureLoadTime(ArrayRef<std::string> paths) {
+  DependencyGraph<uintptr_t> graph;
+  auto start = std::chrono::steady_clock::now();
+  for (uintptr_t i = 0, e = paths.size(); i != e; ++i) {
+    EXPECT_EQ(LoadResult::UpToDate, graph.loadFromPath(i, paths[i]));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start);
+  return std::max<int64_t>(elapsed.count(), 1);
+}
+
+TEST(DependencyGraph, LoadThroughput) {
+  namespace fs = llvm::sys::fs;
+  const unsigned numFiles = 2000;
+
+  SmallString<128> dirPath;
+  ASSERT_FALSE(fs::createUniqueDirectory("DependencyGraph-test", dirPath));
+
+  std::vector<std::string> yamlPaths, binaryPaths;
+  uint64_t yamlSize = 0, binarySize = 0;
+  for (unsigned i = 0; i != numFiles; ++i) {
+    DepsFile file = makeSyntheticDepsFile(i);
+    for (bool binary : {false, true}) {
+      SmallString<128> path = dirPath;
+      llvm::sys::path::append(path, "file" + std::to_string(i) +
+                                      (binary ? ".bin" : ".yaml") +
+                                      ".swiftdeps");
+      std::error_code EC;
+      llvm::raw_fd_ostream out(path, EC, fs::F_None);
+      ASSERT_FALSE(EC);
+      std::string contents = file.encode(binary);
+      out << contents;
+      (binary ? binarySize : yamlSize) += contents.size();
+      (binary ? binaryPaths : yamlPaths).push_back(std::string(path.str()));
+    }
+  }
+
+  RecordProperty("Files", numFiles);
+  RecordProperty("YAMLBytes", int(yamlSize));
+  RecordProperty("BinaryBytes", int(binarySize));
+  RecordProperty("YAMLMicroseconds", int(measureLoadTime(yamlPaths)));
+  RecordProperty("BinaryMicroseconds", int(measureLoadTime(binaryPaths)));
+
+  for (auto &path : yamlPaths)
+    fs::remove(path);
+  for (auto &path : binaryPaths)
+    fs::remove(path);
+  fs::remove(dirPath);
+}
@@ -0,0 +1,177 @@
+//===----------------------------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceKit/Support/Concurrency.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+using namespace SourceKit;
+
+namespace {
+
+class Semaphore {
+  std::mutex Mtx;
+  std::condition_variable CV;
+  unsigned Count = 0;
+
+public:
+  void signal() {
+    std::lock_guard<std::mutex> Lock(Mtx);
+    ++Count;
+    CV.notify_one();
+  }
+
+  /// Returns false if the semaphore wasn't signaled within a minute.
+  bool wait() {
+    std::unique_lock<std::mutex> Lock(Mtx);
+    if (!CV.wait_for(Lock, std::chrono::seconds(60), [&]{ return Count != 0; }))
+      return false;
+    --Count;
+    return true;
+  }
+};
+
+} // end anonymous namespace
+
+TEST(WorkQueue, SerialOrder) {
+  WorkQueue Queue{ WorkQueue::Dequeuing::Serial, "test.serial" };
+  EXPECT_EQ("test.serial", Queue.getLabel());
+
+  std::vector<int> Order;
+  std::atomic<int> Running{0};
+  bool Overlapped = false;
+  for (int i = 0; i != 100; ++i) {
+    Queue.dispatch([&, i]{
+      if (++Running != 1)
+        Overlapped = true;
+      Order.push_back(i);
+      --Running;
+    });
+  }
+  Queue.dispatchSync([]{});
+
+  EXPECT_FALSE(Overlapped);
+  ASSERT_EQ(100u, Order.size());
+  for (int i = 0; i != 100; ++i)
+    EXPECT_EQ(i, Order[i]);
+}
+
+TEST(WorkQueue, ConcurrentBarrier) {
+  WorkQueue Queue{ WorkQueue::Dequeuing::Concurrent, "test.concurrent" };
+
+  std::atomic<int> Running{0};
+  std::atomic<int> Finished{0};
+  std::atomic<bool> BarrierOverlapped{false};
+  for (int i = 0; i != 100; ++i) {
+    Queue.dispatch([&]{
+      ++Running;
+      ++Finished;
+      --Running;
+    });
+    if (i % 10 == 0) {
+      Queue.dispatchBarrier([&]{
+        if (Running != 0)
+          BarrierOverlapped = true;
+      });
+    }
+  }
+
+  int FinishedBeforeBarrier = 0;
+  Queue.dispatchBarrierSync([&]{ FinishedBeforeBarrier = Finished; });
+  EXPECT_EQ(100, FinishedBeforeBarrier);
+  EXPECT_FALSE(BarrierOverlapped);
+}
+
+TEST(WorkQueue, SuspendResume) {
+  WorkQueue Queue{ WorkQueue::Dequeuing::Serial, "test.suspend" };
+
+  std::atomic<bool> Ran{false};
+  Queue.suspend();
+  Queue.dispatch([&]{ Ran = true; });
+  EXPECT_FALSE(Ran);
+  Queue.resume();
+  Queue.dispatchSync([]{});
+  EXPECT_TRUE(Ran);
+}
+
+TEST(WorkQueue, DeepStack) {
+  WorkQueue Queue{ WorkQueue::Dequeuing::Serial, "test.deepstack" };
+
+  // Worker threads have small stacks, so this would overflow without
+  // isStackDeep.
+  Semaphore Done;
+  std::atomic<bool> Ran{false};
+  Queue.dispatch([&]{
+    volatile char Buffer[4 << 20];
+    Buffer[0] = 1;
+    Ran = Buffer[0] == 1;
+    Done.signal();
+  }, /*isStackDeep=*/true);
+  ASSERT_TRUE(Done.wait());
+  EXPECT_TRUE(Ran);
+}
+
+#if !defined(__APPLE__)
+TEST(WorkQueue, PriorityOrder) {
+  // Occupy every thread of the worker pool, which never grows beyond 64
+  // threads, so that the items below queue up.
+  static const unsigned MaxWorkers = 64;
+  Semaphore BlockersStarted;
+  Semaphore Unblock;
+  for (unsigned i = 0; i != MaxWorkers; ++i) {
+    WorkQueue::dispatchConcurrent([&]{
+      BlockersStarted.signal();
+      Unblock.wait();
+    });
+  }
+  for (unsigned i = 0; i != MaxWorkers; ++i)
+    ASSERT_TRUE(BlockersStarted.wait());
+
+  std::mutex OrderMtx;
+  std::vector<WorkQueue::Priority> Order;
+  Semaphore Done;
+  const WorkQueue::Priority Priorities[] = {
+    WorkQueue::Priority::Background,
+    WorkQueue::Priority::Low,
+    WorkQueue::Priority::Default,
+    WorkQueue::Priority::High,
+  };
+  for (auto Prio : Priorities) {
+    WorkQueue::dispatchConcurrent([&, Prio]{
+      {
+        std::lock_guard<std::mutex> Lock(OrderMtx);
+        Order.push_back(Prio);
+      }
+      Done.signal();
+    }, Prio);
+  }
+
+  // Free a single thread, which then runs the queued items one by one.
+  Unblock.signal();
+  for (unsigned i = 0; i != 4; ++i)
+    ASSERT_TRUE(Done.wait());
+  for (unsigned i = 1; i != MaxWorkers; ++i)
+    Unblock.signal();
+
+  std::vector<WorkQueue::Priority> Expected = {
+    WorkQueue::Priority::High,
+    WorkQueue::Priority::Default,
+    WorkQueue::Priority::Low,
+    WorkQueue::Priority::Background,
+  };
+  EXPECT_EQ(Expected, Order);
+}
+#endif
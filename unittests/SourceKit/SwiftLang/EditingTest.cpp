@@ -0,0 +1,261 @@
+//===----------------------------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceKit/Core/Context.h"
+#include "SourceKit/Core/LangSupport.h"
+#include "SourceKit/Support/Tracing.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Path.h"
+#include "gtest/gtest.h"
+
+using namespace SourceKit;
+using namespace llvm;
+
+static StringRef getRuntimeLibPath() {
+  return sys::path::parent_path(SWIFTLIB_DIR);
+}
+
+namespace {
+
+class DiagEditorConsumer : public EditorConsumer {
+public:
+  std::vector<DiagnosticEntryInfo> Diags;
+
+private:
+  bool needsSemanticInfo() override { return false; }
+
+  bool needsDocumentStructure() override { return false; }
+
+  void handleRequestError(const char *Description) override {
+    llvm_unreachable("unexpected error");
+  }
+
+  bool handleSyntaxMap(unsigned Offset, unsigned Length, UIdent Kind) override {
+    return false;
+  }
+
+  bool handleSemanticAnnotation(unsigned Offset, unsigned Length,
+                                UIdent Kind, bool isSystem) override {
+    return false;
+  }
+
+  bool beginDocumentSubStructure(unsigned Offset, unsigned Length,
+                                 UIdent Kind, UIdent AccessLevel,
+                                 UIdent SetterAccessLevel,
+                                 unsigned NameOffset,
+                                 unsigned NameLength,
+                                 unsigned BodyOffset,
+                                 unsigned BodyLength,
+                                 StringRef DisplayName,
+                                 StringRef TypeName,
+                                 StringRef RuntimeName,
+                                 StringRef SelectorName,
+                                 ArrayRef<StringRef> InheritedTypes,
+                                 ArrayRef<UIdent> Attrs) override {
+    return false;
+  }
+
+  bool endDocumentSubStructure() override { return false; }
+
+  bool handleDocumentSubStructureElement(UIdent Kind,
+                                         unsigned Offset,
+                                         unsigned Length) override {
+    return false;
+  }
+
+  bool recordAffectedRange(unsigned Offset, unsigned Length) override {
+    return false;
+  }
+  
+  bool recordAffectedLineRange(unsigned Line, unsigned Length) override {
+    return false;
+  }
+
+  bool recordFormattedText(StringRef Text) override { return false; }
+
+  bool setDiagnosticStage(UIdent DiagStage) override { return false; }
+  bool handleDiagnostic(const DiagnosticEntryInfo &Info,
+                        UIdent DiagStage) override {
+    static UIdent ParseDiagStage("source.diagnostic.stage.swift.parse");
+    if (DiagStage == ParseDiagStage)
+      Diags.push_back(Info);
+    return true;
+  }
+
+  bool handleSourceText(StringRef Text) override { return false; }
+};
+
+/// Records the function bodies which each syntactic parse reused.
+class ParseTraceConsumer : public trace::TraceConsumer {
+  llvm::sys::Mutex Mtx;
+  std::vector<std::vector<std::string>> ReusedBodies;
+
+public:
+  void opertationStarted(uint64_t OpId, trace::OperationKind OpKind,
+                         const trace::SwiftInvocation &Inv,
+                         const trace::StringPairs &OpArgs) override {
+    if (OpKind != trace::OperationKind::SimpleParse)
+      return;
+    std::vector<std::string> Bodies;
+    for (auto &Arg : OpArgs) {
+      if (Arg.first == "ReusedBody")
+        Bodies.push_back(Arg.second);
+    }
+    llvm::sys::ScopedLock L(Mtx);
+    ReusedBodies.push_back(std::move(Bodies));
+  }
+
+  void operationFinished(uint64_t OpId) override {}
+
+  std::vector<std::string> getLastReusedBodies() {
+    llvm::sys::ScopedLock L(Mtx);
+    if (ReusedBodies.empty())
+      return {};
+    return ReusedBodies.back();
+  }
+};
+
+ParseTraceConsumer &getTraceConsumer() {
+  static ParseTraceConsumer *Consumer = [] {
+    auto *Consumer = new ParseTraceConsumer();
+    trace::registerConsumer(Consumer);
+    return Consumer;
+  }();
+  return *Consumer;
+}
+
+class EditingTest : public ::testing::Test {
+  SourceKit::Context Ctx{ getRuntimeLibPath() };
+
+public:
+  LangSupport &getLang() { return Ctx.getSwiftLangSupport(); }
+
+  void SetUp() {
+    getTraceConsumer();
+    trace::enable();
+  }
+
+  void TearDown() {
+    trace::disable();
+  }
+
+  void open(StringRef DocName, StringRef Text) {
+    DiagEditorConsumer Consumer;
+    auto Buf = MemoryBuffer::getMemBufferCopy(Text, DocName);
+    getLang().editorOpen(DocName, Buf.get(), /*EnableSyntaxMap=*/false, Consumer,
+                         /*Args=*/{});
+  }
+
+  std::vector<DiagnosticEntryInfo> replaceText(StringRef DocName,
+                                               unsigned Offset, unsigned Length,
+                                               StringRef Text) {
+    DiagEditorConsumer Consumer;
+    auto Buf = MemoryBuffer::getMemBufferCopy(Text, DocName);
+    getLang().editorReplaceText(DocName, Buf.get(), Offset, Length, Consumer);
+    return std::move(Consumer.Diags);
+  }
+
+  unsigned findOffset(StringRef Val, StringRef Text) {
+    auto pos = Text.find(Val);
+    assert(pos != StringRef::npos);
+    return pos;
+  }
+
+  /// Returns the range of the body of the function named \p Name in \p Text,
+  /// the way the parse trace prints it.
+  std::string getBodyRange(StringRef Name, StringRef Text) {
+    unsigned Start = Text.find('{', findOffset(Name, Text));
+    unsigned End = Text.find("\n}", Start) + strlen("\n}");
+    return std::to_string(Start) + "-" + std::to_string(End);
+  }
+};
+
+} // anonymous namespace
+
+static const char *FunctionsContents =
+  "func before() {\n"
+  "  let x = 1 +\n"
+  "}\n"
+  "\n"
+  "func edited() {\n"
+  "  var value = 0\n"
+  "}\n"
+  "\n"
+  "func after() {\n"
+  "  let y = 2 *\n"
+  "}\n";
+
+TEST_F(EditingTest, ReuseBodiesAroundEditInBody) {
+  const char *DocName = "/test.swift";
+  open(DocName, FunctionsContents);
+
+  std::string NewContents = FunctionsContents;
+  unsigned EditOffs = findOffset("value", NewContents);
+  NewContents.replace(EditOffs, strlen("value"), "renamed");
+  auto Diags = replaceText(DocName, EditOffs, strlen("value"), "renamed");
+
+  std::vector<std::string> Expected = {
+    getBodyRange("before", NewContents),
+    getBodyRange("after", NewContents),
+  };
+  EXPECT_EQ(Expected, getTraceConsumer().getLastReusedBodies());
+
+  ASSERT_EQ(2u, Diags.size());
+  EXPECT_EQ("expected expression after operator", Diags[0].Description);
+  EXPECT_EQ(3u, Diags[0].Line);
+  EXPECT_EQ(findOffset("}\n\nfunc edited", NewContents), Diags[0].Offset);
+  EXPECT_EQ("expected expression after operator", Diags[1].Description);
+  EXPECT_EQ(11u, Diags[1].Line);
+  EXPECT_EQ(NewContents.find('}', findOffset("2 *", NewContents)),
+            Diags[1].Offset);
+}
+
+TEST_F(EditingTest, ReuseBodiesAfterNewLine) {
+  const char *DocName = "/test.swift";
+  open(DocName, FunctionsContents);
+
+  std::string NewContents = FunctionsContents;
+  unsigned EditOffs = findOffset("func edited", NewContents);
+  NewContents.insert(EditOffs, "\n");
+  auto Diags = replaceText(DocName, EditOffs, 0, "\n");
+
+  std::vector<std::string> Expected = {
+    getBodyRange("before", NewContents),
+    getBodyRange("edited", NewContents),
+    getBodyRange("after", NewContents),
+  };
+  EXPECT_EQ(Expected, getTraceConsumer().getLastReusedBodies());
+
+  ASSERT_EQ(2u, Diags.size());
+  EXPECT_EQ(3u, Diags[0].Line);
+  EXPECT_EQ(12u, Diags[1].Line);
+}
+
+TEST_F(EditingTest, ReparseEditedBody) {
+  const char *DocName = "/test.swift";
+  open(DocName, FunctionsContents);
+
+  std::string NewContents = FunctionsContents;
+  unsigned EditOffs = findOffset("1 +", NewContents);
+  NewContents.replace(EditOffs, strlen("1 +"), "1");
+  auto Diags = replaceText(DocName, EditOffs, strlen("1 +"), "1");
+
+  std::vector<std::string> Expected = {
+    getBodyRange("edited", NewContents),
+    getBodyRange("after", NewContents),
+  };
+  EXPECT_EQ(Expected, getTraceConsumer().getLastReusedBodies());
+
+  ASSERT_EQ(1u, Diags.size());
+  EXPECT_EQ(11u, Diags[0].Line);
+}
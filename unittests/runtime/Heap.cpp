@@ -0,0 +1,139 @@
+//===--- swift/unittests/runtime/Heap.cpp - Heap allocation tests ---------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/HeapObject.h"
+#include "swift/Runtime/Metadata.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+
+static void testSlowAllocAlignment(size_t alignMask) {
+  for (size_t size : {1, 8, 16, 24, 100, 512, 513, 4096, 100000}) {
+    void *p = swift_slowAlloc(size, alignMask);
+    EXPECT_EQ(0u, uintptr_t(p) & alignMask)
+      << "size " << size << ", alignMask " << alignMask;
+    EXPECT_LE(size, swift_slowAllocSize(p));
+    memset(p, 0xA5, size);
+    swift_slowDealloc(p, size, alignMask);
+  }
+}
+
+TEST(HeapTest, slowAlloc_alignment) {
+  testSlowAllocAlignment(alignof(void*) - 1);
+  testSlowAllocAlignment(15);
+  testSlowAllocAlignment(31);
+  testSlowAllocAlignment(63);
+  testSlowAllocAlignment(4095);
+}
+
+TEST(HeapTest, slowAlloc_reuse) {
+  // Memory handed back must be usable again without corrupting live blocks.
+  std::vector<size_t *> live;
+  for (size_t i = 0; i < 10000; ++i) {
+    auto p = static_cast<size_t *>(swift_slowAlloc(sizeof(size_t) * 4, 7));
+    p[0] = i;
+    p[3] = ~i;
+    live.push_back(p);
+    if (i % 3 == 0) {
+      swift_slowDealloc(live.front(), sizeof(size_t) * 4, 7);
+      live.erase(live.begin());
+    }
+  }
+  for (auto p : live) {
+    EXPECT_EQ(~p[0], p[3]);
+    swift_slowDealloc(p, sizeof(size_t) * 4, 7);
+  }
+}
+
+/// Allocate and free objects of the given size in batches, and return the
+/// number of allocations per microsecond.
+static double measureAllocThroughput(size_t size, unsigned numAllocs) {
+  const unsigned batchSize = 64;
+  void *batch[batchSize];
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < numAllocs; i += batchSize) {
+    for (unsigned j = 0; j < batchSize; ++j)
+      batch[j] = swift_slowAlloc(size, alignof(void*) - 1);
+    for (unsigned j = 0; j < batchSize; ++j)
+      swift_slowDealloc(batch[j], size, alignof(void*) - 1);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start);
+  return double(numAllocs) / std::max<int64_t>(elapsed.count(), 1);
+}
+
+TEST(HeapTest, slowAlloc_throughput) {
+  const unsigned numAllocs = 1 << 20;
+  for (size_t size : {16, 32, 48, 128, 512}) {
+    RecordProperty("AllocsPerMicrosecond_" + std::to_string(size),
+                   int(measureAllocThroughput(size, numAllocs)));
+  }
+}
+
+TEST(HeapTest, slowAlloc_throughput_multithreaded) {
+  const unsigned numThreads = 8;
+  const unsigned numAllocs = 1 << 18;
+
+  std::vector<double> results(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&results, i] {
+      results[i] = measureAllocThroughput(32, numAllocs);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  double total = 0;
+  for (double result : results)
+    total += result;
+  RecordProperty("Threads", numThreads);
+  RecordProperty("AllocsPerMicrosecond", int(total));
+}
+
+struct TestObject : HeapObject {
+  size_t Payload[2];
+};
+
+static void destroyTestObject(HeapObject *object) {
+  swift_deallocObject(object, sizeof(TestObject), alignof(TestObject) - 1);
+}
+
+static const FullMetadata<ClassMetadata> TestClassObjectMetadata = {
+  { { &destroyTestObject }, { &_TWVBo } },
+  { { { MetadataKind::Class } }, 0, /*rodata*/ 1,
+  ClassFlags::UsesSwift1Refcounting, nullptr, nullptr, 0, 0, 0, 0, 0 }
+};
+
+TEST(HeapTest, allocObject_throughput) {
+  const unsigned numObjects = 1 << 20;
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < numObjects; ++i) {
+    auto object = swift_allocObject(&TestClassObjectMetadata,
+                                    sizeof(TestObject),
+                                    alignof(TestObject) - 1);
+    swift_release(object);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  RecordProperty("ObjectsPerMicrosecond",
+                 int(numObjects / std::max<int64_t>(elapsed.count(), 1)));
+}
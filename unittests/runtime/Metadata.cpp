@@ -13,6 +13,8 @@
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Concurrent.h"
 #include "gtest/gtest.h"
+#include <atomic>
+#include <chrono>
 #include <iterator>
 #include <functional>
 #include <sys/mman.h>
@@ -215,6 +217,67 @@ TEST(Concurrent, ConcurrentList) {
   EXPECT_EQ(ListLen, results.size() * numElem);
 }
 
+TEST(Concurrent, ConcurrentMap) {
+  const size_t numKeys = 10000;
+
+  ConcurrentMap<size_t, int> Map;
+  auto results = RaceTest<int*>(
+    [&]() -> int* {
+        // Every thread allocates every key; only one node per key may win.
+        for (size_t i = 0; i < numKeys; i++)
+          Map.findOrAllocateNode(i * sizeof(void*)).push_front(int(i));
+        return nullptr;
+    }
+  );
+
+  EXPECT_EQ(numKeys, Map.size());
+  for (size_t i = 0; i < numKeys; i++) {
+    auto Node = Map.find(i * sizeof(void*));
+    ASSERT_NE(nullptr, Node);
+    EXPECT_EQ(i * sizeof(void*), Node->Key);
+
+    size_t BucketLen = std::distance(Node->Payload.begin(),
+                                     Node->Payload.end());
+    EXPECT_EQ(results.size(), BucketLen);
+    for (auto A : Node->Payload)
+      EXPECT_EQ(int(i), A);
+  }
+  EXPECT_EQ(nullptr, Map.find(1));
+}
+
+/// Measure the average latency of a successful ConcurrentMap lookup in a map
+/// holding \p numKeys pointer-like keys.
+static void measureConcurrentMapLookup(size_t numKeys) {
+  ConcurrentMap<size_t, int> Map;
+  for (size_t i = 0; i < numKeys; i++)
+    Map.findOrAllocateNode(i * 2 * sizeof(void*));
+
+  // Visit the keys in a scattered order so that lookups are not served by
+  // the cache lines of the previous lookup.
+  const size_t numLookups = 1000000;
+  const size_t stride = 7919;
+  size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < numLookups; i++) {
+    size_t key = ((i * stride) % numKeys) * 2 * sizeof(void*);
+    if (Map.find(key))
+      ++found;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  EXPECT_EQ(numLookups, found);
+  ::testing::Test::RecordProperty(
+    "Entries_" + std::to_string(numKeys) + "_NanosecondsPerLookup",
+    int(elapsed.count() / numLookups));
+}
+
+TEST(Concurrent, ConcurrentMapLookupLatency) {
+  measureConcurrentMapLookup(1000);
+  measureConcurrentMapLookup(100000);
+  measureConcurrentMapLookup(1000000);
+}
+
 TEST(MetadataAllocator, alloc_firstAllocationMoreThanPageSized) {
   using swift::MetadataAllocator;
   MetadataAllocator allocator;
@@ -265,6 +328,63 @@ TEST(MetadataTest, getGenericMetadata) {
     });
 }
 
+GenericMetadataTest<3> MetadataTest3 = {
+  // Header
+  {
+    // allocation function
+    [](GenericMetadata *pattern, const void *args) {
+      auto metadata = swift_allocateGenericValueMetadata(pattern, args);
+      auto metadataWords = reinterpret_cast<const void**>(metadata);
+      auto argsWords = reinterpret_cast<const void* const*>(args);
+      metadataWords[2] = argsWords[0];
+      return metadata;
+    },
+    3 * sizeof(void*), // metadata size
+    1, // num arguments
+    0, // address point
+    {} // private data
+  },
+
+  // Fields
+  {
+    (void*) MetadataKind::Struct,
+    &Global1,
+    nullptr
+  }
+};
+
+TEST(MetadataTest, getGenericMetadata_contention) {
+  // Every thread instantiates its own distinct set of generic types at the
+  // same time. None of these instantiations share a key, so they should not
+  // have to wait for one another.
+  const unsigned numThreads = 64;
+  const unsigned typesPerThread = 256;
+  static char Arguments[numThreads * typesPerThread];
+
+  auto metadataTemplate = (GenericMetadata*) &MetadataTest3;
+  std::atomic<unsigned> nextThread{0};
+
+  auto start = std::chrono::steady_clock::now();
+  RaceTest<void *, numThreads>(
+    [&]() -> void * {
+      unsigned thread = nextThread++;
+      for (unsigned i = 0; i < typesPerThread; ++i) {
+        void *args[] = { &Arguments[thread * typesPerThread + i] };
+        auto inst = swift_getGenericMetadata(metadataTemplate, args);
+
+        auto fields = reinterpret_cast<void * const *>(inst);
+        EXPECT_EQ(args[0], fields[2]);
+        EXPECT_EQ(inst, swift_getGenericMetadata(metadataTemplate, args));
+      }
+      return nullptr;
+    });
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  RecordProperty("Instantiations", numThreads * typesPerThread);
+  RecordProperty("Microseconds", (int) elapsed.count());
+}
+
 FullMetadata<ClassMetadata> MetadataTest2 = {
   { { nullptr }, { &_TWVBo } },
   { { { MetadataKind::Class } }, nullptr, 0, ClassFlags(), nullptr, nullptr, 0, 0, 0, 0, 0 }
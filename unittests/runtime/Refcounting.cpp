@@ -13,6 +13,12 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace swift;
 
@@ -156,3 +162,176 @@ TEST(RefcountingTest, unowned_retain_release_n) {
   swift_release(object);
   EXPECT_EQ(1u, value);
 }
+
+/// Retain and release a fresh object from the current thread and return the
+/// number of retain/release pairs per microsecond.
+static double measureRetainReleaseThroughput(unsigned iterations) {
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < iterations; ++i) {
+    swift_retain(object);
+    swift_release(object);
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start);
+
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+  return double(iterations) / std::max<int64_t>(elapsed.count(), 1);
+}
+
+/// Record the retain/release throughput of one thread, and of several
+/// threads each working on objects they allocated themselves.
+static void recordRetainReleaseThroughput(const std::string &suffix) {
+  const unsigned iterations = 1 << 22;
+  const unsigned numThreads = 8;
+
+  ::testing::Test::RecordProperty("PairsPerMicrosecond" + suffix,
+    int(measureRetainReleaseThroughput(iterations)));
+
+  std::vector<double> results(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < numThreads; ++i) {
+    threads.emplace_back([&results, i] {
+      results[i] = measureRetainReleaseThroughput(iterations / numThreads);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  double total = 0;
+  for (double result : results)
+    total += result;
+  ::testing::Test::RecordProperty("PairsPerMicrosecond_" +
+                                  std::to_string(numThreads) + "Threads" +
+                                  suffix,
+                                  int(total));
+}
+
+TEST(RefcountingTest, retain_release_throughput) {
+  recordRetainReleaseThroughput("");
+}
+
+namespace {
+/// Enables biased reference counting, if it is available, for the lifetime
+/// of a test, so that the tests that run after it use the default mode.
+struct BiasedRefCountingScope {
+  bool Enabled;
+  BiasedRefCountingScope() : Enabled(swift_enableBiasedRefCounting()) {}
+  ~BiasedRefCountingScope() {
+    if (Enabled)
+      swift_disableBiasedRefCounting();
+  }
+};
+} // end anonymous namespace
+
+TEST(RefcountingTest, biased_retain_release) {
+  BiasedRefCountingScope biased;
+  if (!biased.Enabled)
+    return;
+
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  swift_retain(object);
+  swift_retain_n(object, 4);
+  EXPECT_EQ(6u, swift_retainCount(object));
+  EXPECT_FALSE(swift_isUniquelyReferenced_native(object));
+  swift_release_n(object, 5);
+  EXPECT_EQ(1u, swift_retainCount(object));
+  EXPECT_TRUE(swift_isUniquelyReferenced_native(object));
+  EXPECT_EQ(0u, value);
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+}
+
+TEST(RefcountingTest, biased_pin_unpin) {
+  BiasedRefCountingScope biased;
+  if (!biased.Enabled)
+    return;
+
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  EXPECT_EQ(object, swift_tryPin(object));
+  EXPECT_TRUE(swift_isUniquelyReferencedOrPinned_native(object));
+  swift_release(object);
+  EXPECT_EQ(0u, value);
+  swift_unpin(object);
+  EXPECT_EQ(1u, value);
+}
+
+TEST(RefcountingTest, biased_release_on_other_thread) {
+  BiasedRefCountingScope biased;
+  if (!biased.Enabled)
+    return;
+
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  swift_retain_n(object, 2);
+  std::thread([object] {
+    // Another thread cannot see the owner's references.
+    EXPECT_FALSE(swift_isUniquelyReferenced_native(object));
+    swift_retain(object);
+    swift_release_n(object, 2);
+  }).join();
+  EXPECT_EQ(2u, swift_retainCount(object));
+
+  // The other thread's last release is applied by the owner.
+  std::thread([object] { swift_release(object); }).join();
+  EXPECT_EQ(0u, value);
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+}
+
+TEST(RefcountingTest, biased_release_after_owner_exits) {
+  BiasedRefCountingScope biased;
+  if (!biased.Enabled)
+    return;
+
+  const unsigned numObjects = 1000;
+  std::vector<size_t> values(numObjects);
+  std::vector<TestObject *> objects(numObjects);
+  std::thread([&] {
+    for (unsigned i = 0; i < numObjects; ++i)
+      objects[i] = allocTestObject(&values[i], 1);
+  }).join();
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (unsigned i = t; i < numObjects; i += 4)
+        swift_release(objects[i]);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (size_t value : values)
+    EXPECT_EQ(1u, value);
+}
+
+TEST(RefcountingTest, biased_retain_release_throughput) {
+  BiasedRefCountingScope biased;
+  if (!biased.Enabled)
+    return;
+
+  recordRetainReleaseThroughput("_Biased");
+}
+
+TEST(RefcountingTest, biased_alloc_size) {
+  BiasedRefCountingScope biased;
+  if (!biased.Enabled)
+    return;
+
+  size_t value = 0;
+  auto object = allocTestObject(&value, 1);
+  // The usable size is counted from the object, not from its prefix, so
+  // writing all of it stays within the allocation.
+  size_t size = swift_allocObjectSize(object);
+  EXPECT_LE(sizeof(TestObject), size);
+  memset(reinterpret_cast<char *>(object) + sizeof(TestObject), 0,
+         size - sizeof(TestObject));
+  swift_release(object);
+  EXPECT_EQ(1u, value);
+}
@@ -0,0 +1,128 @@
+//===--- swift/unittests/runtime/Statistics.cpp - Runtime statistics ------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2015 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/HeapObject.h"
+#include "swift/Runtime/Metadata.h"
+#include "swift/Runtime/Statistics.h"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+
+struct TestObject : HeapObject {};
+
+static void destroyTestObject(HeapObject *object) {
+  swift_deallocObject(object, sizeof(TestObject), alignof(TestObject) - 1);
+}
+
+static const FullMetadata<ClassMetadata> TestClassObjectMetadata = {
+  { { &destroyTestObject }, { &_TWVBo } },
+  { { { MetadataKind::Class } }, 0, /*rodata*/ 1,
+  ClassFlags::UsesSwift1Refcounting, nullptr, nullptr, 0, 0, 0, 0, 0 }
+};
+
+static HeapObject *allocTestObject() {
+  return swift_allocObject(&TestClassObjectMetadata, sizeof(TestObject),
+                           alignof(TestObject) - 1);
+}
+
+static uint64_t getStatistic(RuntimeStatistic statistic) {
+  return swift_getRuntimeStatistic(static_cast<size_t>(statistic));
+}
+
+static uint64_t getTestObjectAllocations() {
+  uint64_t count = 0;
+  swift_enumerateAllocationStatistics(
+    [](const HeapMetadata *metadata, uint64_t n, void *context) {
+      if (metadata == &TestClassObjectMetadata)
+        *static_cast<uint64_t *>(context) += n;
+    }, &count);
+  return count;
+}
+
+/// Enables the statistics for the duration of a test.
+struct StatisticsEnabler {
+  bool WasEnabled = swift_areRuntimeStatisticsEnabled();
+  StatisticsEnabler() { swift_setRuntimeStatisticsEnabled(true); }
+  ~StatisticsEnabler() { swift_setRuntimeStatisticsEnabled(WasEnabled); }
+};
+
+TEST(RuntimeStatisticsTest, names) {
+  ASSERT_LT(0u, swift_getNumRuntimeStatistics());
+  for (size_t i = 0, e = swift_getNumRuntimeStatistics(); i != e; ++i) {
+    ASSERT_NE(nullptr, swift_getRuntimeStatisticName(i));
+    EXPECT_NE(0u, strlen(swift_getRuntimeStatisticName(i)));
+  }
+  EXPECT_EQ(nullptr,
+            swift_getRuntimeStatisticName(swift_getNumRuntimeStatistics()));
+}
+
+TEST(RuntimeStatisticsTest, retain_release_alloc) {
+  StatisticsEnabler enabler;
+  auto retains = getStatistic(RuntimeStatistic::Retain);
+  auto releases = getStatistic(RuntimeStatistic::Release);
+  auto allocs = getStatistic(RuntimeStatistic::AllocObject);
+  auto deallocs = getStatistic(RuntimeStatistic::DeallocObject);
+  auto testAllocs = getTestObjectAllocations();
+
+  auto object = allocTestObject();
+  swift_retain(object);
+  swift_retain_n(object, 2);
+  swift_release_n(object, 2);
+  swift_release(object);
+  swift_release(object);
+
+  EXPECT_EQ(retains + 3, getStatistic(RuntimeStatistic::Retain));
+  EXPECT_EQ(releases + 4, getStatistic(RuntimeStatistic::Release));
+  EXPECT_EQ(allocs + 1, getStatistic(RuntimeStatistic::AllocObject));
+  EXPECT_EQ(deallocs + 1, getStatistic(RuntimeStatistic::DeallocObject));
+  EXPECT_EQ(testAllocs + 1, getTestObjectAllocations());
+}
+
+TEST(RuntimeStatisticsTest, disabled) {
+  bool wasEnabled = swift_areRuntimeStatisticsEnabled();
+  swift_setRuntimeStatisticsEnabled(false);
+  auto retains = getStatistic(RuntimeStatistic::Retain);
+  auto object = allocTestObject();
+  swift_retain(object);
+  swift_release(object);
+  swift_release(object);
+  EXPECT_EQ(retains, getStatistic(RuntimeStatistic::Retain));
+  swift_setRuntimeStatisticsEnabled(wasEnabled);
+}
+
+TEST(RuntimeStatisticsTest, exited_threads) {
+  StatisticsEnabler enabler;
+  auto retains = getStatistic(RuntimeStatistic::Retain);
+  auto testAllocs = getTestObjectAllocations();
+
+  const unsigned NumThreads = 4;
+  const unsigned NumRetains = 1000;
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    threads.emplace_back([] {
+      auto object = allocTestObject();
+      for (unsigned j = 0; j != NumRetains; ++j)
+        swift_retain(object);
+      for (unsigned j = 0; j != NumRetains + 1; ++j)
+        swift_release(object);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(retains + NumThreads * NumRetains,
+            getStatistic(RuntimeStatistic::Retain));
+  EXPECT_EQ(testAllocs + NumThreads, getTestObjectAllocations());
+}